@@ -0,0 +1,82 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+// 性能测试共用函数：每项测试重复 BENCH_RUNS 次（环境变量，默认 5），输出中位数、平均值、相对标准差和范围；
+// 设置环境变量 BENCH_OUTPUT 时每项结果另以一行 JSON 追加到该文件，BENCH_LABEL 作为其中的 build 字段，
+// 便于比较不同构建和编译选项的结果
+
+#define BENCH_MAX_RUNS 100
+
+static inline double bench_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// 重复次数
+static inline int bench_runs() {
+    const char *runs = getenv("BENCH_RUNS");
+    int n = runs ? atoi(runs) : 5;
+    return n < 1 ? 1 : n > BENCH_MAX_RUNS ? BENCH_MAX_RUNS : n;
+}
+
+static inline int bench_compare(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+// 输出一项测试的各次结果：bench 为测试程序，name 为测试项，param 为参数（数据长度、线程数等），unit 为单位
+static inline void bench_report(const char *bench, const char *name, const char *param_name, long param,
+                                const char *unit, const double *samples, int n) {
+    double sorted[BENCH_MAX_RUNS];
+    double sum = 0;
+    memcpy(sorted, samples, n * sizeof(double));
+    qsort(sorted, n, sizeof(double), bench_compare);
+    for (int i = 0; i < n; i++) {
+        sum += sorted[i];
+    }
+    double mean = sum / n;
+    double var = 0;
+    for (int i = 0; i < n; i++) {
+        var += (sorted[i] - mean) * (sorted[i] - mean);
+    }
+    double stddev = n > 1 ? sqrt(var / (n - 1)) : 0;
+    double median = n % 2 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+
+    printf("%-16s %-8s %9ld %12.2f %-6s +-%5.1f%%  [%.2f, %.2f]\n", name, param_name, param, median, unit,
+           mean > 0 ? stddev / mean * 100 : 0, sorted[0], sorted[n - 1]);
+    fflush(stdout);
+
+    const char *path = getenv("BENCH_OUTPUT");
+    if (!path || !*path) {
+        return;
+    }
+    FILE *fp = fopen(path, "a");
+    if (!fp) {
+        perror("Failed to open BENCH_OUTPUT");
+        return;
+    }
+    const char *label = getenv("BENCH_LABEL");
+    fprintf(fp, "{\"build\":\"%s\",\"bench\":\"%s\",\"name\":\"%s\",\"%s\":%ld,\"unit\":\"%s\",\"runs\":%d,"
+            "\"median\":%.4f,\"mean\":%.4f,\"stddev\":%.4f,\"min\":%.4f,\"max\":%.4f,\"samples\":[",
+            label ? label : "", bench, name, param_name, param, unit, n, median, mean, stddev, sorted[0], sorted[n - 1]);
+    for (int i = 0; i < n; i++) {
+        fprintf(fp, "%s%.4f", i ? "," : "", samples[i]);
+    }
+    fputs("]}\n", fp);
+    fclose(fp);
+}
+
+// 表头
+static inline void bench_header(const char *title) {
+    printf("%s\n%-16s %-8s %9s %12s %-6s %8s  %s\n", title, "name", "param", "", "median", "unit", "rsd", "[min, max]");
+}
+
+#endif // BENCH_H
@@ -0,0 +1,83 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "include/common.h"
+#include "include/functions.h"
+#include "include/buffer_pool.h"
+#include "include/rcu.h"
+#include "include/string_kernels.h"
+#include "bench/bench.h"
+
+// 处理函数性能测试：对注册表中的每个处理函数（默认函数，不含管理请求）在不同数据长度下
+// 通过 dispatch_request 调用，包括查找、输出缓冲区分配和统计记录，结果为每次调用的纳秒数
+
+#define MAX_PROBE_ID 256          // 探测的函数ID范围
+#define MAX_SIZE (1 << 20)        // 最大数据长度
+#define BYTES_PER_RUN (32 << 20)  // 每次重复处理的数据量
+#define MIN_CALLS 1000            // 每次重复的最少调用次数
+
+static const uint32_t sizes[] = { 16, 256, 4096, 65536, MAX_SIZE };
+
+// 每次调用的纳秒数
+static double bench_handler(int id, const char *data, uint32_t size) {
+    header_t header;
+    memset(&header, 0, sizeof(header));
+    header.id = id;
+    header.length = size;
+    response_t response;
+
+    long calls = BYTES_PER_RUN / size;
+    if (calls < MIN_CALLS) {
+        calls = MIN_CALLS;
+    }
+    dispatch_request(&header, data, &response); // 预热缓冲区池
+    buffer_free(response.data);
+    double start = bench_now();
+    for (long i = 0; i < calls; i++) {
+        dispatch_request(&header, data, &response);
+        buffer_free(response.data);
+    }
+    return (bench_now() - start) / calls * 1e9;
+}
+
+int main() {
+    string_kernels_init();
+    init_function_registry();
+    init_default_functions();
+
+    // 请求数据为以 NUL 结尾的字母（旧版处理函数要求）
+    char *data = (char *)malloc(MAX_SIZE + 1);
+    if (!data) {
+        printf("Failed to allocate benchmark buffer\n");
+        return 1;
+    }
+    for (uint32_t i = 0; i < MAX_SIZE; i++) {
+        data[i] = (i % 3 ? 'a' : 'A') + i % 26;
+    }
+    data[MAX_SIZE] = '\0';
+
+    int runs = bench_runs();
+    bench_header("handlers (ns per call)");
+    int found = 0;
+    for (int id = 1; id < MAX_PROBE_ID; id++) {
+        rcu_read_lock();
+        int registered = get_function_by_id(id) != NULL;
+        rcu_read_unlock();
+        if (!registered) {
+            continue;
+        }
+        found++;
+        char name[32];
+        snprintf(name, sizeof(name), "handler_%d", id);
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+            double samples[BENCH_MAX_RUNS];
+            for (int r = 0; r < runs; r++) {
+                samples[r] = bench_handler(id, data, sizes[s]);
+            }
+            bench_report("handlers", name, "size", sizes[s], "ns", samples, runs);
+        }
+    }
+
+    free(data);
+    return found > 0 ? 0 : 1;
+}
@@ -0,0 +1,102 @@
+#include "bench/bench.h"
+#include "include/string_kernels.h"
+
+// 字符串内核的正确性测试和吞吐量测试：
+// 先用随机数据在各种长度和对齐下把每个向量化实现与标量实现逐字节比较，再测量各实现的 GB/s（重复 BENCH_RUNS 次）
+
+#define MAX_CHECK_LEN 300         // 正确性测试的最大长度（覆盖所有尾部长度）
+#define BENCH_SIZE (4 << 20)      // 吞吐量测试的数据大小（4MB，与大请求相当）
+#define BENCH_ROUNDS 50           // 每次测量中调用内核的次数
+
+typedef void (*kernel_fn_t)(char *dst, const char *src, size_t len);
+
+// 取实现中的某个内核：0 大写，1 小写，2 反转
+static kernel_fn_t get_kernel(const string_kernels_t *k, int which) {
+    return which == 0 ? k->upper : which == 1 ? k->lower : k->reverse;
+}
+
+static const char *kernel_names[] = { "upper", "lower", "reverse" };
+
+// 与标量实现逐字节比较，返回失败次数
+static int check(const string_kernels_t *scalar, const string_kernels_t *impl) {
+    char src[MAX_CHECK_LEN + 64];
+    char expect[MAX_CHECK_LEN + 64];
+    char actual[MAX_CHECK_LEN + 64];
+    int failures = 0;
+
+    for (int which = 0; which < 3; which++) {
+        for (size_t offset = 0; offset < 32; offset += 7) {
+            for (size_t len = 0; len <= MAX_CHECK_LEN; len++) {
+                // 随机字节覆盖所有 256 个值，包括 NUL 和非 ASCII 字节
+                for (size_t i = 0; i < sizeof(src); i++) {
+                    src[i] = (char)rand();
+                }
+                memset(expect, 0x5A, sizeof(expect));
+                memset(actual, 0x5A, sizeof(actual));
+                get_kernel(scalar, which)(expect + offset, src + offset, len);
+                get_kernel(impl, which)(actual + offset, src + offset, len);
+                if (memcmp(expect, actual, sizeof(expect)) != 0) {
+                    if (failures++ < 10) {
+                        printf("FAIL %s %s: len %zu offset %zu\n", impl->name, kernel_names[which], len, offset);
+                    }
+                }
+            }
+        }
+    }
+    return failures;
+}
+
+// 测量一次内核吞吐量（GB/s，按输入字节数计算）
+static double bench_kernel(kernel_fn_t fn, char *dst, const char *src) {
+    fn(dst, src, BENCH_SIZE); // 预热
+    double start = bench_now();
+    for (int i = 0; i < BENCH_ROUNDS; i++) {
+        fn(dst, src, BENCH_SIZE);
+        __asm__ __volatile__("" : : "r"(dst) : "memory"); // 防止编译器省略重复调用
+    }
+    double elapsed = bench_now() - start;
+    return (double)BENCH_SIZE * BENCH_ROUNDS / elapsed / 1e9;
+}
+
+int main() {
+    const string_kernels_t *list[4];
+    int n = string_kernels_available(list, 4);
+    srand(12345);
+
+    int failures = 0;
+    for (int i = 1; i < n; i++) {
+        int f = check(list[0], list[i]);
+        printf("check %-8s %s\n", list[i]->name, f == 0 ? "ok" : "FAILED");
+        failures += f;
+    }
+
+    char *src = (char *)malloc(BENCH_SIZE);
+    char *dst = (char *)malloc(BENCH_SIZE);
+    if (!src || !dst) {
+        printf("Failed to allocate benchmark buffers\n");
+        return 1;
+    }
+    for (size_t i = 0; i < BENCH_SIZE; i++) {
+        src[i] = (char)(' ' + rand() % 95); // 可打印 ASCII，大小写字母约占一半
+    }
+
+    int runs = bench_runs();
+    bench_header("string kernels (GB/s)");
+    for (int i = 0; i < n; i++) {
+        for (int which = 0; which < 3; which++) {
+            char name[32];
+            snprintf(name, sizeof(name), "%s_%s", list[i]->name, kernel_names[which]);
+            double samples[BENCH_MAX_RUNS];
+            for (int r = 0; r < runs; r++) {
+                samples[r] = bench_kernel(get_kernel(list[i], which), dst, src);
+            }
+            bench_report("kernels", name, "size", BENCH_SIZE, "GB/s", samples, runs);
+        }
+    }
+    string_kernels_init();
+    printf("selected: %s\n", string_kernels()->name);
+
+    free(src);
+    free(dst);
+    return failures == 0 ? 0 : 1;
+}
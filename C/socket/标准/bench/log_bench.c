@@ -0,0 +1,135 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <sys/wait.h>
+#include "include/log.h"
+#include "bench/bench.h"
+
+// 日志性能测试：在各日志模式下由 1 到 8 个线程同时调用 LOG_INFO，结果为每个线程每次调用的纳秒数
+// （线程越多越能体现锁和队列的竞争）。日志模块的状态是全局的，每种模式在单独的子进程中测试，
+// 日志写入临时目录，测试结束后删除
+
+#define CALLS_PER_THREAD 50000
+#define MAX_THREADS 8
+
+typedef enum {
+    MODE_FILTERED,    // 低于运行时阈值，格式化之前丢弃
+    MODE_SYNC,
+    MODE_ASYNC_BLOCK,
+    MODE_ASYNC_DROP,
+    MODE_BINARY,
+    MODE_COUNT
+} log_mode_t;
+
+static const char *mode_names[MODE_COUNT] = { "filtered", "sync", "async_block", "async_drop", "binary" };
+static const int thread_counts[] = { 1, 2, 4, MAX_THREADS };
+
+static pthread_barrier_t start_barrier;
+
+static void *logger_main(void *arg) {
+    long id = (long)arg;
+    pthread_barrier_wait(&start_barrier);
+    for (int i = 0; i < CALLS_PER_THREAD; i++) {
+        LOG_INFO("bench thread %ld call %d value %s", id, i, "payload");
+    }
+    return NULL;
+}
+
+// 每个线程每次调用的纳秒数
+static double bench_threads(int threads) {
+    pthread_t list[MAX_THREADS];
+    pthread_barrier_init(&start_barrier, NULL, threads + 1);
+    for (long i = 0; i < threads; i++) {
+        pthread_create(&list[i], NULL, logger_main, (void *)i);
+    }
+    // 主线程最后到达屏障时各线程在此之后才开始；单核上主线程可能等到所有线程结束才被调度，
+    // 因此在进入屏障之前取开始时间
+    double start = bench_now();
+    pthread_barrier_wait(&start_barrier);
+    for (int i = 0; i < threads; i++) {
+        pthread_join(list[i], NULL);
+    }
+    double elapsed = bench_now() - start;
+    pthread_barrier_destroy(&start_barrier);
+    return elapsed / CALLS_PER_THREAD * 1e9;
+}
+
+// 在子进程中测试一种模式
+static void run_mode(log_mode_t mode, const char *dir) {
+    switch (mode) {
+    case MODE_FILTERED:
+        log_init(dir);
+        log_set_level(LOG_LEVEL_ERROR);
+        break;
+    case MODE_SYNC:
+        log_init(dir);
+        break;
+    case MODE_ASYNC_BLOCK:
+        log_init_async(dir, LOG_RING_SLOTS, LOG_OVERFLOW_BLOCK);
+        break;
+    case MODE_ASYNC_DROP:
+        log_init_async(dir, LOG_RING_SLOTS, LOG_OVERFLOW_DROP);
+        break;
+    default:
+        log_init_binary(dir);
+        break;
+    }
+    int runs = bench_runs();
+    for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++) {
+        double samples[BENCH_MAX_RUNS];
+        for (int r = 0; r < runs; r++) {
+            samples[r] = bench_threads(thread_counts[t]);
+        }
+        bench_report("log", mode_names[mode], "threads", thread_counts[t], "ns", samples, runs);
+    }
+    log_cleanup();
+}
+
+// 清空临时日志目录（包括轮转产生的文件）
+static void clear_dir(const char *dir) {
+    DIR *d = opendir(dir);
+    if (!d) {
+        return;
+    }
+    struct dirent *entry;
+    char path[512];
+    while ((entry = readdir(d)) != NULL) {
+        if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0) {
+            snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+            unlink(path);
+        }
+    }
+    closedir(d);
+}
+
+int main() {
+    char dir[] = "/tmp/log_bench.XXXXXX";
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    // 运行时阈值可能被环境变量改变
+    unsetenv("LOG_LEVEL");
+
+    int failures = 0;
+    bench_header("LOG_INFO (ns per call per thread)");
+    for (int mode = 0; mode < MODE_COUNT; mode++) {
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid == 0) {
+            run_mode((log_mode_t)mode, dir);
+            exit(0);
+        }
+        int status;
+        if (pid < 0 || waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            printf("FAIL %s\n", mode_names[mode]);
+            failures++;
+        }
+        clear_dir(dir);
+    }
+    rmdir(dir);
+    return failures == 0 ? 0 : 1;
+}
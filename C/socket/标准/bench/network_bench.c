@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include "include/network.h"
+#include "bench/bench.h"
+
+// 网络辅助函数性能测试：在 socketpair 上一个线程用 send_all 按块发送，另一个线程用 receive_all 按块接收，
+// 测量不同块大小下的吞吐量（MB/s），并检查接收到的数据
+
+#define MAX_CHUNK (1 << 20)        // 最大块大小
+#define BYTES_PER_RUN (64 << 20)   // 每次重复传输的数据量
+#define MAX_CHUNKS_PER_RUN 200000  // 小块时限制系统调用次数
+
+static const uint32_t chunks[] = { 64, 1024, 16384, 65536, MAX_CHUNK };
+
+typedef struct {
+    int sock;
+    uint32_t chunk;
+    long count;
+    char *buffer;
+    int failed;
+} receiver_t;
+
+static void *receiver_main(void *arg) {
+    receiver_t *r = (receiver_t *)arg;
+    for (long i = 0; i < r->count; i++) {
+        if (receive_all(r->sock, r->buffer, r->chunk) < 0) {
+            r->failed = 1;
+            return NULL;
+        }
+    }
+    // 检查最后一块的内容
+    for (uint32_t i = 0; i < r->chunk; i++) {
+        if (r->buffer[i] != (char)('a' + i % 26)) {
+            r->failed = 1;
+            break;
+        }
+    }
+    return NULL;
+}
+
+// 吞吐量（MB/s），失败返回 -1
+static double bench_transfer(const char *data, char *buffer, uint32_t chunk) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        perror("socketpair");
+        return -1;
+    }
+    long count = BYTES_PER_RUN / chunk;
+    if (count > MAX_CHUNKS_PER_RUN) {
+        count = MAX_CHUNKS_PER_RUN;
+    }
+    receiver_t r = { fds[1], chunk, count, buffer, 0 };
+    pthread_t thread;
+
+    double start = bench_now();
+    pthread_create(&thread, NULL, receiver_main, &r);
+    int failed = 0;
+    for (long i = 0; i < count && !failed; i++) {
+        failed = send_all(fds[0], data, chunk) < 0;
+    }
+    pthread_join(thread, NULL);
+    double elapsed = bench_now() - start;
+
+    close(fds[0]);
+    close(fds[1]);
+    if (failed || r.failed) {
+        return -1;
+    }
+    return (double)chunk * count / elapsed / 1e6;
+}
+
+int main() {
+    char *data = (char *)malloc(MAX_CHUNK);
+    char *buffer = (char *)malloc(MAX_CHUNK);
+    if (!data || !buffer) {
+        printf("Failed to allocate benchmark buffers\n");
+        return 1;
+    }
+    for (uint32_t i = 0; i < MAX_CHUNK; i++) {
+        data[i] = 'a' + i % 26;
+    }
+
+    int runs = bench_runs();
+    int failures = 0;
+    bench_header("send_all / receive_all over socketpair (MB/s)");
+    for (size_t c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++) {
+        double samples[BENCH_MAX_RUNS];
+        int ok = 1;
+        for (int r = 0; r < runs && ok; r++) {
+            samples[r] = bench_transfer(data, buffer, chunks[c]);
+            ok = samples[r] >= 0;
+        }
+        if (!ok) {
+            printf("FAIL chunk %u\n", chunks[c]);
+            failures++;
+            continue;
+        }
+        bench_report("network", "socketpair", "chunk", chunks[c], "MB/s", samples, runs);
+    }
+
+    free(data);
+    free(buffer);
+    return failures == 0 ? 0 : 1;
+}
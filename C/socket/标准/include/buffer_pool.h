@@ -0,0 +1,40 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 按大小分级的缓冲区池：请求数据、响应数据等热路径上的缓冲区从这里分配，
+// 释放后回收到当前线程的缓存，避免频繁调用 malloc/free 造成锁竞争和内存碎片
+
+#define BUFFER_POOL_MIN_SHIFT 6          // 最小大小类 64 字节
+#define BUFFER_POOL_CLASSES 8            // 大小类数量：64B、256B、1KB ... 1MB（每级 4 倍）
+#define BUFFER_POOL_CACHE_BYTES (1 << 20)   // 每个线程每个大小类最多缓存的字节数
+#define BUFFER_POOL_GLOBAL_BYTES (16 << 20) // 全局池每个大小类最多缓存的字节数
+#define BUFFER_POOL_BATCH 16             // 线程缓存与全局池之间一次交换的缓冲区数
+
+// 缓冲区池统计信息
+typedef struct {
+    uint64_t hits;            // 从线程缓存分配的次数
+    uint64_t global_hits;     // 线程缓存为空、从全局池补充后分配的次数
+    uint64_t misses;          // 池中没有可用缓冲区、调用 malloc 分配的次数
+    uint64_t oversize;        // 超过最大大小类、直接调用 malloc 的次数
+    uint64_t cached;          // 全局池中空闲的缓冲区数
+} buffer_pool_stats_t;
+
+// 分配至少 size 字节的缓冲区，失败返回 NULL
+void *buffer_alloc(size_t size);
+
+// 释放 buffer_alloc 分配的缓冲区（可以在任意线程中释放），ptr 为 NULL 时不做任何操作
+void buffer_free(void *ptr);
+
+// 返回缓冲区的实际可用字节数（不小于分配时请求的大小）
+size_t buffer_size(const void *ptr);
+
+// 获取统计信息
+void buffer_pool_get_stats(buffer_pool_stats_t *stats);
+
+// 将统计信息写入日志
+void buffer_pool_log_stats();
+
+#endif // BUFFER_POOL_H
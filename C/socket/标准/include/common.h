@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <sys/time.h>
+#include <time.h>
 #include <stdlib.h>
 #include <pthread.h>
 
@@ -10,9 +11,14 @@
 #define SERVER_PORT 8888
 #define ERROR_MSG_SIZE 256  // 错误信息最大长度
 #define CHUNK_SIZE 4096     // 每个数据块的大小（4KB）
+#define MAX_REQUEST_SIZE (64 << 20) // 普通请求数据的最大长度（64MB），更大的数据需要使用流式请求
 #define HEARTBEAT_INTERVAL 5 // 心跳间隔时间（秒）
 #define MAX_RETRY_ATTEMPTS 3 // 最大重连次数
-#define RETRY_INTERVAL 5     // 初始重连间隔时间（秒）
+#define RETRY_INTERVAL_MS 50 // 初始重连间隔时间（毫秒），之后每次翻倍并加随机抖动
+#define IDLE_TIMEOUT 60      // 服务端关闭空闲连接的超时时间（秒）
+#define HEARTBEAT_MSG "HEARTBEAT" // 心跳请求内容
+#define HEARTBEAT_ACK "ACK"       // 心跳应答内容
+#define TRACE_PHASES 4       // 服务端随响应返回的请求阶段数（见 protocol.h）
 
 // 连接模式枚举
 typedef enum {
@@ -20,44 +26,35 @@ typedef enum {
     LONG_CONNECTION
 } connection_mode_t;
 
-// 数据包头部
+// 数据包头部（内存表示，线路格式见 protocol.h）
 typedef struct {
     uint32_t length;       // 数据长度
     int id;                // 处理函数ID
     connection_mode_t mode; // 连接模式
     int is_heartbeat;      // 标识是否为心跳消息
+    int is_batch;          // 标识是否为批量请求（数据为多个子请求）
+    int is_stream;         // 标识是否为流式请求（数据按块发送）
+    int is_traced;         // 标识是否要求服务端返回各阶段耗时
+    uint32_t request_id;   // 请求ID，服务端在响应中原样返回
 } header_t;
 
-// 服务端响应包
+// 服务端响应包（内存表示，线路格式见 protocol.h）
 typedef struct {
-    int status;               // 状态：0 表示成功，1 表示失败
+    int status;               // 状态：0 表示成功，其他值为 status_code_t 错误码
+    uint32_t request_id;      // 对应请求的ID
     char error_msg[ERROR_MSG_SIZE]; // 错误信息
     uint32_t length;          // 响应数据长度
     double server_time;       // 服务端处理时间
+    int traced;               // 是否带有各阶段耗时
+    uint32_t trace_ns[TRACE_PHASES]; // 各阶段耗时（纳秒）：连接、读取数据、排队、处理
     char *data;               // 动态分配的响应数据
 } response_t;
 
-// 客户端请求参数
-typedef struct {
-    int id;                   // 处理函数ID
-    uint32_t data_len;        // 请求数据长度
-    char *data;               // 动态分配的请求数据
-    char *response;           // 动态分配的响应数据
-    uint32_t response_len;    // 响应数据长度
-    double server_time;       // 服务端处理时间
-    double client_time;       // 客户端响应时间
-    char error_msg[ERROR_MSG_SIZE]; // 错误信息
-    int sock;                 // 套接字描述符
-    connection_mode_t mode;   // 连接模式
-    pthread_t heartbeat_tid;  // 心跳线程ID
-    pthread_mutex_t sock_mutex; // 互斥锁保护 sock
-} client_request_t;
-
-// 获取当前时间（秒）
+// 获取当前时间（秒，单调时钟，只用于计算耗时，不受系统时间调整影响）
 static inline double get_current_time() {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    return tv.tv_sec + tv.tv_usec / 1000000.0;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
 }
 
 #endif // COMMON_H
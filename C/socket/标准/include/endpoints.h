@@ -0,0 +1,98 @@
+#ifndef ENDPOINTS_H
+#define ENDPOINTS_H
+
+#include <stdint.h>
+#include <netinet/in.h>
+
+// 多个服务端地址的负载均衡和故障转移：按策略选择地址，用带超时的非阻塞 connect 建立连接；
+// 连接失败或请求失败的地址被暂时剔除（时间按连续失败次数翻倍），到期后只放行一个请求试探，
+// 试探成功后恢复，因此一个节点宕机只影响一次连接超时（连接被拒绝时立即切换）
+
+#define MAX_ENDPOINTS 32            // 最多的地址数
+#define CONNECT_TIMEOUT_MS 200      // 默认连接超时（毫秒）
+#define EJECT_BASE_MS 100           // 第一次失败后剔除的时间（毫秒）
+#define EJECT_MAX_MS 5000           // 剔除时间上限（毫秒）
+
+// 负载均衡策略
+typedef enum {
+    BALANCE_ROUND_ROBIN,        // 轮询
+    BALANCE_LEAST_OUTSTANDING,  // 在途请求最少
+    BALANCE_P2C                 // 随机选两个，取在途请求较少的一个
+} balance_policy_t;
+
+// 一个服务端地址（状态字段用原子操作访问）
+typedef struct {
+    char name[64];              // "地址:端口"，用于日志
+    struct sockaddr_in addr;
+    int outstanding;            // 在途请求数
+    int failures;               // 连续失败次数，0 表示正常
+    uint64_t ejected_until;     // 剔除截止时间（纳秒，单调时钟）
+    int probing;                // 剔除到期后是否已有请求在试探
+} endpoint_t;
+
+// 地址集合，可以被多个客户端对象和线程共享
+typedef struct {
+    endpoint_t endpoints[MAX_ENDPOINTS];
+    int count;
+    balance_policy_t policy;
+    int connect_timeout_ms;     // 连接超时，0 表示 CONNECT_TIMEOUT_MS
+    unsigned next;              // 轮询位置
+} endpoint_set_t;
+
+// 初始化为空集合
+void endpoints_init(endpoint_set_t *set, balance_policy_t policy);
+
+// 添加地址（IPv4），失败返回 -1
+int endpoints_add(endpoint_set_t *set, const char *host, int port);
+
+// 解析并添加逗号分隔的地址列表，如 "127.0.0.1:8888,127.0.0.1:8889"；端口省略时为 SERVER_PORT
+int endpoints_parse(endpoint_set_t *set, const char *list);
+
+// 按名称（rr / least / p2c）解析策略，名称无效时返回 -1
+int balance_policy_parse(const char *name, balance_policy_t *policy);
+
+// 默认集合：只有 SERVER_IP:SERVER_PORT
+endpoint_set_t *endpoints_default();
+
+// 按策略选择一个可用的地址，跳过 *tried 中的地址并把选中的地址加入 *tried；没有可用的地址时返回 NULL
+endpoint_t *endpoints_pick(endpoint_set_t *set, uint32_t *tried);
+
+// 连接一个地址（超时为 connect_timeout_ms），成功时记录地址恢复；nonblocking 非 0 时返回非阻塞 socket。
+// 失败时剔除该地址并返回 -1
+int endpoint_connect(endpoint_set_t *set, endpoint_t *endpoint, int nonblocking);
+
+// 开始非阻塞连接（不等待），返回正在连接的 socket，可写时调用 endpoint_connect_finish；
+// 立即失败时剔除该地址并返回 -1
+int endpoint_connect_start(endpoint_t *endpoint);
+
+// 完成 endpoint_connect_start 开始的连接：err 为 0 时从 SO_ERROR 读取连接结果（超时传入 ETIMEDOUT），
+// 成功返回 0 并记录地址恢复；失败时关闭 socket、剔除该地址并返回 -1
+int endpoint_connect_finish(endpoint_t *endpoint, int fd, int err);
+
+// 连接超时（毫秒）
+static inline int endpoints_connect_timeout_ms(const endpoint_set_t *set) {
+    return set->connect_timeout_ms > 0 ? set->connect_timeout_ms : CONNECT_TIMEOUT_MS;
+}
+
+// 依次选择地址并连接，直到成功或没有可用的地址；成功返回 socket 并通过 chosen 返回地址，失败返回 -1
+int endpoints_connect(endpoint_set_t *set, int nonblocking, endpoint_t **chosen);
+
+// 已建立的连接上请求失败：剔除该地址
+void endpoint_failed(endpoint_t *endpoint);
+
+// 请求成功：恢复被剔除的地址（正常的地址只读取一次失败计数）
+void endpoint_succeeded(endpoint_t *endpoint);
+
+// 选中剔除到期的地址用于试探后没有使用它时调用，让其他请求可以试探
+void endpoint_cancel_probe(endpoint_t *endpoint);
+
+// 在途请求计数
+static inline void endpoint_acquire(endpoint_t *endpoint) {
+    __atomic_add_fetch(&endpoint->outstanding, 1, __ATOMIC_RELAXED);
+}
+
+static inline void endpoint_release(endpoint_t *endpoint) {
+    __atomic_sub_fetch(&endpoint->outstanding, 1, __ATOMIC_RELAXED);
+}
+
+#endif // ENDPOINTS_H
@@ -0,0 +1,18 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include "thread_pool.h"
+
+// 单个事件循环允许同时监听的最大事件数
+#define MAX_EPOLL_EVENTS 1024
+// 单个连接上允许同时处理中的最大请求数，超过后暂停读取
+#define MAX_INFLIGHT_PER_CONN 128
+// 单次 sendmsg 最多合并的缓冲区数（每个响应占头部和数据两个）
+#define MAX_WRITE_IOV 64
+
+// 运行基于 epoll 的事件循环（边缘触发 + 非阻塞 socket），出错时返回 -1
+// pool 不为 NULL 时处理函数在线程池中执行，同一连接上的响应按完成顺序返回；
+// pool 为 NULL 时在事件循环线程中按请求顺序处理
+int event_loop_run(int listen_fd, thread_pool_t *pool);
+
+#endif // EVENT_LOOP_H
@@ -2,23 +2,111 @@
 #define FUNCTIONS_H
 
 #include <stdint.h>
+#include "common.h"
 
-// 处理函数类型定义
+#define MAX_DATA_SIZE 4096 // 旧版处理函数可以假设的最小输出缓冲区大小
+#define RESERVED_FUNCTION_ID_BASE 0x7FFF0000 // 不小于该值的函数ID保留给服务端管理请求
+
+// 响应状态码（线路格式中的 status 字段），0 表示成功
+typedef enum {
+    STATUS_OK = 0,               // 成功
+    STATUS_UNKNOWN_FUNCTION = 1, // 未注册的函数ID
+    STATUS_INVALID_INPUT = 2,    // 输入数据不合法
+    STATUS_NO_MEMORY = 3,        // 服务端内存不足
+    STATUS_HANDLER_ERROR = 4     // 处理函数内部错误
+} status_code_t;
+
+// 处理函数输出缓冲区，处理函数按需预留或扩展容量（内存来自缓冲区池）
+typedef struct {
+    char *data;           // 输出数据
+    uint32_t length;      // 已写入的字节数
+    uint32_t capacity;    // 当前容量
+} output_buffer_t;
+
+// 旧版处理函数类型：输入以 null 结尾，输出写入调用方分配的缓冲区
 typedef void (*handler_t)(const char *, char *, uint32_t *);
 
+// 处理函数类型（v2）：输入按长度传递（可以包含 NUL 字节），输出写入可扩展的 out；
+// 返回 STATUS_OK 表示成功，否则返回状态码并可在 error_msg（ERROR_MSG_SIZE 字节）中写入错误信息
+typedef int (*handler_v2_t)(const char *input, uint32_t length, output_buffer_t *out, char *error_msg);
+
+// 流式处理函数：请求数据按块到达，每块调用一次 process，输入结束后调用 finish；每次调用追加到 out 的数据
+// 作为一个响应块立即发送（不超过 MAX_CHUNK_SIZE 字节）。state 是服务端为每个请求分配并清零的 state_size 字节，
+// 请求结束或中止时由服务端直接释放，因此不能持有其他需要释放的资源
+typedef struct {
+    uint32_t state_size;  // 每个请求的状态大小
+    int (*process)(void *state, const char *input, uint32_t length, output_buffer_t *out, char *error_msg);
+    int (*finish)(void *state, output_buffer_t *out, char *error_msg); // 可以为 NULL
+} stream_handler_t;
+
 // 处理函数结构体
 typedef struct {
     int id;               // 函数ID
-    handler_t handler;    // 处理函数指针
+    handler_v2_t handler; // 处理函数指针（v2）
+    handler_t legacy;     // 旧版处理函数指针，不为 NULL 时通过适配层调用
+    const stream_handler_t *stream; // 流式处理函数，为 NULL 表示不支持流式请求
+    uint64_t version;     // 函数项版本（每次注册或替换递增）
 } function_t;
 
+// 正在进行的流式请求（处理函数每次调用前重新查找，期间被替换或注销时请求失败）
+typedef struct {
+    int id;               // 函数ID
+    uint64_t version;     // 打开时的函数项版本
+    void *state;          // 处理函数状态
+    int status;           // 第一个失败的状态码（用于统计）
+    uint64_t bytes_in;    // 已处理的输入字节数
+    uint64_t bytes_out;   // 已输出的字节数
+    uint64_t handler_ns;  // 各次调用处理函数的时间之和
+} stream_t;
+
+// 确保输出缓冲区还能写入 extra 字节，返回指向写入位置的指针，内存不足时返回 NULL
+char *output_reserve(output_buffer_t *out, uint32_t extra);
+
+// 追加数据到输出缓冲区，成功返回 0，内存不足返回 -1
+int output_append(output_buffer_t *out, const void *data, uint32_t length);
+
 // 初始化函数注册表
 void init_function_registry();
 
-// 动态添加处理函数
+// 注册表是哈希分发表，查找为 O(1) 且不加锁；注册、替换和注销可以在请求处理过程中进行
+
+// 动态添加处理函数（旧版接口，输出不超过 max(输入长度 * 2, MAX_DATA_SIZE) 字节）
 int register_function(int id, handler_t handler);
 
-// 根据ID获取处理函数
+// 动态添加处理函数（v2 接口）；ID 已存在时返回 -2
+int register_function_v2(int id, handler_v2_t handler);
+
+// 注册或替换处理函数，正在执行旧处理函数的请求不受影响，返回时已没有请求使用旧处理函数
+int replace_function_v2(int id, handler_v2_t handler);
+
+// 注册或替换支持流式请求的处理函数；handler 为 NULL 时普通请求通过 stream 一次处理全部数据
+int register_function_stream(int id, handler_v2_t handler, const stream_handler_t *stream);
+
+// 恢复之前保存的函数项（处理函数、旧版处理函数和流式处理函数），替换当前同ID的处理函数
+int restore_function(const function_t *func);
+
+// 注销处理函数，未找到时返回 -1；返回时已没有请求使用该处理函数
+int unregister_function(int id);
+
+// 根据ID获取处理函数；调用方必须处于 rcu_read_lock 读临界区，返回的指针在退出临界区后失效
 function_t *get_function_by_id(int id);
 
+// 注册默认处理函数
+void init_default_functions();
+
+// 根据请求头调用处理函数并填充响应包（response->data 需由调用方用 buffer_free 释放）
+void dispatch_request(const header_t *header, const char *data, response_t *response);
+
+// 开始流式请求，成功返回 STATUS_OK；函数不存在或不支持流式请求时返回状态码并写入 error_msg
+int stream_open(stream_t *stream, int id, char *error_msg);
+
+// 处理一个输入块，输出追加到 out
+int stream_process(stream_t *stream, const char *input, uint32_t length, output_buffer_t *out, char *error_msg);
+
+// 输入结束，最后的输出追加到 out
+int stream_finish(stream_t *stream, output_buffer_t *out, char *error_msg);
+
+// 释放流式请求状态（请求结束或中止时调用）
+void stream_close(stream_t *stream);
+
 #endif // FUNCTIONS_H
\ No newline at end of file
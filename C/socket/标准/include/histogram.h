@@ -0,0 +1,60 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdint.h>
+
+// 对数-线性直方图（HDR 风格）：小于 HIST_SUB 的值每个值一个桶，之后每个 2 的幂区间等分为 HIST_SUB 个桶，
+// 相对误差不超过 1/HIST_SUB（约 3%），覆盖 0 到约 68 秒（纳秒），更大的值计入最后一个桶。
+// 记录只由一个线程进行；计数器用原子写入更新，其他线程可以同时合并读取而不会读到撕裂的值
+
+#define HIST_SUB_BITS 5
+#define HIST_SUB (1 << HIST_SUB_BITS)
+#define HIST_MAX_BITS 36
+#define HIST_BUCKETS ((HIST_MAX_BITS - HIST_SUB_BITS + 1) * HIST_SUB)
+
+// 延迟分布（纳秒）
+typedef struct {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    uint64_t buckets[HIST_BUCKETS];
+} histogram_t;
+
+// 单写者计数器累加：不需要原子的读-改-写
+static inline void hist_counter_add(uint64_t *counter, uint64_t value) {
+    __atomic_store_n(counter, *counter + value, __ATOMIC_RELAXED);
+}
+
+// 值所在的桶
+static inline int hist_index(uint64_t value) {
+    if (value < HIST_SUB) {
+        return (int)value;
+    }
+    int msb = 63 - __builtin_clzll(value);
+    if (msb >= HIST_MAX_BITS) {
+        return HIST_BUCKETS - 1;
+    }
+    int shift = msb - HIST_SUB_BITS;
+    return (shift + 1) * HIST_SUB + (int)((value >> shift) - HIST_SUB);
+}
+
+// 记录一个值
+static inline void hist_record(histogram_t *hist, uint64_t value) {
+    hist_counter_add(&hist->count, 1);
+    hist_counter_add(&hist->sum, value);
+    hist_counter_add(&hist->buckets[hist_index(value)], 1);
+    if (value > hist->max) {
+        __atomic_store_n(&hist->max, value, __ATOMIC_RELAXED);
+    }
+}
+
+// 把 src 合并到 dst（src 可以正在被其他线程记录）
+void hist_merge(histogram_t *dst, const histogram_t *src);
+
+// 分位数（纳秒，quantile 为 0 到 1），结果为所在桶的上界且不超过最大值；没有记录时返回 0
+uint64_t hist_percentile(const histogram_t *hist, double quantile);
+
+// 平均值（纳秒）
+double hist_mean(const histogram_t *hist);
+
+#endif // HISTOGRAM_H
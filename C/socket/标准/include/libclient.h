@@ -0,0 +1,161 @@
+#ifndef LIBCLIENT_H
+#define LIBCLIENT_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include "common.h"
+#include "endpoints.h"
+
+// 客户端库（libclient.a）：单连接请求接口、多线程共享的连接池和异步接口。
+// 三种接口都可以使用多个服务端地址（endpoint_set_t，见 endpoints.h），按策略负载均衡并在地址故障时切换。
+// 库中的日志在调用方执行 log_init 之前不会输出
+
+#define POOL_DEFAULT_SIZE 8         // 连接池默认最大连接数
+#define POOL_MAX_IDLE_MS 30000      // 空闲超过该时间的连接在借出前关闭（小于服务端 IDLE_TIMEOUT）
+#define ASYNC_DEFAULT_CONNECTIONS 2 // 异步客户端默认连接数
+#define ASYNC_DEFAULT_INFLIGHT 256  // 异步客户端每个连接默认的最大在途请求数
+#define ASYNC_SLOT_BITS 12          // 请求ID的低位为在途槽位下标，每个连接最多 4096 个在途请求
+#define ASYNC_RECONNECT_MS 100      // 所有地址都不可用时再次尝试连接的间隔（毫秒）
+
+// 客户端请求参数（单连接接口）
+typedef struct {
+    int id;                   // 处理函数ID
+    uint32_t request_id;      // 最近一次请求的ID（每次请求递增）
+    uint32_t data_len;        // 请求数据长度
+    char *data;               // 动态分配的请求数据
+    char *response;           // 动态分配的响应数据
+    uint32_t response_len;    // 响应数据长度
+    double server_time;       // 服务端处理时间
+    double client_time;       // 客户端响应时间
+    int trace;                // 是否要求服务端返回各阶段耗时
+    int traced;               // 最近一次响应是否带有各阶段耗时
+    uint32_t trace_ns[TRACE_PHASES]; // 最近一次响应中的各阶段耗时（纳秒）
+    char error_msg[ERROR_MSG_SIZE]; // 错误信息
+    int sock;                 // 套接字描述符
+    connection_mode_t mode;   // 连接模式
+    pthread_t heartbeat_tid;  // 心跳线程ID
+    pthread_mutex_t sock_mutex; // 互斥锁保护 sock
+    pthread_cond_t heartbeat_cond; // 用于唤醒心跳线程（关闭连接时）
+    endpoint_set_t *endpoints; // 服务端地址集合，NULL 表示 endpoints_default()
+    endpoint_t *endpoint;     // 当前连接的地址
+} client_request_t;
+
+// 连接（重连）服务端：按策略选择地址，连接失败的地址被剔除并立即换下一个地址；
+// 所有地址都不可用时按毫秒级指数退避（带随机抖动）重试，最多 MAX_RETRY_ATTEMPTS 轮。成功返回 0
+int reconnect_to_server(client_request_t *request);
+
+// 发送请求并等待响应；长连接模式下首次请求后启动心跳线程
+void client_request(client_request_t *request);
+
+// 关闭长连接：通知心跳线程退出并等待其结束
+void client_close(client_request_t *request);
+
+// 连接池中的一个连接
+typedef struct client_conn {
+    int sock;
+    uint32_t request_id;      // 最近一次请求的ID
+    double last_used;         // 上次归还的时间（秒，单调时钟）
+    endpoint_t *endpoint;     // 连接的地址
+    int probing;              // 借出时是否在试探被剔除的地址（归还时结束试探）
+    struct client_conn *next; // 空闲链表
+} client_conn_t;
+
+// 连接池配置，未设置（0 / NULL）的字段使用默认值
+typedef struct {
+    const char *host;         // 服务端地址（默认 SERVER_IP）
+    int port;                 // 服务端端口（默认 SERVER_PORT）
+    int max_size;             // 最大连接数，包括借出的连接（默认 POOL_DEFAULT_SIZE）
+    int checkout_timeout_ms;  // 连接数达到上限时等待归还的最长时间，0 表示一直等待
+    int max_idle_ms;          // 空闲超过该时间的连接不再使用（默认 POOL_MAX_IDLE_MS）
+    endpoint_set_t *endpoints; // 多个服务端地址，不为 NULL 时忽略 host 和 port
+} client_pool_config_t;
+
+// 连接池：多个线程共享，借出时先按策略选择地址，优先使用到该地址的最近归还的连接，
+// 没有时建立新连接；连接数达到上限时使用到其他地址的空闲连接
+typedef struct {
+    client_pool_config_t config;
+    endpoint_set_t own_endpoints; // 没有配置 endpoints 时由 host 和 port 组成的集合
+    endpoint_set_t *endpoints;
+    pthread_mutex_t mutex;    // 保护以下字段
+    pthread_cond_t returned;  // 有连接归还或连接数减少
+    client_conn_t *idle;      // 空闲连接（栈，最近归还的在前）
+    int total;                // 已建立的连接数（空闲 + 借出 + 正在建立）
+    int idle_count;           // 空闲连接数
+    uint64_t connects;        // 建立连接的次数
+    uint64_t reuses;          // 复用空闲连接的次数
+    uint64_t discarded;       // 健康检查失败或空闲过久而关闭的连接数
+} client_pool_t;
+
+// 一次连接池请求的结果
+typedef struct {
+    int status;               // 服务端状态码（0 表示成功），连接错误时为 -1
+    char *response;           // 响应数据（以 null 结尾，由调用方用 buffer_free 释放），失败时为 NULL
+    uint32_t response_len;    // 响应数据长度
+    double server_time;       // 服务端处理时间
+    double client_time;       // 客户端耗时（包括借出连接或排队）
+    char error_msg[ERROR_MSG_SIZE]; // 错误信息
+} client_result_t;
+
+// 创建连接池（不建立连接），config 为 NULL 时全部使用默认值；失败返回 NULL
+client_pool_t *client_pool_create(const client_pool_config_t *config);
+
+// 关闭所有空闲连接并释放连接池，调用前必须归还所有借出的连接
+void client_pool_destroy(client_pool_t *pool);
+
+// 借出一个连接：空闲连接先做健康检查（对端已关闭或空闲过久的连接直接关闭），没有可用连接时建立新连接
+// （连接失败的地址被剔除，换下一个地址），连接数达到上限时等待归还；失败或超时返回 NULL
+client_conn_t *client_pool_checkout(client_pool_t *pool);
+
+// 归还连接；broken 非 0 时关闭连接（请求失败后连接上可能残留未读数据，必须关闭），否则记录该地址正常
+void client_pool_return(client_pool_t *pool, client_conn_t *conn, int broken);
+
+// 借出连接、发送一个请求并接收响应、归还连接；请求失败时关闭连接并换一个连接重试（处理函数应是幂等的）：
+// 复用的空闲连接可能刚好被服务端关闭，新建立的连接失败说明地址故障，剔除该地址。返回 result->status
+int client_pool_call(client_pool_t *pool, int id, const char *data, uint32_t length, client_result_t *result);
+
+// 异步客户端：一个后台事件循环线程驱动少量连接，任意线程提交请求后立即返回句柄，
+// 每个连接上可以同时有多个在途请求（服务端按完成顺序返回，通过请求ID匹配）。
+// 每个连接按策略连接到一个地址，请求按同一策略在连接之间分配（轮询 / 在途最少 / 随机两个取较少），
+// 所有连接都达到 max_inflight 时在客户端排队；连接断开后立即改连其他可用地址
+typedef struct client_async client_async_t;
+
+// 一个异步请求的句柄
+typedef struct client_call client_call_t;
+
+// 完成回调：在事件循环线程中调用，不能阻塞；可以在回调中调用 client_call_free 释放句柄
+typedef void (*client_callback_t)(client_call_t *call, const client_result_t *result, void *arg);
+
+// 异步客户端配置，未设置（0 / NULL）的字段使用默认值
+typedef struct {
+    const char *host;         // 服务端地址（默认 SERVER_IP）
+    int port;                 // 服务端端口（默认 SERVER_PORT）
+    int connections;          // 连接数（默认 ASYNC_DEFAULT_CONNECTIONS）
+    int max_inflight;         // 每个连接的最大在途请求数（默认 ASYNC_DEFAULT_INFLIGHT，不超过 1 << ASYNC_SLOT_BITS）
+    endpoint_set_t *endpoints; // 多个服务端地址，不为 NULL 时忽略 host 和 port
+} client_async_config_t;
+
+// 创建异步客户端并启动事件循环线程（连接在第一次需要时建立）；失败返回 NULL
+client_async_t *client_async_create(const client_async_config_t *config);
+
+// 停止事件循环，尚未完成的请求以失败完成（有回调的调用回调），然后释放客户端；
+// 之后仍需对没有回调的句柄调用 client_call_free
+void client_async_destroy(client_async_t *async);
+
+// 提交请求（数据会被复制），立即返回句柄；callback 为 NULL 时用 client_call_wait 等待完成。
+// 内存不足时返回 NULL
+client_call_t *client_async_submit(client_async_t *async, int id, const char *data, uint32_t length,
+                                   client_callback_t callback, void *arg);
+
+// 等待没有回调的请求完成，timeout_ms 为 0 表示一直等待；完成返回 0，超时返回 -1
+int client_call_wait(client_async_t *async, client_call_t *call, int timeout_ms);
+
+// 请求是否已完成（没有回调的请求）
+int client_call_done(client_async_t *async, client_call_t *call);
+
+// 已完成请求的结果，response 在 client_call_free 时释放
+const client_result_t *client_call_result(const client_call_t *call);
+
+// 释放已完成请求的句柄
+void client_call_free(client_call_t *call);
+
+#endif // LIBCLIENT_H
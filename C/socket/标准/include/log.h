@@ -2,21 +2,126 @@
 #define LOG_H
 
 #include <stdarg.h>
+#include <stdint.h>
 
-// 初始化日志模块
+// 日志级别（用于预处理器比较，因此不使用枚举）
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_ERROR 2
+#define LOG_LEVEL_COUNT 3
+
+// 编译时保留的最低级别，低于该级别的 LOG_* 调用在编译时移除（参数不会被求值），
+// 例如 make LOG_COMPILE_LEVEL=2 只保留 LOG_ERROR
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+// 默认限速：ERROR 级别每个调用点突发 20 条，之后每秒 10 条；其他级别不限速
+#define LOG_ERROR_BURST 20
+#define LOG_ERROR_RATE 10
+
+// 异步模式下日志环形队列已满时的处理方式
+typedef enum {
+    LOG_OVERFLOW_BLOCK,  // 等待写线程腾出空间，不丢日志
+    LOG_OVERFLOW_DROP    // 丢弃新日志并计数，由写线程补记丢弃条数
+} log_overflow_t;
+
+#define LOG_RING_SLOTS 4096  // 默认环形队列槽位数（2 的幂）
+#define LOG_LINE_SIZE 512    // 异步模式下单条日志的最大长度（含换行），超出部分截断
+
+// 初始化日志模块（同步模式：调用线程直接写文件）
 void log_init(const char *log_dir);
 
-// 清理日志模块
+// 初始化日志模块（异步模式：调用线程把日志格式化到环形队列，由后台线程批量写文件）；
+// slots 为环形队列槽位数，会向上取整为 2 的幂
+void log_init_async(const char *log_dir, int slots, log_overflow_t overflow);
+
+// 初始化日志模块（二进制模式：只记录格式ID、时间戳和原始参数，写入内存映射的段文件 log%d.bin，
+// 由 log_decode 转换为文本）
+void log_init_binary(const char *log_dir);
+
+// 清理日志模块（异步模式下先写完队列中剩余的日志），可以重复调用
 void log_cleanup();
 
+// 运行时级别阈值，低于该级别的日志在格式化之前丢弃（默认 LOG_LEVEL_INFO，可由环境变量 LOG_LEVEL 设置）
+extern int log_threshold;
+
+// 设置运行时级别阈值
+void log_set_level(int level);
+
+// 按名称（debug / info / error）设置运行时级别阈值，名称无效时返回 -1
+int log_set_level_name(const char *name);
+
+// 设置某个级别每个调用点的限速：最多突发 burst 条，之后每秒 rate 条；rate 为 0 表示不限速。
+// 被限速丢弃的条数在该调用点下一条日志之前（或 log_flush_suppressed 时）以
+// "Suppressed N messages from 文件:行号" 记录
+void log_set_rate_limit(int level, int burst, int rate);
+
+// 报告所有调用点尚未报告的限速丢弃条数（之后没有再记录日志的调用点也能得到汇总）；
+// log_cleanup 时会自动调用
+void log_flush_suppressed();
+
+// 日志调用点：每个 LOG_* 宏展开处一个静态实例，二进制模式下首次调用时注册格式并分配ID
+typedef struct log_site {
+    const char *format;
+    const char *file;
+    int line;
+    int level;
+    uint32_t id;                // 格式ID，0 表示尚未注册
+    int8_t nargs;               // 参数个数，-1 表示格式不支持二进制记录（先格式化为文本）
+    uint8_t types[16];          // 各参数类型（log_arg_t），与 LOG_MAX_ARGS 一致
+    uint64_t tat;               // 限速状态：理论到达时间（纳秒，单调时钟）
+    uint64_t suppressed;        // 被限速丢弃、尚未报告的条数
+    int pending;                // 是否在待报告链表中
+    struct log_site *pending_next;
+} log_site_t;
+
+// 在调用点记录一条日志
+void log_write(log_site_t *site, ...);
+
 // 记录错误日志
-void log_error(const char *file, int line, const char *format, ...);
+void log_error(const char *file, int line, const char *format, ...) __attribute__((format(printf, 3, 4)));
 
 // 记录信息日志
-void log_info(const char *file, int line, const char *format, ...);
+void log_info(const char *file, int line, const char *format, ...) __attribute__((format(printf, 3, 4)));
+
+// 编译时移除的日志调用：保留类型检查和变量引用，但不生成代码；
+// 也用于让编译器检查 LOG_AT 的格式与参数（log_write 的格式在调用点结构体中，无法直接检查）
+static inline void log_discard(const char *format, ...) __attribute__((format(printf, 1, 2)));
+static inline void log_discard(const char *format, ...) {
+    (void)format;
+}
+
+// 宏定义（format 必须是字符串字面量）；先检查运行时阈值，未通过时参数不会被求值
+#define LOG_AT(level, format, ...) do { \
+    if (0) { \
+        log_discard(format, ##__VA_ARGS__); \
+    } \
+    if ((level) >= __atomic_load_n(&log_threshold, __ATOMIC_RELAXED)) { \
+        static log_site_t log_site_ = { format, __FILE__, __LINE__, level }; \
+        log_write(&log_site_, ##__VA_ARGS__); \
+    } \
+} while (0)
+#define LOG_REMOVED(format, ...) do { \
+    if (0) { \
+        log_discard(format, ##__VA_ARGS__); \
+    } \
+} while (0)
 
-// 宏定义
-#define LOG_ERROR(format, ...) log_error(__FILE__, __LINE__, format, ##__VA_ARGS__)
-#define LOG_INFO(format, ...)  log_info(__FILE__, __LINE__, format, ##__VA_ARGS__)
+#if LOG_COMPILE_LEVEL > LOG_LEVEL_ERROR
+#define LOG_ERROR(format, ...) LOG_REMOVED(format, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(format, ...) LOG_AT(LOG_LEVEL_ERROR, format, ##__VA_ARGS__)
+#endif
+#if LOG_COMPILE_LEVEL > LOG_LEVEL_INFO
+#define LOG_INFO(format, ...)  LOG_REMOVED(format, ##__VA_ARGS__)
+#else
+#define LOG_INFO(format, ...)  LOG_AT(LOG_LEVEL_INFO, format, ##__VA_ARGS__)
+#endif
+#if LOG_COMPILE_LEVEL > LOG_LEVEL_DEBUG
+#define LOG_DEBUG(format, ...) LOG_REMOVED(format, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(format, ...) LOG_AT(LOG_LEVEL_DEBUG, format, ##__VA_ARGS__)
+#endif
 
 #endif // LOG_H
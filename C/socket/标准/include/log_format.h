@@ -0,0 +1,49 @@
+#ifndef LOG_FORMAT_H
+#define LOG_FORMAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 二进制日志段文件格式（本机字节序，只在生成日志的机器上解码）：
+//
+// 段头部（LOG_SEGMENT_HEADER_SIZE 字节）：
+//   magic(8) version(4) pid(4) created_ns(8) segment_size(4) 保留
+// 之后是一系列记录，每条记录以 8 字节对齐：
+//   length(4) format_id(4) timestamp_ns(8) 参数...
+// length 为整条记录长度，在记录写完后最后写入；读到 length 为 0 表示段结束（其余空间未使用）。
+// format_id 为 0 的记录是格式定义：site_id(4) line(4) level(4) file_len(2) format_len(2) 文件名 格式字符串；
+// 每个段开头会重新写入已注册的全部格式定义，因此每个段可以单独解码。
+// 参数按格式字符串中的转换说明依次存放：整数、浮点数和指针各占 8 字节，字符串为 length(4) + 数据
+
+#define LOG_SEGMENT_MAGIC "ITLOGSEG"
+#define LOG_SEGMENT_VERSION 1
+#define LOG_SEGMENT_HEADER_SIZE 64
+#define LOG_RECORD_HEADER_SIZE 16
+#define LOG_DEFINITION_HEADER_SIZE 16  // 格式定义记录中 site_id 到 format_len 的长度
+#define LOG_MAX_ARGS 16                // 单条日志的最大参数个数
+
+// 转换说明对应的参数类型
+typedef enum {
+    LOG_ARG_NONE,     // 不消耗参数（%%）
+    LOG_ARG_INT,      // int（含 char、short 提升后的值）
+    LOG_ARG_LONG,     // long
+    LOG_ARG_LLONG,    // long long
+    LOG_ARG_SIZE,     // size_t / ssize_t
+    LOG_ARG_INTMAX,   // intmax_t
+    LOG_ARG_PTRDIFF,  // ptrdiff_t
+    LOG_ARG_DOUBLE,   // double
+    LOG_ARG_STRING,   // const char *
+    LOG_ARG_POINTER   // void *
+} log_arg_t;
+
+// 查找 format 中下一个转换说明：返回指向 '%' 的指针（没有时返回 NULL），
+// *spec_len 为转换说明长度，*type 为参数类型；不支持的转换说明（%n、* 宽度等）类型为 -1
+const char *log_next_spec(const char *format, size_t *spec_len, int *type);
+
+// 解析格式字符串中各参数的类型，返回参数个数；含不支持的转换说明或参数过多时返回 -1
+int log_parse_format(const char *format, uint8_t *types, int max_args);
+
+// 日志级别名称
+const char *log_level_name(int level);
+
+#endif // LOG_FORMAT_H
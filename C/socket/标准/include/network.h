@@ -2,6 +2,7 @@
 #define NETWORK_H
 
 #include <stdint.h>
+#include <sys/uio.h>
 
 // 分块发送数据
 int send_all(int sock, const void *buffer, uint32_t length);
@@ -9,4 +10,25 @@ int send_all(int sock, const void *buffer, uint32_t length);
 // 分块接收数据
 int receive_all(int sock, void *buffer, uint32_t length);
 
-#endif // NETWORK_H
\ No newline at end of file
+// 接收并丢弃 length 字节
+int discard_all(int sock, uint32_t length);
+
+// 聚集发送：一次系统调用发送多个缓冲区，处理跨缓冲区的部分写入（会修改 iov 数组）
+int send_allv(int sock, struct iovec *iov, int iovcnt);
+
+// 分散接收：把数据依次填满多个缓冲区（会修改 iov 数组）
+int recv_allv(int sock, struct iovec *iov, int iovcnt);
+
+// 创建监听 socket 并开始监听，reuseport 非 0 时设置 SO_REUSEPORT 以便多个 socket 绑定同一端口
+int create_listen_socket(int port, int backlog, int reuseport);
+
+// 设置非阻塞模式
+int set_nonblocking(int fd);
+
+// 尽量把文件描述符上限提高到系统允许的最大值，以支持大量并发连接
+void raise_fd_limit();
+
+// 跳过 iov 数组中已传输的 bytes 字节，返回剩余的第一个 iovec 下标
+int iov_advance(struct iovec *iov, int iovcnt, size_t bytes);
+
+#endif // NETWORK_H
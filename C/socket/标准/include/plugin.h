@@ -0,0 +1,44 @@
+#ifndef PLUGIN_H
+#define PLUGIN_H
+
+#include <stdint.h>
+#include "functions.h"
+
+// 处理函数插件：共享库导出名为 plugin_info 的 plugin_info_t 结构体，声明插件提供的处理函数及其ID。
+// 服务端启动时加载插件目录中的所有 .so 文件，收到 SIGHUP 或管理请求时重新加载；
+// 新版本发布后，正在执行旧版本处理函数的请求全部结束才会卸载旧版本
+
+#define PLUGIN_ABI_VERSION 1              // 插件接口版本，不匹配的插件拒绝加载
+#define PLUGIN_INFO_SYMBOL "plugin_info"  // 插件导出的符号名
+#define PLUGIN_RELOAD_FUNCTION_ID (RESERVED_FUNCTION_ID_BASE + 1) // 管理请求：重新加载插件
+
+// 插件提供的单个处理函数
+typedef struct {
+    int id;                   // 函数ID（与内置处理函数相同时覆盖内置处理函数）
+    handler_v2_t handler;     // 处理函数
+} plugin_handler_t;
+
+// 插件描述
+typedef struct {
+    uint32_t abi_version;     // 必须为 PLUGIN_ABI_VERSION
+    const char *name;         // 插件名称
+    const plugin_handler_t *handlers; // 处理函数数组
+    int handler_count;        // 处理函数数量
+    int (*init)(void);        // 加载后、发布处理函数前调用（可以为 NULL），返回非 0 表示加载失败
+    void (*fini)(void);       // 卸载前调用（可以为 NULL），此时已没有请求使用该插件的处理函数
+} plugin_info_t;
+
+// 加载插件目录中的所有插件，返回成功加载的插件数；目录不存在时返回 -1
+int plugin_load_all(const char *dir);
+
+// 请求重新加载插件（只设置标志，可以在信号处理函数和处理函数中调用）
+void plugin_request_reload();
+
+// 如果有重新加载请求则重新扫描插件目录：发布新版本的处理函数，
+// 注销已删除插件的处理函数，等待宽限期后卸载旧版本（由主线程定期调用）
+void plugin_poll();
+
+// 卸载所有插件
+void plugin_unload_all();
+
+#endif // PLUGIN_H
@@ -0,0 +1,128 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <stdint.h>
+#include "common.h"
+
+// 线路格式：所有多字节字段均为网络字节序（大端），头部之后紧跟数据
+//
+// 请求头部（16 字节）：
+//   magic(2) version(1) flags(1) function_id(4) request_id(4) length(4)
+// 响应头部（16 字节）：
+//   magic(2) version(1) status(1) request_id(4) length(4) server_time_us(4)
+// 响应成功时数据为处理结果；失败时数据为错误信息（不含 null 终止符）
+//
+// 请求 flags 含 FLAG_TRACE 时，响应头部 status 字节的最高位（STATUS_TRACED）置位，
+// 头部之后、数据之前是 TRACE_PHASES 个 uint32 的阶段耗时（纳秒，超出时取 0xFFFFFFFF）：
+//   connect(连接接受到头部接收完毕，只在连接上的第一个请求中不为 0) read(读取数据)
+//   queue(数据接收完毕到开始处理，包括线程池排队；线程池模式下为连接交给线程池到工作线程读取头部) handler(调用处理函数)
+// 流式请求和心跳不返回阶段耗时
+//
+// 批量请求（flags 含 FLAG_BATCH，function_id 不使用）的数据：
+//   count(4)，之后依次为 count 个条目 function_id(4) length(4) data
+// 批量响应的数据（头部 status 为 0 表示整个批量帧格式正确）：
+//   count(4)，之后依次为 count 个条目 status(4) length(4) data（失败时为错误信息）
+//
+// 流式请求（flags 含 FLAG_STREAM，头部 length 不使用）的数据是一系列数据块 length(4) data，
+// 以长度为 0 的块结束，每块不超过 MAX_CHUNK_SIZE 字节。流式响应头部的 length 为 STREAM_LENGTH，
+// 之后同样是一系列数据块，结束块之后是尾部 status(4) length(4) 错误信息（成功时 status 为 0、length 为 0）。
+// 函数不存在等错误在开始时以普通失败响应返回；任何错误发生后服务端丢弃该请求剩余的数据块
+
+#define PROTOCOL_MAGIC 0x4954       // "IT"
+#define PROTOCOL_VERSION 1
+#define WIRE_HEADER_SIZE 16         // 请求头部长度
+#define WIRE_RESPONSE_SIZE 16       // 响应头部长度
+
+// 请求头部标志位
+#define FLAG_LONG_CONNECTION 0x01   // 长连接
+#define FLAG_HEARTBEAT 0x02         // 心跳消息
+#define FLAG_BATCH 0x04             // 批量请求
+#define FLAG_STREAM 0x08            // 流式请求
+#define FLAG_TRACE 0x10             // 要求返回各阶段耗时
+
+#define STATUS_TRACED 0x80          // 响应头部 status 字节中的标志：头部之后是阶段耗时
+#define TRACE_BLOCK_SIZE (TRACE_PHASES * 4) // 阶段耗时的长度
+#define WIRE_RESPONSE_MAX (WIRE_RESPONSE_SIZE + TRACE_BLOCK_SIZE) // 响应头部加阶段耗时的最大长度
+
+#define BATCH_ENTRY_HEADER_SIZE 8   // 批量条目头部长度
+#define MAX_BATCH_ENTRIES 65536     // 单个批量帧的最大条目数
+
+#define CHUNK_HEADER_SIZE 4         // 数据块头部长度
+#define STREAM_TRAILER_SIZE 8       // 流式响应尾部长度（不含错误信息）
+#define MAX_CHUNK_SIZE (16 * CHUNK_SIZE) // 单个数据块的最大长度
+#define STREAM_LENGTH 0xFFFFFFFFu   // 流式响应头部中的 length
+
+// 批量请求或响应中的一个条目
+typedef struct {
+    int code;                 // 请求中为函数ID，响应中为状态码
+    uint32_t length;          // 数据长度
+    const char *data;         // 数据（指向批量帧内部，不单独分配）
+} batch_entry_t;
+
+// 编码请求头部
+void encode_header(const header_t *header, uint8_t *buf);
+
+// 解码请求头部，magic 或版本不匹配时返回 -1
+int decode_header(const uint8_t *buf, header_t *header);
+
+// 编码响应头部（失败时 length 字段为错误信息长度）；response->traced 时随后写入阶段耗时，
+// buf 需要 WIRE_RESPONSE_MAX 字节。返回写入的字节数
+uint32_t encode_response(const response_t *response, uint8_t *buf);
+
+// 解码响应头部，magic 或版本不匹配时返回 -1
+int decode_response(const uint8_t *buf, response_t *response);
+
+// 响应头部之后的数据：成功时为 response->data，失败时为错误信息
+const char *response_body(const response_t *response, uint32_t *length);
+
+// 批量数据编码后的长度（超过 UINT32_MAX 时返回 0）
+uint32_t batch_encoded_size(const batch_entry_t *entries, uint32_t count);
+
+// 把 count 个条目编码到 buf（长度为 batch_encoded_size）
+void encode_batch(const batch_entry_t *entries, uint32_t count, char *buf);
+
+// 写入批量数据开头的条目数
+void encode_batch_count(char *buf, uint32_t count);
+
+// 写入批量条目头部
+void encode_batch_entry(char *buf, int code, uint32_t length);
+
+// 读取批量数据中的条目数，数据过短或条目数超过 MAX_BATCH_ENTRIES 时返回 -1；*offset 指向第一个条目
+int decode_batch_count(const char *data, uint32_t length, uint32_t *count, uint32_t *offset);
+
+// 读取 *offset 处的条目并前进到下一个条目，越界时返回 -1
+int decode_batch_entry(const char *data, uint32_t length, uint32_t *offset, batch_entry_t *entry);
+
+// 写入数据块头部
+void encode_chunk_header(uint8_t *buf, uint32_t length);
+
+// 读取数据块头部
+uint32_t decode_chunk_header(const uint8_t *buf);
+
+// 写入流式响应尾部
+void encode_stream_trailer(uint8_t *buf, int status, uint32_t length);
+
+// 发送请求（头部 + 数据）
+int send_request(int sock, const header_t *header, const void *data);
+
+// 接收并解码请求头部
+int receive_header(int sock, header_t *header);
+
+// 发送响应（头部 + 数据或错误信息）
+int send_response(int sock, const response_t *response);
+
+// 接收响应（带阶段耗时时一并读取到 response->trace_ns）；成功时 *data 为动态分配的响应数据（以 null 结尾，需由调用方用 buffer_free 释放），
+// 失败时错误信息写入 response->error_msg 且 *data 为 NULL；流式响应只接收头部（length 为 STREAM_LENGTH）
+int receive_response(int sock, response_t *response, char **data);
+
+// 发送一个数据块，length 为 0 时发送结束块
+int send_chunk(int sock, const void *data, uint32_t length);
+
+// 发送流式响应的结束块和尾部（status 不为 0 时附带错误信息）
+int send_stream_end(int sock, int status, const char *error_msg);
+
+// 接收流式响应的一个数据块到 buf（至少 MAX_CHUNK_SIZE 字节），返回块长度；
+// 收到结束块时读取尾部并返回 0，状态和错误信息写入 trailer；出错时返回 -1
+int receive_chunk(int sock, char *buf, response_t *trailer);
+
+#endif // PROTOCOL_H
@@ -0,0 +1,16 @@
+#ifndef RCU_H
+#define RCU_H
+
+// 基于纪元（epoch）的读-复制-更新：读取方不加锁，只写自己线程的纪元；
+// 写入方发布新版本后调用 rcu_synchronize 等待所有旧读取方退出，再释放旧版本
+
+// 进入读临界区（可嵌套），在 rcu_read_unlock 之前读到的受保护指针保持有效
+void rcu_read_lock();
+
+// 退出读临界区
+void rcu_read_unlock();
+
+// 等待调用前已进入的读临界区全部退出（宽限期）；不能在读临界区中调用
+void rcu_synchronize();
+
+#endif // RCU_H
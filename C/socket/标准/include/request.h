@@ -0,0 +1,180 @@
+#ifndef REQUEST_H
+#define REQUEST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/uio.h>
+#include "common.h"
+#include "protocol.h"
+#include "thread_pool.h"
+#include "functions.h"
+#include "trace.h"
+
+// 事件驱动服务端（epoll / io_uring）共用的请求解析、请求处理、响应队列、流式请求和空闲连接管理
+
+#define MAX_QUEUED_BYTES (1 << 20) // 连接的发送队列积压超过该字节数时暂停读取请求
+
+struct completion_queue;
+
+// 单个请求的处理上下文
+typedef struct request_ctx {
+    void *conn;               // 所属连接（由具体事件循环解释）
+    struct completion_queue *cq; // 在线程池中处理完成后放入的完成队列
+    header_t header;          // 请求头部
+    char *data;               // 请求数据
+    response_t response;      // 处理结果
+    uint8_t out_header[WIRE_RESPONSE_MAX]; // 编码后的响应头部和阶段耗时（流式响应中为数据块头部或结束块和尾部）
+    uint32_t out_header_len;  // out_header 的有效长度
+    const char *body;         // 响应头部之后的数据（处理结果或错误信息）
+    uint32_t body_len;        // 响应数据长度
+    uint64_t start_ns;        // 收到请求的时间（单调时钟），0 表示不统计端到端时间
+    trace_t trace;            // 分阶段跟踪记录
+    struct request_ctx *next; // 完成队列 / 发送队列链表
+} request_ctx_t;
+
+// 工作线程把处理完成的请求交还给事件循环的队列，通过 eventfd 通知
+typedef struct completion_queue {
+    int event_fd;             // 有新完成请求时可读
+    pthread_mutex_t mutex;    // 保护完成链表
+    request_ctx_t *head;      // 已完成的请求（后进先出）
+} completion_queue_t;
+
+// 连接上待发送的响应队列（按完成顺序）
+typedef struct {
+    request_ctx_t *head;
+    request_ctx_t *tail;
+    size_t sent;              // 队头响应已发送的字节数（含头部）
+    size_t bytes;             // 队列中尚未发送的字节数
+} response_queue_t;
+
+// 连接上正在接收的流式请求
+typedef struct {
+    stream_t stream;          // 处理函数状态
+    header_t header;          // 流式请求头部
+    int active;               // 流式响应正在输出，期间线程池完成的其他响应暂存到 held
+    int discard;              // 出错后丢弃剩余的数据块
+    response_queue_t held;    // 暂存的其他响应，流式响应结束后放入发送队列
+} stream_conn_t;
+
+// 按最近活动时间排序的空闲连接链表节点，嵌入在连接结构体中
+typedef struct idle_node {
+    time_t last_active;       // 最近一次活动时间
+    struct idle_node *prev;
+    struct idle_node *next;
+} idle_node_t;
+
+// 空闲连接链表
+typedef struct {
+    idle_node_t *head;        // 最久未活动的连接
+    idle_node_t *tail;        // 最近活动的连接
+} idle_list_t;
+
+// 连接读取状态：读头部 -> 读数据 -> 调用处理函数；流式请求：读头部 -> (读块头部 -> 读数据块)...
+typedef enum {
+    CONN_READ_HEADER,
+    CONN_READ_BODY,
+    CONN_READ_CHUNK_HEADER,
+    CONN_READ_CHUNK,
+    CONN_READ_DONE        // 短连接已读完唯一的请求或对端已关闭写方向，不再读取
+} conn_state_t;
+
+// 连接上的请求解析状态机，与 I/O 方式无关：事件循环把接收到的字节交给它，它负责状态转移、分配数据缓冲区、
+// 提交请求和处理流式数据块，响应放入 out，由事件循环发送
+typedef struct {
+    conn_state_t state;       // 当前读取状态
+    uint8_t header_buf[WIRE_HEADER_SIZE]; // 正在接收的请求头部（线路格式）
+    header_t header;          // 解码后的请求头部
+    uint32_t header_received; // 已接收的头部（或数据块头部）字节数
+    char *data;               // 请求数据或数据块，为 NULL 时丢弃接收到的数据
+    uint32_t data_length;     // 正在接收的数据或数据块的长度
+    uint32_t data_received;   // 已接收的数据字节数
+    stream_conn_t stream;     // 正在接收的流式请求
+    response_queue_t out;     // 待发送的响应队列（按完成顺序）
+    uint64_t accept_ns;       // 连接接受时间（单调时钟），第一个请求的跟踪记录取走后清零
+    trace_t trace;            // 正在接收的请求的跟踪记录
+    int pending;              // 正在线程池中处理的请求数
+    void *conn;               // 所属连接，写入请求上下文
+    thread_pool_t *pool;      // 处理函数线程池（NULL 表示在当前线程处理）
+    completion_queue_t *cq;   // 线程池处理完成后放入的完成队列
+} request_reader_t;
+
+// 初始化解析状态，记录连接接受时间
+void request_reader_init(request_reader_t *reader, void *conn, thread_pool_t *pool, completion_queue_t *cq);
+
+// 释放未完成的请求数据、流式请求状态和未发送的响应
+void request_reader_destroy(request_reader_t *reader);
+
+// 下一段数据的接收位置和剩余长度（可以直接 recv 到 *ptr）；*ptr 为 NULL 时接收到的数据应丢弃，
+// *want 为 0 时直接调用 request_reader_advance(reader, 0)；内存不足时返回 -1
+int request_reader_want(request_reader_t *reader, char **ptr, uint32_t *want);
+
+// 记录接收到的 n 字节（不超过 *want），一段数据接收完毕时推进状态机；返回 -1 表示需要关闭连接
+int request_reader_advance(request_reader_t *reader, uint32_t n);
+
+// 把接收缓冲区中的字节交给状态机，完整位于缓冲区中的数据块直接处理不拷贝；返回 -1 表示需要关闭连接。
+// 短连接读完请求后到达的数据被丢弃
+int request_reader_feed(request_reader_t *reader, const char *buf, size_t len);
+
+// 是否位于两个请求之间（对端此时关闭写方向是正常结束）
+static inline int request_reader_idle(const request_reader_t *reader) {
+    return reader->state == CONN_READ_HEADER && reader->header_received == 0;
+}
+
+// 创建请求上下文，data 的所有权转移给请求上下文
+request_ctx_t *request_create(void *conn, completion_queue_t *cq, const header_t *header, char *data);
+
+// 释放请求上下文
+void request_free(request_ctx_t *ctx);
+
+// 处理请求：pool 不为 NULL 时交给线程池（返回 1，完成后进入完成队列），
+// 否则或队列已满时在当前线程处理（返回 0，可以直接放入发送队列）
+int request_dispatch(thread_pool_t *pool, request_ctx_t *ctx);
+
+// 生成失败响应放入发送队列（不调用处理函数），内存不足时返回 -1
+int request_reject(response_queue_t *out, stream_conn_t *sc, const header_t *header, int status, const char *error_msg);
+
+// 开始流式请求：成功时发送流式响应头部，否则发送失败响应并丢弃之后的数据块；内存不足时返回 -1
+int stream_conn_begin(stream_conn_t *sc, const header_t *header, response_queue_t *out);
+
+// 处理一个数据块，输出作为一个响应块放入发送队列；内存不足时返回 -1
+int stream_conn_chunk(stream_conn_t *sc, const char *data, uint32_t length, response_queue_t *out);
+
+// 收到结束块：发送最后的输出、结束块和尾部；内存不足时返回 -1
+int stream_conn_end(stream_conn_t *sc, response_queue_t *out);
+
+// 连接关闭时释放流式请求状态和暂存的响应
+void stream_conn_abort(stream_conn_t *sc);
+
+// 把处理完成的响应放入发送队列；流式响应正在输出时暂存，避免插入到数据块之间
+void response_deliver(response_queue_t *out, stream_conn_t *sc, request_ctx_t *ctx);
+
+// 初始化完成队列
+int completion_queue_init(completion_queue_t *cq);
+
+// 销毁完成队列
+void completion_queue_destroy(completion_queue_t *cq);
+
+// 取出所有已完成的请求（按完成顺序链接）
+request_ctx_t *completion_queue_drain(completion_queue_t *cq);
+
+// 响应入队
+void response_queue_push(response_queue_t *queue, request_ctx_t *ctx);
+
+// 把队列中的响应收集到 iovec 数组（已跳过部分发送的字节），返回 iovec 数量
+int response_queue_gather(response_queue_t *queue, struct iovec *iov, int max_iov);
+
+// 记录已发送 bytes 字节，释放已完整发送的响应
+void response_queue_consume(response_queue_t *queue, size_t bytes);
+
+// 释放队列中所有响应
+void response_queue_clear(response_queue_t *queue);
+
+// 把节点移到空闲链表尾部并刷新活动时间
+void idle_list_touch(idle_list_t *list, idle_node_t *node, time_t now);
+
+// 从空闲链表中移除节点
+void idle_list_remove(idle_list_t *list, idle_node_t *node);
+
+#endif // REQUEST_H
@@ -0,0 +1,34 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include <time.h>
+#include "functions.h"
+
+// 按函数ID统计请求数、错误数、输入输出字节数和两种延迟分布：
+//   处理时间：调用处理函数的时间（批量请求按条目统计，流式请求为各数据块处理时间之和）
+//   端到端时间：从收到完整请求到响应全部写入 socket 的时间，包括线程池排队和发送队列等待（批量和流式请求不统计）
+// 计数器按线程分片，每个线程只写自己的分片，记录时没有共享写入；查询时合并所有分片
+
+#define STATS_FUNCTION_ID (RESERVED_FUNCTION_ID_BASE + 2) // 管理请求：输出统计信息（请求数据为 "json" 时输出 JSON，否则输出文本）
+
+// 单调时钟当前时间（纳秒）
+static inline uint64_t stats_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// 记录一次处理函数调用（未注册的函数ID不统计）
+void stats_record_call(int id, int status, uint64_t bytes_in, uint64_t bytes_out, uint64_t handler_ns);
+
+// 记录一个请求的端到端时间
+void stats_record_total(int id, uint64_t total_ns);
+
+// 输出所有函数的统计信息（json 非 0 时为 JSON），返回 STATUS_OK 或 STATUS_NO_MEMORY
+int stats_report(output_buffer_t *out, int json);
+
+// 开始统计并注册统计信息管理请求
+void stats_init();
+
+#endif // STATS_H
@@ -0,0 +1,26 @@
+#ifndef STRING_KERNELS_H
+#define STRING_KERNELS_H
+
+#include <stddef.h>
+
+// 内置处理函数使用的字符串内核：ASCII 大小写转换和字节反转。
+// 启动时根据 CPUID 选择 AVX2 / SSE2 实现，其他架构使用标量实现
+
+// 一组内核实现（dst 与 src 不能重叠）
+typedef struct {
+    const char *name;         // 实现名称
+    void (*upper)(char *dst, const char *src, size_t len);   // ASCII 转大写
+    void (*lower)(char *dst, const char *src, size_t len);   // ASCII 转小写
+    void (*reverse)(char *dst, const char *src, size_t len); // 字节反转
+} string_kernels_t;
+
+// 根据 CPU 特性选择最快的实现
+void string_kernels_init();
+
+// 当前选择的实现（未初始化时为标量实现）
+const string_kernels_t *string_kernels();
+
+// 当前 CPU 支持的所有实现（第一个为标量实现），返回数量；用于正确性测试和性能测试
+int string_kernels_available(const string_kernels_t **list, int max);
+
+#endif // STRING_KERNELS_H
@@ -0,0 +1,44 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stdint.h>
+
+#define DEFAULT_POOL_THREADS 16     // 默认工作线程数
+#define DEFAULT_POOL_QUEUE_SIZE 1024 // 默认任务队列容量
+
+// 任务函数类型定义
+typedef void (*task_fn_t)(void *arg);
+
+// 线程池（实现细节对外隐藏）
+typedef struct thread_pool thread_pool_t;
+
+// 线程池统计信息
+typedef struct {
+    uint32_t queue_depth;     // 当前排队任务数
+    uint32_t max_queue_depth; // 历史最大排队任务数
+    uint64_t submitted;       // 已提交任务总数
+    uint64_t completed;       // 已完成任务总数
+    uint64_t rejected;        // 因队列已满被拒绝的任务数
+    double avg_wait_ms;       // 平均排队等待时间（毫秒）
+    double max_wait_ms;       // 最大排队等待时间（毫秒）
+} thread_pool_stats_t;
+
+// 创建线程池并预先启动所有工作线程，失败返回 NULL
+thread_pool_t *thread_pool_create(int num_threads, int queue_size);
+
+// 提交任务，队列已满时阻塞等待；线程池已关闭时返回 -1
+int thread_pool_submit(thread_pool_t *pool, task_fn_t fn, void *arg);
+
+// 尝试提交任务，队列已满时立即返回 -1
+int thread_pool_try_submit(thread_pool_t *pool, task_fn_t fn, void *arg);
+
+// 获取统计信息
+void thread_pool_get_stats(thread_pool_t *pool, thread_pool_stats_t *stats);
+
+// 将统计信息写入日志
+void thread_pool_log_stats(thread_pool_t *pool);
+
+// 等待队列中的任务执行完毕后销毁线程池
+void thread_pool_destroy(thread_pool_t *pool);
+
+#endif // THREAD_POOL_H
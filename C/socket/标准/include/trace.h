@@ -0,0 +1,61 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include "common.h"
+#include "stats.h"
+
+// 请求分阶段跟踪：按单调时钟记录请求经过的各个时间点（纳秒）。
+// 请求头部带 FLAG_TRACE 时，各阶段耗时随响应返回给客户端（见 protocol.h）；
+// 开启采样后每 N 个请求采样一个，以 Chrome 跟踪事件格式写入文件（可用 chrome://tracing 或 Perfetto 打开）。
+// 未被跟踪的请求不读时钟
+
+// 时间点
+typedef enum {
+    TRACE_ACCEPT,         // 连接被接受（只记录在连接上的第一个请求中）
+    TRACE_HEADER,         // 请求头部接收完毕
+    TRACE_BODY,           // 请求数据接收完毕
+    TRACE_DISPATCH_START, // 开始调用处理函数（交给线程池时为工作线程取出请求的时间）
+    TRACE_DISPATCH_END,   // 处理函数返回
+    TRACE_FLUSHED,        // 响应全部写入 socket
+    TRACE_STAMP_COUNT
+} trace_stamp_t;
+
+#define TRACE_REPLY 0x01  // 各阶段耗时随响应返回
+#define TRACE_SAMPLE 0x02 // 写入跟踪文件
+
+// 一个请求的跟踪记录
+typedef struct {
+    int active;                     // TRACE_REPLY / TRACE_SAMPLE 的组合，0 表示不跟踪
+    uint64_t ns[TRACE_STAMP_COUNT]; // 各时间点，0 表示未记录
+    uint64_t queued_ns;             // 读取头部之前开始排队的时间，0 表示没有（见 trace_queued）
+} trace_t;
+
+// 开启采样：每 sample_every 个请求采样一个，追加写入 path；失败返回 -1
+int trace_init(const char *path, int sample_every);
+
+// 收到请求头部：决定是否跟踪该请求并记录头部接收时间；*accept_ns 为连接接受时间，
+// 只归入连接上的第一个请求（之后清零）
+void trace_begin(trace_t *trace, const header_t *header, uint64_t *accept_ns);
+
+// 请求在读取之前已经排队：线程池模式下连接可读后才交给线程池，工作线程取出后才读取头部。
+// submit_ns 为交给线程池的时间，从它到头部接收完毕的等待计入 queue 阶段而不是 connect 阶段
+void trace_queued(trace_t *trace, uint64_t submit_ns);
+
+// 记录时间点
+static inline void trace_stamp(trace_t *trace, int stamp) {
+    if (trace->active) {
+        trace->ns[stamp] = stats_now();
+    }
+}
+
+// 处理完成：要求返回阶段耗时的请求把耗时填入响应
+void trace_fill_response(const trace_t *trace, response_t *response);
+
+// 响应发送完毕：记录发送完成时间，采样的请求写入跟踪文件
+void trace_finish(trace_t *trace, const header_t *header);
+
+// 把缓冲的跟踪事件写入文件（由主线程定期调用）
+void trace_flush();
+
+#endif // TRACE_H
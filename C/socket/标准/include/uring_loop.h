@@ -0,0 +1,17 @@
+#ifndef URING_LOOP_H
+#define URING_LOOP_H
+
+#include "thread_pool.h"
+
+#define URING_ENTRIES 4096         // 提交队列长度（完成队列为其 4 倍）
+#define URING_BUF_COUNT 4096       // 接收缓冲区环中的缓冲区数量（必须是 2 的幂）
+#define URING_BUF_SIZE 4096        // 单个接收缓冲区大小
+
+// 检测内核是否支持所需的 io_uring 特性（多次 accept、多次 recv、缓冲区环）
+int uring_supported();
+
+// 运行基于 io_uring 的事件循环，出错时返回 -1
+// 处理函数的调度方式与 event_loop_run 相同
+int uring_loop_run(int listen_fd, thread_pool_t *pool);
+
+#endif // URING_LOOP_H
@@ -0,0 +1,36 @@
+#include <stdio.h>
+#include "include/plugin.h"
+
+// 示例插件：编译为 plugins/example_plugin.so，服务端以 -P plugins 启动时加载
+
+// 转换为十六进制文本
+static int to_hex(const char *input, uint32_t length, output_buffer_t *out, char *error_msg) {
+    static const char digits[] = "0123456789abcdef";
+    if (length > UINT32_MAX / 2) {
+        snprintf(error_msg, ERROR_MSG_SIZE, "Input too large");
+        return STATUS_INVALID_INPUT;
+    }
+    char *output = output_reserve(out, length * 2);
+    if (!output) {
+        return STATUS_NO_MEMORY;
+    }
+    for (uint32_t i = 0; i < length; i++) {
+        output[i * 2] = digits[(unsigned char)input[i] >> 4];
+        output[i * 2 + 1] = digits[(unsigned char)input[i] & 0x0F];
+    }
+    out->length += length * 2;
+    return STATUS_OK;
+}
+
+static const plugin_handler_t handlers[] = {
+    { 10, to_hex }, // ID 10：转换为十六进制文本
+};
+
+const plugin_info_t plugin_info = {
+    PLUGIN_ABI_VERSION,
+    "example",
+    handlers,
+    sizeof(handlers) / sizeof(handlers[0]),
+    NULL,
+    NULL
+};
@@ -0,0 +1,295 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "include/buffer_pool.h"
+#include "include/log.h"
+
+// 每个缓冲区前的隐藏头部，记录大小类，保证返回的指针 16 字节对齐
+typedef struct {
+    uint32_t size_class;      // BUFFER_POOL_CLASSES 表示超大缓冲区（直接 malloc）
+    uint32_t reserved[3];
+} buffer_header_t;
+
+// 空闲缓冲区链表节点，复用缓冲区本身的内存
+typedef struct free_node {
+    struct free_node *next;
+} free_node_t;
+
+// 线程缓存：每个线程独占，分配和释放都不加锁
+typedef struct thread_cache {
+    free_node_t *free[BUFFER_POOL_CLASSES];
+    uint32_t count[BUFFER_POOL_CLASSES];
+    uint64_t hits;
+    uint64_t global_hits;
+    uint64_t misses;
+    uint64_t oversize;
+    struct thread_cache *prev; // 所有线程缓存链表（用于汇总统计信息）
+    struct thread_cache *next;
+} thread_cache_t;
+
+// 全局池：线程缓存溢出时放入，线程缓存为空时从中补充
+typedef struct {
+    pthread_mutex_t mutex;
+    free_node_t *free;
+    uint32_t count;
+} global_class_t;
+
+static global_class_t global_pool[BUFFER_POOL_CLASSES] = {
+    [0 ... BUFFER_POOL_CLASSES - 1] = { PTHREAD_MUTEX_INITIALIZER, NULL, 0 }
+};
+
+static pthread_mutex_t registry_mutex = PTHREAD_MUTEX_INITIALIZER; // 保护线程缓存链表和已退出线程的统计
+static thread_cache_t *registry = NULL;
+static buffer_pool_stats_t retired;  // 已退出线程的统计信息
+static pthread_key_t cache_key;
+static pthread_once_t cache_key_once = PTHREAD_ONCE_INIT;
+static __thread thread_cache_t *tls_cache = NULL;
+
+// 统计计数只由所属线程写入，读取方可能在其他线程，用 relaxed 原子读写避免数据竞争
+#define STAT_INC(cache, field) \
+    __atomic_store_n(&(cache)->field, (cache)->field + 1, __ATOMIC_RELAXED)
+
+// 大小类对应的缓冲区大小
+static size_t class_size(int cls) {
+    return (size_t)1 << (BUFFER_POOL_MIN_SHIFT + 2 * cls);
+}
+
+// 计算 size 所属的大小类，超过最大大小类返回 -1
+static int size_class(size_t size) {
+    if (size <= ((size_t)1 << BUFFER_POOL_MIN_SHIFT)) {
+        return 0;
+    }
+    int bits = 64 - __builtin_clzll((unsigned long long)(size - 1)); // 向上取整的 log2
+    int cls = (bits - BUFFER_POOL_MIN_SHIFT + 1) / 2;
+    return cls < BUFFER_POOL_CLASSES ? cls : -1;
+}
+
+// 线程缓存中每个大小类最多保存的缓冲区数
+static uint32_t cache_limit(int cls) {
+    size_t limit = BUFFER_POOL_CACHE_BYTES / class_size(cls);
+    if (limit < 2) {
+        return 2;
+    }
+    return limit > 64 ? 64 : (uint32_t)limit;
+}
+
+// 全局池中每个大小类最多保存的缓冲区数
+static uint32_t global_limit(int cls) {
+    size_t limit = BUFFER_POOL_GLOBAL_BYTES / class_size(cls);
+    return limit < BUFFER_POOL_BATCH ? BUFFER_POOL_BATCH : (uint32_t)limit;
+}
+
+// 把线程缓存中的 n 个缓冲区归还全局池，全局池已满时直接释放
+static void spill(thread_cache_t *cache, int cls, uint32_t n) {
+    global_class_t *global = &global_pool[cls];
+    free_node_t *excess = NULL;
+
+    pthread_mutex_lock(&global->mutex);
+    uint32_t limit = global_limit(cls);
+    while (n-- > 0 && cache->free[cls]) {
+        free_node_t *node = cache->free[cls];
+        cache->free[cls] = node->next;
+        cache->count[cls]--;
+        if (global->count < limit) {
+            node->next = global->free;
+            global->free = node;
+            global->count++;
+        } else {
+            node->next = excess;
+            excess = node;
+        }
+    }
+    pthread_mutex_unlock(&global->mutex);
+
+    // 在锁外释放多余的缓冲区
+    while (excess) {
+        free_node_t *next = excess->next;
+        free((buffer_header_t *)excess - 1);
+        excess = next;
+    }
+}
+
+// 从全局池补充一批缓冲区到线程缓存，返回补充的数量
+static uint32_t refill(thread_cache_t *cache, int cls) {
+    global_class_t *global = &global_pool[cls];
+    uint32_t n = 0;
+
+    pthread_mutex_lock(&global->mutex);
+    while (n < BUFFER_POOL_BATCH && global->free) {
+        free_node_t *node = global->free;
+        global->free = node->next;
+        global->count--;
+        node->next = cache->free[cls];
+        cache->free[cls] = node;
+        n++;
+    }
+    pthread_mutex_unlock(&global->mutex);
+
+    cache->count[cls] += n;
+    return n;
+}
+
+// 线程退出时把缓存的缓冲区归还全局池，并保留统计信息
+static void cache_destructor(void *arg) {
+    thread_cache_t *cache = (thread_cache_t *)arg;
+    for (int cls = 0; cls < BUFFER_POOL_CLASSES; cls++) {
+        spill(cache, cls, cache->count[cls]);
+    }
+
+    pthread_mutex_lock(&registry_mutex);
+    retired.hits += cache->hits;
+    retired.global_hits += cache->global_hits;
+    retired.misses += cache->misses;
+    retired.oversize += cache->oversize;
+    if (cache->prev) {
+        cache->prev->next = cache->next;
+    } else {
+        registry = cache->next;
+    }
+    if (cache->next) {
+        cache->next->prev = cache->prev;
+    }
+    pthread_mutex_unlock(&registry_mutex);
+
+    tls_cache = NULL;
+    free(cache);
+}
+
+static void create_cache_key() {
+    pthread_key_create(&cache_key, cache_destructor);
+}
+
+// 获取当前线程的缓存，首次调用时创建并注册
+static thread_cache_t *get_cache() {
+    if (tls_cache) {
+        return tls_cache;
+    }
+    pthread_once(&cache_key_once, create_cache_key);
+
+    thread_cache_t *cache = (thread_cache_t *)calloc(1, sizeof(thread_cache_t));
+    if (!cache) {
+        return NULL;
+    }
+    pthread_mutex_lock(&registry_mutex);
+    cache->next = registry;
+    if (registry) {
+        registry->prev = cache;
+    }
+    registry = cache;
+    pthread_mutex_unlock(&registry_mutex);
+
+    pthread_setspecific(cache_key, cache);
+    tls_cache = cache;
+    return cache;
+}
+
+// 分配缓冲区
+void *buffer_alloc(size_t size) {
+    int cls = size_class(size);
+    thread_cache_t *cache = get_cache();
+
+    // 超过最大大小类，直接调用 malloc
+    if (cls < 0) {
+        buffer_header_t *header = (buffer_header_t *)malloc(sizeof(buffer_header_t) + size);
+        if (!header) {
+            return NULL;
+        }
+        header->size_class = BUFFER_POOL_CLASSES;
+        header->reserved[0] = (uint32_t)size; // 超大缓冲区记录实际大小（不超过 4GB）
+        if (cache) {
+            STAT_INC(cache, oversize);
+        }
+        return header + 1;
+    }
+
+    if (cache) {
+        // 优先从线程缓存分配，为空时从全局池补充一批
+        if (cache->free[cls]) {
+            STAT_INC(cache, hits);
+        } else if (refill(cache, cls) > 0) {
+            STAT_INC(cache, global_hits);
+        }
+        free_node_t *node = cache->free[cls];
+        if (node) {
+            cache->free[cls] = node->next;
+            cache->count[cls]--;
+            return node;
+        }
+        STAT_INC(cache, misses);
+    }
+
+    // 池中没有可用缓冲区，按大小类分配新的缓冲区，释放后进入池中
+    buffer_header_t *header = (buffer_header_t *)malloc(sizeof(buffer_header_t) + class_size(cls));
+    if (!header) {
+        return NULL;
+    }
+    header->size_class = cls;
+    return header + 1;
+}
+
+// 释放缓冲区
+void buffer_free(void *ptr) {
+    if (!ptr) {
+        return;
+    }
+    buffer_header_t *header = (buffer_header_t *)ptr - 1;
+    int cls = (int)header->size_class;
+    thread_cache_t *cache;
+    if (cls >= BUFFER_POOL_CLASSES || !(cache = get_cache())) {
+        free(header);
+        return;
+    }
+
+    // 放回线程缓存，超过上限时把一半归还全局池（生产者和消费者线程不同时缓冲区经全局池流转）
+    free_node_t *node = (free_node_t *)ptr;
+    node->next = cache->free[cls];
+    cache->free[cls] = node;
+    cache->count[cls]++;
+    uint32_t limit = cache_limit(cls);
+    if (cache->count[cls] > limit) {
+        spill(cache, cls, cache->count[cls] - limit / 2);
+    }
+}
+
+// 缓冲区实际大小
+size_t buffer_size(const void *ptr) {
+    const buffer_header_t *header = (const buffer_header_t *)ptr - 1;
+    if (header->size_class >= BUFFER_POOL_CLASSES) {
+        return header->reserved[0];
+    }
+    return class_size((int)header->size_class);
+}
+
+// 获取统计信息
+void buffer_pool_get_stats(buffer_pool_stats_t *stats) {
+    pthread_mutex_lock(&registry_mutex);
+    *stats = retired;
+    for (thread_cache_t *cache = registry; cache; cache = cache->next) {
+        stats->hits += __atomic_load_n(&cache->hits, __ATOMIC_RELAXED);
+        stats->global_hits += __atomic_load_n(&cache->global_hits, __ATOMIC_RELAXED);
+        stats->misses += __atomic_load_n(&cache->misses, __ATOMIC_RELAXED);
+        stats->oversize += __atomic_load_n(&cache->oversize, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&registry_mutex);
+
+    stats->cached = 0;
+    for (int cls = 0; cls < BUFFER_POOL_CLASSES; cls++) {
+        pthread_mutex_lock(&global_pool[cls].mutex);
+        stats->cached += global_pool[cls].count;
+        pthread_mutex_unlock(&global_pool[cls].mutex);
+    }
+}
+
+// 将统计信息写入日志
+void buffer_pool_log_stats() {
+    buffer_pool_stats_t stats;
+    buffer_pool_get_stats(&stats);
+    uint64_t total = stats.hits + stats.global_hits + stats.misses + stats.oversize;
+    LOG_INFO("Buffer pool: %llu allocs, hits %llu, global hits %llu, misses %llu, oversize %llu, "
+             "hit rate %.1f%%, global cached %llu",
+             (unsigned long long)total, (unsigned long long)stats.hits,
+             (unsigned long long)stats.global_hits, (unsigned long long)stats.misses,
+             (unsigned long long)stats.oversize,
+             total ? 100.0 * (stats.hits + stats.global_hits) / total : 0.0,
+             (unsigned long long)stats.cached);
+}
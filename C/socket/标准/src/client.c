@@ -4,277 +4,473 @@
 #include <unistd.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <errno.h>
 #include <pthread.h>
+#include <time.h>
 #include "include/common.h"
+#include "include/libclient.h"
 #include "include/log.h"
 #include "include/network.h"
+#include "include/protocol.h"
+#include "include/buffer_pool.h"
 
-// 重连服务端
-static int reconnect_to_server(client_request_t *request) {
-    int retry_count = 0;
-    int backoff = RETRY_INTERVAL; // 初始重连间隔
+#define PIPELINE_WINDOW 128 // 流水线模式的最大在途请求数（与服务端每个连接的 MAX_INFLIGHT_PER_CONN 相同）
 
-    while (retry_count < MAX_RETRY_ATTEMPTS) {
-        LOG_INFO("Attempting to reconnect to server (attempt %d/%d)...", retry_count + 1, MAX_RETRY_ATTEMPTS);
+// 流水线请求：在同一连接上连续发送请求，在途请求达到 PIPELINE_WINDOW 个后每收到一个响应再发送一个，
+// 服务端可能按完成顺序乱序返回，通过请求ID匹配；返回成功的请求数
+static int client_pipeline(client_request_t *request, int count) {
+    double start_time = get_current_time();
+    int succeeded = 0;
 
-        // 关闭旧的 socket（如果存在）
-        pthread_mutex_lock(&request->sock_mutex);
-        if (request->sock > 0) {
-            close(request->sock);
-            request->sock = -1;
-        }
+    if (request->sock <= 0 && reconnect_to_server(request) < 0) {
+        return 0;
+    }
 
-        // 创建新的 socket
-        request->sock = socket(AF_INET, SOCK_STREAM, 0);
-        if (request->sock < 0) {
-            LOG_ERROR("Failed to create socket");
-            pthread_mutex_unlock(&request->sock_mutex);
-            retry_count++;
-            sleep(backoff);
-            backoff = backoff * 2 + (rand() % 1000) / 1000.0; // 指数退避加随机 jitter
-            continue;
+    pthread_mutex_lock(&request->sock_mutex);
+    uint32_t first_id = request->request_id + 1;
+
+    // 不限制在途请求数时，服务端在途请求满后停止读取，而客户端仍在发送、不接收响应，双方的发送缓冲区
+    // 都被填满后互相等待；因此先发满窗口，之后发送和接收交替进行
+    int sent = 0;
+    for (int received = 0; received < sent || sent < count; received++) {
+        while (sent < count && sent - received < PIPELINE_WINDOW) {
+            header_t header;
+            header.length = request->data_len;
+            header.id = request->id;
+            header.mode = LONG_CONNECTION; // 流水线请求需要服务端保持连接
+            header.is_heartbeat = 0;
+            header.is_batch = 0;
+            header.is_stream = 0;
+            header.is_traced = 0;
+            header.request_id = ++request->request_id;
+            if (send_request(request->sock, &header, request->data) < 0) {
+                LOG_ERROR("Failed to send pipelined request %u", header.request_id);
+                count = sent; // 只等待已发送请求的响应
+                break;
+            }
+            sent++;
+        }
+        if (received == sent) {
+            break;
         }
 
-        // 连接服务端
-        struct sockaddr_in serv_addr;
-        memset(&serv_addr, 0, sizeof(serv_addr));
-        serv_addr.sin_family = AF_INET;
-        serv_addr.sin_addr.s_addr = inet_addr(SERVER_IP);
-        serv_addr.sin_port = htons(SERVER_PORT);
-
-        if (connect(request->sock, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
-            LOG_ERROR("Failed to connect to server");
-            pthread_mutex_unlock(&request->sock_mutex);
-            retry_count++;
-            sleep(backoff);
-            backoff = backoff * 2 + (rand() % 1000) / 1000.0; // 指数退避加随机 jitter
-            continue;
+        // 接收响应，响应顺序与请求顺序无关
+        response_t resp;
+        char *data;
+        if (receive_response(request->sock, &resp, &data) < 0) {
+            LOG_ERROR("Failed to receive pipelined response");
+            break;
         }
 
-        LOG_INFO("Reconnected to server successfully");
-        pthread_mutex_unlock(&request->sock_mutex);
-        return 0; // 重连成功
+        if (resp.request_id < first_id || resp.request_id >= first_id + (uint32_t)sent) {
+            printf("Error: unexpected response ID %u\n", resp.request_id);
+        } else if (resp.status == 0) {
+            printf("Received response [%u]: %s\n", resp.request_id, data);
+            succeeded++;
+        } else {
+            printf("Error [%u]: %s\n", resp.request_id, resp.error_msg);
+        }
+        buffer_free(data);
     }
+    pthread_mutex_unlock(&request->sock_mutex);
 
-    LOG_ERROR("Failed to reconnect to server after %d attempts", MAX_RETRY_ATTEMPTS);
-    return -1; // 重连失败
+    request->client_time = get_current_time() - start_time;
+    return succeeded;
 }
 
-// 心跳机制线程
-static void *heartbeat_thread(void *arg) {
-    client_request_t *request = (client_request_t *)arg;
-    const char *heartbeat_msg = "HEARTBEAT";
-    const char *expected_response = "ACK";
-    int bytes_received;
-    int heartbeat_timeout_count = 0; // 心跳超时计数器
+// 批量请求：把 count 个相同的子请求编码到一个批量帧中发送，响应中按顺序返回每个子请求的结果；
+// 返回成功的子请求数
+static int client_batch(client_request_t *request, int count) {
+    double start_time = get_current_time();
+    int succeeded = 0;
 
-    while (1) {
-        // 检查是否需要关闭连接
-        if (request->mode == SHORT_CONNECTION || request->sock <= 0) {
-            break;
-        }
+    if (count > MAX_BATCH_ENTRIES) {
+        printf("Error: batch size exceeds %d\n", MAX_BATCH_ENTRIES);
+        return 0;
+    }
+    batch_entry_t *entries = (batch_entry_t *)malloc(sizeof(batch_entry_t) * count);
+    if (!entries) {
+        return 0;
+    }
+    for (int i = 0; i < count; i++) {
+        entries[i].code = request->id;
+        entries[i].length = request->data_len;
+        entries[i].data = request->data;
+    }
+    uint32_t size = batch_encoded_size(entries, count);
+    char *frame = size ? (char *)buffer_alloc(size) : NULL;
+    if (!frame) {
+        printf("Error: batch too large\n");
+        free(entries);
+        return 0;
+    }
+    encode_batch(entries, count, frame);
+    free(entries);
 
-        // 组装心跳消息的头部
-        header_t header;
-        header.length = 0;
-        header.id = 0;
-        header.mode = request->mode;
-        header.is_heartbeat = 1;
-
-        // 发送心跳消息的头部
-        pthread_mutex_lock(&request->sock_mutex);
-        if (send_all(request->sock, &header, sizeof(header_t)) < 0) {
-            LOG_ERROR("Failed to send heartbeat header");
-            pthread_mutex_unlock(&request->sock_mutex);
-            if (reconnect_to_server(request) < 0) {
-                break; // 重连失败，退出心跳线程
-            }
-            continue;
-        }
+    if (request->sock <= 0 && reconnect_to_server(request) < 0) {
+        buffer_free(frame);
+        return 0;
+    }
 
-        // 发送心跳消息内容
-        if (send_all(request->sock, heartbeat_msg, strlen(heartbeat_msg)) < 0) {
-            LOG_ERROR("Failed to send heartbeat message");
-            pthread_mutex_unlock(&request->sock_mutex);
-            if (reconnect_to_server(request) < 0) {
-                break; // 重连失败，退出心跳线程
-            }
-            continue;
-        }
+    pthread_mutex_lock(&request->sock_mutex);
+    header_t header;
+    header.length = size;
+    header.id = 0; // 批量请求不使用头部中的函数ID
+    header.mode = request->mode;
+    header.is_heartbeat = 0;
+    header.is_batch = 1;
+    header.is_stream = 0;
+    header.is_traced = request->trace;
+    header.request_id = ++request->request_id;
 
-        // 设置接收超时时间
-        struct timeval timeout;
-        timeout.tv_sec = HEARTBEAT_INTERVAL + 1;
-        timeout.tv_usec = 0;
-        if (setsockopt(request->sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) < 0) {
-            LOG_ERROR("Setsockopt failed");
-            pthread_mutex_unlock(&request->sock_mutex);
-            if (reconnect_to_server(request) < 0) {
-                break; // 重连失败，退出心跳线程
-            }
-            continue;
+    response_t resp;
+    char *data = NULL;
+    if (send_request(request->sock, &header, frame) < 0) {
+        LOG_ERROR("Failed to send batch request");
+    } else if (receive_response(request->sock, &resp, &data) < 0) {
+        LOG_ERROR("Failed to receive batch response");
+    } else if (resp.status != 0) {
+        printf("Error: %s\n", resp.error_msg);
+    } else {
+        // 依次输出每个子请求的结果
+        uint32_t n, offset;
+        batch_entry_t entry;
+        if (decode_batch_count(data, resp.length, &n, &offset) < 0) {
+            printf("Error: malformed batch response\n");
+            n = 0;
         }
-
-        // 等待服务端响应
-        char response[10];
-        bytes_received = recv(request->sock, response, sizeof(response) - 1, 0);
-        pthread_mutex_unlock(&request->sock_mutex);
-        if (bytes_received <= 0) {
-            LOG_ERROR("No response to heartbeat, connection may be broken");
-            heartbeat_timeout_count++;
-            if (heartbeat_timeout_count > MAX_RETRY_ATTEMPTS) {
-                LOG_ERROR("Heartbeat timeout count exceeded, exiting heartbeat thread");
-                break; // 心跳超时次数超过限制，退出心跳线程
-            }
-            if (reconnect_to_server(request) < 0) {
-                break; // 重连失败，退出心跳线程
+        for (uint32_t i = 0; i < n; i++) {
+            if (decode_batch_entry(data, resp.length, &offset, &entry) < 0) {
+                printf("Error: malformed batch response\n");
+                break;
             }
-            continue;
-        }
-        response[bytes_received] = '\0';
-
-        // 检查响应是否正确
-        if (strcmp(response, expected_response) != 0) {
-            LOG_ERROR("Invalid heartbeat response");
-            if (reconnect_to_server(request) < 0) {
-                break; // 重连失败，退出心跳线程
+            if (entry.code == 0) {
+                printf("Received response [%u]: %.*s\n", i, (int)entry.length, entry.data);
+                succeeded++;
+            } else {
+                printf("Error [%u]: %.*s\n", i, (int)entry.length, entry.data);
             }
-            continue;
         }
-
-        // 重置心跳超时计数器
-        heartbeat_timeout_count = 0;
-
-        // 休眠心跳间隔时间
-        sleep(HEARTBEAT_INTERVAL);
+        request->server_time = resp.server_time;
+        request->traced = resp.traced;
+        memcpy(request->trace_ns, resp.trace_ns, sizeof(resp.trace_ns));
     }
+    pthread_mutex_unlock(&request->sock_mutex);
+    buffer_free(data);
+    buffer_free(frame);
 
-    // 关闭连接
-    pthread_mutex_lock(&request->sock_mutex);
-    if (request->sock > 0) {
-        close(request->sock);
-        request->sock = -1;
+    request->client_time = get_current_time() - start_time;
+    return succeeded;
+}
+
+// 流式请求的发送参数
+typedef struct {
+    int sock;
+    FILE *input;              // 不为 NULL 时从文件读取输入，否则发送 data
+    const char *data;
+    uint32_t data_len;
+    uint64_t sent;            // 已发送的输入字节数
+    int failed;
+} stream_sender_t;
+
+// 发送线程：输入按 CHUNK_SIZE 分块发送，最后发送结束块；与接收并行，避免双方发送缓冲区都满时互相等待
+static void *stream_send_thread(void *arg) {
+    stream_sender_t *sender = (stream_sender_t *)arg;
+    char buf[CHUNK_SIZE];
+    uint32_t offset = 0;
+    while (1) {
+        uint32_t n;
+        if (sender->input) {
+            n = fread(buf, 1, sizeof(buf), sender->input);
+        } else {
+            n = sender->data_len - offset < CHUNK_SIZE ? sender->data_len - offset : CHUNK_SIZE;
+            memcpy(buf, sender->data + offset, n);
+            offset += n;
+        }
+        if (send_chunk(sender->sock, buf, n) < 0) {
+            LOG_ERROR("Failed to send chunk");
+            sender->failed = 1;
+            break;
+        }
+        if (n == 0) {
+            break; // 已发送结束块
+        }
+        sender->sent += n;
     }
-    pthread_mutex_unlock(&request->sock_mutex);
-    request->heartbeat_tid = 0; // 线程结束，设置为无效值
     return NULL;
 }
 
-// 客户端请求函数
-void client_request(client_request_t *request) {
-    double start_time = get_current_time();  // 记录请求开始时间
+// 流式请求：输入（"-" 表示标准输入）分块发送，响应数据块到达后立即写到标准输出，统计信息写到标准错误；
+// 返回 0 表示成功
+static int client_stream(client_request_t *request, const char *input) {
+    double start_time = get_current_time();
+    stream_sender_t sender;
+    memset(&sender, 0, sizeof(sender));
+    if (strcmp(input, "-") == 0) {
+        sender.input = stdin;
+    } else {
+        sender.data = request->data;
+        sender.data_len = request->data_len;
+    }
 
-    // 检查socket fd是否有效
-    if (request->sock <= 0) {
-        if (reconnect_to_server(request) < 0) {
-            return; // 重连失败，直接返回
-        }
+    if (request->sock <= 0 && reconnect_to_server(request) < 0) {
+        return -1;
     }
+    sender.sock = request->sock;
 
-    // 组装请求包头部
     header_t header;
-    header.length = request->data_len;
+    header.length = 0; // 流式请求不使用头部中的长度
     header.id = request->id;
     header.mode = request->mode;
-    header.is_heartbeat = 0; // 标记为正常请求
-
-    // 发送头部
-    pthread_mutex_lock(&request->sock_mutex);
-    if (send_all(request->sock, &header, sizeof(header_t)) < 0) {
-        LOG_ERROR("Failed to send header");
-        pthread_mutex_unlock(&request->sock_mutex);
-        if (reconnect_to_server(request) < 0) {
-            return; // 重连失败，直接返回
-        }
-        pthread_mutex_lock(&request->sock_mutex);
+    header.is_heartbeat = 0;
+    header.is_batch = 0;
+    header.is_stream = 1;
+    header.is_traced = 0;
+    header.request_id = ++request->request_id;
+
+    pthread_t tid;
+    if (send_request(request->sock, &header, NULL) < 0 ||
+        pthread_create(&tid, NULL, stream_send_thread, &sender) != 0) {
+        LOG_ERROR("Failed to start stream request");
+        return -1;
     }
 
-    // 发送数据
-    if (send_all(request->sock, request->data, request->data_len) < 0) {
-        LOG_ERROR("Failed to send data");
-        pthread_mutex_unlock(&request->sock_mutex);
-        if (reconnect_to_server(request) < 0) {
-            return; // 重连失败，直接返回
+    // 接收响应头部：函数不存在等错误以普通失败响应返回
+    response_t resp;
+    char *data = NULL;
+    char *chunk = (char *)buffer_alloc(MAX_CHUNK_SIZE);
+    uint64_t received = 0;
+    double first_byte = 0;
+    int ret = -1;
+    int broken = 1; // 连接状态未知，需要中断发送线程
+    if (!chunk || receive_response(request->sock, &resp, &data) < 0) {
+        LOG_ERROR("Failed to receive stream response");
+    } else if (resp.status != 0) {
+        fprintf(stderr, "Error: %s\n", resp.error_msg);
+        broken = 0;
+    } else if (resp.length != STREAM_LENGTH) {
+        LOG_ERROR("Unexpected non-stream response");
+    } else {
+        // 依次输出数据块直到结束块
+        int n;
+        while ((n = receive_chunk(request->sock, chunk, &resp)) > 0) {
+            if (received == 0) {
+                first_byte = get_current_time() - start_time;
+            }
+            fwrite(chunk, 1, n, stdout);
+            received += n;
+        }
+        if (n < 0) {
+            LOG_ERROR("Failed to receive chunk");
+        } else if (resp.status != 0) {
+            fprintf(stderr, "Error: %s\n", resp.error_msg);
+            broken = 0;
+        } else {
+            ret = 0;
+            broken = 0;
         }
-        pthread_mutex_lock(&request->sock_mutex);
     }
+    if (broken) {
+        shutdown(request->sock, SHUT_RDWR);
+    }
+    fflush(stdout);
 
-    // 接收响应头部
-    response_t resp;
-    if (receive_all(request->sock, &resp, sizeof(response_t)) < 0) {
-        LOG_ERROR("Failed to receive response header");
-        pthread_mutex_unlock(&request->sock_mutex);
-        if (reconnect_to_server(request) < 0) {
-            return; // 重连失败，直接返回
+    // 处理函数出错时服务端会丢弃剩余的数据块，等待发送线程发完结束块
+    pthread_join(tid, NULL);
+    buffer_free(chunk);
+    buffer_free(data);
+    request->client_time = get_current_time() - start_time;
+    fprintf(stderr, "Streamed %llu bytes, received %llu bytes, first byte %f s, client time %f s\n",
+            (unsigned long long)sender.sent, (unsigned long long)received, first_byte, request->client_time);
+    return sender.failed ? -1 : ret;
+}
+
+// 连接池模式下每个线程的参数
+typedef struct {
+    client_pool_t *pool;
+    const client_request_t *request;
+    int count;                // 发送的请求数
+    int succeeded;            // 成功的请求数
+} pool_worker_t;
+
+static void *pool_worker(void *arg) {
+    pool_worker_t *worker = (pool_worker_t *)arg;
+    const client_request_t *request = worker->request;
+    for (int i = 0; i < worker->count; i++) {
+        client_result_t result;
+        if (client_pool_call(worker->pool, request->id, request->data, request->data_len, &result) == 0) {
+            worker->succeeded++;
+        } else {
+            printf("Error: %s\n", result.error_msg);
         }
-        pthread_mutex_lock(&request->sock_mutex);
+        buffer_free(result.response);
     }
+    return NULL;
+}
 
-    // 分配响应数据缓冲区，额外分配一个字节用于 null 终止符
-    request->response = (char *)malloc(resp.length + 1);
-    if (!request->response) {
-        LOG_ERROR("Failed to allocate memory for response data");
-        pthread_mutex_unlock(&request->sock_mutex);
-        close(request->sock);
-        request->sock = -1;
-        return;
+// 连接池模式：threads 个线程共享一个连接池，各自发送 count 个请求；返回成功的请求数
+static int client_pooled(client_request_t *request, int threads, int count) {
+    double start_time = get_current_time();
+    client_pool_config_t config = { .endpoints = request->endpoints };
+    client_pool_t *pool = client_pool_create(&config);
+    pool_worker_t *workers = (pool_worker_t *)calloc(threads, sizeof(pool_worker_t));
+    pthread_t *tids = (pthread_t *)calloc(threads, sizeof(pthread_t));
+    if (!pool || !workers || !tids) {
+        client_pool_destroy(pool);
+        free(workers);
+        free(tids);
+        return 0;
     }
 
-    // 接收响应数据
-    if (receive_all(request->sock, request->response, resp.length) < 0) {
-        LOG_ERROR("Failed to receive response data");
-        free(request->response);
-        request->response = NULL;
-        pthread_mutex_unlock(&request->sock_mutex);
-        if (reconnect_to_server(request) < 0) {
-            return; // 重连失败，直接返回
+    int started = 0;
+    for (; started < threads; started++) {
+        workers[started].pool = pool;
+        workers[started].request = request;
+        workers[started].count = count;
+        if (pthread_create(&tids[started], NULL, pool_worker, &workers[started]) != 0) {
+            LOG_ERROR("Failed to create pool worker thread");
+            break;
         }
-        pthread_mutex_lock(&request->sock_mutex);
     }
-
-    // 确保响应字符串以 null 结尾
-    request->response[resp.length] = '\0';
-
-    // 计算客户端响应时间
+    int succeeded = 0;
+    for (int i = 0; i < started; i++) {
+        pthread_join(tids[i], NULL);
+        succeeded += workers[i].succeeded;
+    }
     request->client_time = get_current_time() - start_time;
+    printf("Connections: %llu opened, %llu reused, %llu discarded (pool size %d)\n",
+           (unsigned long long)pool->connects, (unsigned long long)pool->reuses,
+           (unsigned long long)pool->discarded, pool->config.max_size);
+
+    client_pool_destroy(pool);
+    free(workers);
+    free(tids);
+    return succeeded;
+}
 
-    // 检查服务端返回的状态
-    if (resp.status == 0) {
-        // 请求成功
-        request->response_len = resp.length;
-        request->server_time = resp.server_time;
-        request->error_msg[0] = '\0'; // 清空错误信息
-        LOG_INFO("Request succeeded. Response: %s", request->response); // 添加成功日志
-    } else {
-        // 请求失败
-        request->response_len = 0;
-        request->server_time = 0;
-        strncpy(request->error_msg, resp.error_msg, ERROR_MSG_SIZE); // 返回错误信息
-        LOG_ERROR("Request failed. Error: %s", request->error_msg); // 添加失败日志
+// 异步模式：用 connections 个连接一次提交 count 个请求，再依次等待完成；返回成功的请求数
+static int client_async(client_request_t *request, int connections, int count) {
+    double start_time = get_current_time();
+    client_async_config_t config = { .connections = connections, .endpoints = request->endpoints };
+    client_async_t *async = client_async_create(&config);
+    client_call_t **calls = (client_call_t **)calloc(count, sizeof(client_call_t *));
+    if (!async || !calls) {
+        client_async_destroy(async);
+        free(calls);
+        return 0;
     }
 
-    // 根据连接模式决定是否启动心跳机制
-    if (request->mode == LONG_CONNECTION && request->heartbeat_tid == 0) {
-        pthread_t tid;
-        if (pthread_create(&tid, NULL, heartbeat_thread, request)) {
-            LOG_ERROR("Failed to create heartbeat thread");
-            pthread_mutex_unlock(&request->sock_mutex);
-            close(request->sock);
-            request->sock = -1;
-            return;
+    for (int i = 0; i < count; i++) {
+        calls[i] = client_async_submit(async, request->id, request->data, request->data_len, NULL, NULL);
+    }
+    int succeeded = 0;
+    for (int i = 0; i < count; i++) {
+        if (!calls[i]) {
+            printf("Error [%d]: failed to submit request\n", i);
+            continue;
+        }
+        client_call_wait(async, calls[i], 0);
+        const client_result_t *result = client_call_result(calls[i]);
+        if (result->status == 0) {
+            printf("Received response [%d]: %s\n", i, result->response);
+            succeeded++;
+        } else {
+            printf("Error [%d]: %s\n", i, result->error_msg);
         }
-        request->heartbeat_tid = tid;
-        pthread_detach(tid); // 分离线程，确保资源被正确释放
+        client_call_free(calls[i]);
     }
+    request->client_time = get_current_time() - start_time;
 
-    pthread_mutex_unlock(&request->sock_mutex);
+    client_async_destroy(async);
+    free(calls);
+    return succeeded;
+}
+
+// 输出服务端返回的各阶段耗时
+static void print_trace(const client_request_t *request) {
+    if (request->traced) {
+        printf("Server phases: connect %.3f us, read %.3f us, queue %.3f us, handler %.3f us\n",
+               request->trace_ns[0] / 1000.0, request->trace_ns[1] / 1000.0,
+               request->trace_ns[2] / 1000.0, request->trace_ns[3] / 1000.0);
+    }
 }
 
 int main(int argc, char *argv[]) {
-    if (argc < 3) {
-        printf("Usage: %s <id> <input>\n", argv[0]);
+    connection_mode_t mode = SHORT_CONNECTION;
+    int count = 1; // 请求次数
+    int pipeline = 0; // 是否使用流水线发送
+    int batch = 0; // 是否使用批量请求发送
+    int stream = 0; // 是否使用流式请求发送
+    int threads = 0; // 连接池模式的线程数，0 表示不使用连接池
+    int async_conns = 0; // 异步模式的连接数，0 表示不使用异步接口
+    const char *endpoint_list = NULL; // 服务端地址列表，NULL 表示 SERVER_IP:SERVER_PORT
+    balance_policy_t policy = BALANCE_ROUND_ROBIN;
+    int exit_code = 0;
+
+    int opt;
+    int trace = 0; // 是否要求服务端返回各阶段耗时
+    while ((opt = getopt(argc, argv, "lpbctn:j:a:e:B:")) != -1) {
+        switch (opt) {
+        case 'l':
+            mode = LONG_CONNECTION; // 长连接：所有请求复用同一个 TCP 连接
+            break;
+        case 'p':
+            mode = LONG_CONNECTION; // 流水线：所有请求先发出，再按请求ID收取响应
+            pipeline = 1;
+            break;
+        case 'b':
+            batch = 1; // 批量：所有请求编码到一个批量帧中，一次往返完成
+            break;
+        case 'c':
+            stream = 1; // 流式：输入分块发送，响应分块输出，适合超过 MAX_REQUEST_SIZE 的数据
+            break;
+        case 't':
+            trace = 1; // 跟踪：服务端在响应中返回连接、读取、排队和处理各阶段的耗时
+            break;
+        case 'n':
+            count = atoi(optarg);
+            break;
+        case 'a':
+            async_conns = atoi(optarg); // 异步：所有请求一次提交，由后台事件循环在少量连接上并发发送
+            if (async_conns <= 0) {
+                async_conns = 1;
+            }
+            break;
+        case 'j':
+            threads = atoi(optarg); // 连接池：多个线程共享连接池，各自发送 -n 个请求
+            if (threads <= 0) {
+                threads = 1;
+            }
+            break;
+        case 'e':
+            endpoint_list = optarg; // 多个服务端地址：host:port,host:port,...
+            break;
+        case 'B':
+            if (balance_policy_parse(optarg, &policy) < 0) { // 负载均衡策略：rr / least / p2c
+                printf("Invalid balance policy: %s (rr, least or p2c)\n", optarg);
+                return 1;
+            }
+            break;
+        default:
+            printf("Usage: %s [-l] [-p | -b | -c | -j threads | -a connections] [-t] [-n count] "
+                   "[-e host:port,...] [-B rr|least|p2c] <id> <input>\n", argv[0]);
+            return 1;
+        }
+    }
+    if (argc - optind < 2 || count <= 0 || pipeline + batch + stream + (threads > 0) + (async_conns > 0) > 1) {
+        printf("Usage: %s [-l] [-p | -b | -c | -j threads | -a connections] [-t] [-n count] "
+               "[-e host:port,...] [-B rr|least|p2c] <id> <input>\n", argv[0]);
+        return 1;
+    }
+
+    // 服务端地址集合
+    endpoint_set_t endpoints;
+    endpoints_init(&endpoints, policy);
+    if (endpoint_list ? endpoints_parse(&endpoints, endpoint_list) < 0
+                      : endpoints_add(&endpoints, SERVER_IP, SERVER_PORT) < 0) {
+        printf("Invalid endpoint list: %s\n", endpoint_list ? endpoint_list : SERVER_IP);
         return 1;
     }
 
@@ -283,42 +479,85 @@ int main(int argc, char *argv[]) {
 
     // 客户端请求参数初始化
     client_request_t request;
-    request.id = atoi(argv[1]); // 从命令行参数获取ID
-    request.data_len = strlen(argv[2]); // 从命令行参数获取输入数据
-    request.data = strdup(argv[2]); // 动态分配请求数据
+    request.id = atoi(argv[optind]); // 从命令行参数获取ID
+    request.request_id = 0;
+    request.data_len = strlen(argv[optind + 1]); // 从命令行参数获取输入数据
+    request.data = strdup(argv[optind + 1]); // 动态分配请求数据
     request.response = NULL;
     request.response_len = 0;
     request.server_time = 0;
     request.client_time = 0;
+    request.trace = trace;
+    request.traced = 0;
     request.error_msg[0] = '\0';
     request.sock = -1; // 初始化为无效值
-    request.mode = SHORT_CONNECTION; // 设置连接模式
+    request.mode = mode; // 设置连接模式
     request.heartbeat_tid = 0; // 初始化心跳线程ID
+    request.endpoints = &endpoints;
+    request.endpoint = NULL;
     pthread_mutex_init(&request.sock_mutex, NULL); // 初始化互斥锁
+    pthread_cond_init(&request.heartbeat_cond, NULL);
+
+    if (async_conns > 0) {
+        int succeeded = client_async(&request, async_conns, count);
+        printf("Async %d requests on %d connections, %d succeeded\n", count, async_conns, succeeded);
+        printf("Client time: %f s\n", request.client_time);
+        exit_code = succeeded == count ? 0 : 1;
+        count = 0;
+    } else if (threads > 0) {
+        int succeeded = client_pooled(&request, threads, count);
+        printf("Pooled %d threads x %d requests, %d succeeded\n", threads, count, succeeded);
+        printf("Client time: %f s\n", request.client_time);
+        exit_code = succeeded == threads * count ? 0 : 1;
+        count = 0;
+    } else if (pipeline) {
+        int succeeded = client_pipeline(&request, count);
+        printf("Pipelined %d requests, %d succeeded\n", count, succeeded);
+        printf("Client time: %f s\n", request.client_time);
+        count = 0;
+    } else if (stream) {
+        exit_code = client_stream(&request, argv[optind + 1]) == 0 ? 0 : 1;
+        count = 0;
+    } else if (batch) {
+        int succeeded = client_batch(&request, count);
+        printf("Batched %d requests, %d succeeded\n", count, succeeded);
+        printf("Server time: %f s\n", request.server_time);
+        printf("Client time: %f s\n", request.client_time);
+        print_trace(&request);
+        count = 0;
+    }
 
-    // 发送请求
-    client_request(&request);
+    for (int i = 0; i < count; i++) {
+        // 发送请求
+        client_request(&request);
 
-    // 处理响应
-    if (request.response_len > 0) {
-        printf("Received response: %s\n", request.response);
-    } else {
-        printf("Error: %s\n", request.error_msg);
-    }
+        // 处理响应
+        if (request.response_len > 0) {
+            printf("Received response: %s\n", request.response);
+        } else {
+            printf("Error: %s\n", request.error_msg);
+        }
+
+        // 输出客户端响应时间
+        printf("Client time: %f s\n", request.client_time);
+        print_trace(&request);
 
-    // 输出客户端响应时间
-    printf("Client time: %f s\n", request.client_time);
+        buffer_free(request.response);
+        request.response = NULL;
+        request.response_len = 0;
+
+        // 短连接每次请求后由服务端关闭，下次请求重新连接
+        if (mode == SHORT_CONNECTION && request.sock > 0) {
+            close(request.sock);
+            request.sock = -1;
+        }
+    }
 
     // 释放资源
+    client_close(&request);
     free(request.data);
-    free(request.response);
-    if (request.sock > 0) {
-        close(request.sock);
-    }
-    if (request.heartbeat_tid != 0) {
-        pthread_join(request.heartbeat_tid, NULL);
-    }
     pthread_mutex_destroy(&request.sock_mutex); // 销毁互斥锁
+    pthread_cond_destroy(&request.heartbeat_cond);
     log_cleanup();
-    return 0;
+    return exit_code;
 }
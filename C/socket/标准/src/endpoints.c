@@ -0,0 +1,267 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "include/common.h"
+#include "include/endpoints.h"
+#include "include/log.h"
+
+static endpoint_set_t default_set;
+static pthread_once_t default_once = PTHREAD_ONCE_INIT;
+static __thread uint64_t pick_random = 0; // P2C 使用的线程局部随机数状态
+
+static uint64_t monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// xorshift64* 随机数，首次使用时用时间和线程变量地址初始化
+static uint64_t next_random() {
+    if (pick_random == 0) {
+        pick_random = (monotonic_ns() ^ (uint64_t)(uintptr_t)&pick_random) | 1;
+    }
+    pick_random ^= pick_random >> 12;
+    pick_random ^= pick_random << 25;
+    pick_random ^= pick_random >> 27;
+    return pick_random * 2685821657736338717ULL;
+}
+
+// 初始化为空集合
+void endpoints_init(endpoint_set_t *set, balance_policy_t policy) {
+    memset(set, 0, sizeof(*set));
+    set->policy = policy;
+}
+
+// 添加地址
+int endpoints_add(endpoint_set_t *set, const char *host, int port) {
+    if (set->count == MAX_ENDPOINTS || port <= 0 || port > 65535) {
+        return -1;
+    }
+    endpoint_t *ep = &set->endpoints[set->count];
+    memset(ep, 0, sizeof(*ep));
+    ep->addr.sin_family = AF_INET;
+    ep->addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, host, &ep->addr.sin_addr) != 1) {
+        return -1;
+    }
+    snprintf(ep->name, sizeof(ep->name), "%s:%d", host, port);
+    set->count++;
+    return 0;
+}
+
+// 解析地址列表
+int endpoints_parse(endpoint_set_t *set, const char *list) {
+    char buf[1024];
+    snprintf(buf, sizeof(buf), "%s", list);
+    char *save = NULL;
+    for (char *item = strtok_r(buf, ",", &save); item; item = strtok_r(NULL, ",", &save)) {
+        int port = SERVER_PORT;
+        char *colon = strchr(item, ':');
+        if (colon) {
+            *colon = '\0';
+            port = atoi(colon + 1);
+        }
+        if (endpoints_add(set, item, port) < 0) {
+            return -1;
+        }
+    }
+    return set->count > 0 ? 0 : -1;
+}
+
+// 解析策略名称
+int balance_policy_parse(const char *name, balance_policy_t *policy) {
+    if (strcmp(name, "rr") == 0) {
+        *policy = BALANCE_ROUND_ROBIN;
+    } else if (strcmp(name, "least") == 0) {
+        *policy = BALANCE_LEAST_OUTSTANDING;
+    } else if (strcmp(name, "p2c") == 0) {
+        *policy = BALANCE_P2C;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+static void init_default_set() {
+    endpoints_init(&default_set, BALANCE_ROUND_ROBIN);
+    endpoints_add(&default_set, SERVER_IP, SERVER_PORT);
+}
+
+// 默认集合
+endpoint_set_t *endpoints_default() {
+    pthread_once(&default_once, init_default_set);
+    return &default_set;
+}
+
+// 地址是否可以选择：正常，或剔除已到期且没有其他请求在试探
+static int endpoint_available(const endpoint_t *ep, uint64_t now) {
+    if (__atomic_load_n(&ep->failures, __ATOMIC_ACQUIRE) == 0) {
+        return 1;
+    }
+    return now >= __atomic_load_n(&ep->ejected_until, __ATOMIC_ACQUIRE) &&
+           !__atomic_load_n(&ep->probing, __ATOMIC_ACQUIRE);
+}
+
+// 按策略选择地址
+endpoint_t *endpoints_pick(endpoint_set_t *set, uint32_t *tried) {
+    while (1) {
+        uint64_t now = monotonic_ns();
+        int candidates[MAX_ENDPOINTS];
+        int n = 0;
+        for (int i = 0; i < set->count; i++) {
+            if (!(*tried & (1u << i)) && endpoint_available(&set->endpoints[i], now)) {
+                candidates[n++] = i;
+            }
+        }
+        if (n == 0) {
+            return NULL;
+        }
+
+        int pick = candidates[0];
+        unsigned start = __atomic_fetch_add(&set->next, 1, __ATOMIC_RELAXED);
+        if (set->policy == BALANCE_ROUND_ROBIN) {
+            pick = candidates[start % n];
+        } else if (set->policy == BALANCE_LEAST_OUTSTANDING) {
+            // 从轮询位置开始比较，在途请求数相同时轮流选择
+            int best = -1;
+            for (int k = 0; k < n; k++) {
+                int i = candidates[(start + k) % n];
+                int outstanding = __atomic_load_n(&set->endpoints[i].outstanding, __ATOMIC_RELAXED);
+                if (best < 0 || outstanding < best) {
+                    best = outstanding;
+                    pick = i;
+                }
+            }
+        } else if (n > 1) {
+            int a = candidates[next_random() % n];
+            int b = candidates[next_random() % (n - 1)];
+            if (b == a) {
+                b = candidates[n - 1];
+            }
+            pick = __atomic_load_n(&set->endpoints[b].outstanding, __ATOMIC_RELAXED) <
+                   __atomic_load_n(&set->endpoints[a].outstanding, __ATOMIC_RELAXED) ? b : a;
+        }
+
+        endpoint_t *ep = &set->endpoints[pick];
+        *tried |= 1u << pick;
+        if (__atomic_load_n(&ep->failures, __ATOMIC_ACQUIRE) == 0) {
+            return ep;
+        }
+        // 剔除到期的地址只放行一个试探请求，其他请求继续选择别的地址
+        int expected = 0;
+        if (__atomic_compare_exchange_n(&ep->probing, &expected, 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            LOG_INFO("Probing endpoint %s", ep->name);
+            return ep;
+        }
+    }
+}
+
+// 剔除地址：剔除时间按连续失败次数翻倍
+void endpoint_failed(endpoint_t *ep) {
+    int failures = __atomic_add_fetch(&ep->failures, 1, __ATOMIC_ACQ_REL);
+    uint64_t eject_ms = EJECT_BASE_MS;
+    for (int i = 1; i < failures && eject_ms < EJECT_MAX_MS; i++) {
+        eject_ms *= 2;
+    }
+    if (eject_ms > EJECT_MAX_MS) {
+        eject_ms = EJECT_MAX_MS;
+    }
+    __atomic_store_n(&ep->ejected_until, monotonic_ns() + eject_ms * 1000000ULL, __ATOMIC_RELEASE);
+    __atomic_store_n(&ep->probing, 0, __ATOMIC_RELEASE);
+    LOG_ERROR("Endpoint %s failed %d times, ejected for %llu ms", ep->name, failures, (unsigned long long)eject_ms);
+}
+
+// 恢复被剔除的地址
+void endpoint_succeeded(endpoint_t *ep) {
+    if (__atomic_load_n(&ep->failures, __ATOMIC_ACQUIRE) != 0) {
+        __atomic_store_n(&ep->failures, 0, __ATOMIC_RELEASE);
+        __atomic_store_n(&ep->probing, 0, __ATOMIC_RELEASE);
+        LOG_INFO("Endpoint %s recovered", ep->name);
+    }
+}
+
+// 连接失败：关闭 socket 并剔除地址
+static void connect_failed(endpoint_t *ep, int fd, int err) {
+    LOG_ERROR("Failed to connect to %s: %s", ep->name, strerror(err));
+    close(fd);
+    endpoint_failed(ep);
+}
+
+// 开始非阻塞连接，不等待连接完成
+int endpoint_connect_start(endpoint_t *ep) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (fd < 0) {
+        LOG_ERROR("Failed to create socket");
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr *)&ep->addr, sizeof(ep->addr)) < 0 && errno != EINPROGRESS) {
+        connect_failed(ep, fd, errno);
+        return -1;
+    }
+    return fd;
+}
+
+// 完成连接：检查连接结果，成功时设置 TCP_NODELAY 并记录地址恢复
+int endpoint_connect_finish(endpoint_t *ep, int fd, int err) {
+    socklen_t len = sizeof(err);
+    if (err == 0 && getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0) {
+        err = errno;
+    }
+    if (err != 0) {
+        connect_failed(ep, fd, err);
+        return -1;
+    }
+
+    // 长连接上连续发送小包，关闭 Nagle 算法避免与延迟确认叠加产生 40ms 停顿
+    int nodelay = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+    endpoint_succeeded(ep);
+    return 0;
+}
+
+// 带超时的非阻塞连接
+int endpoint_connect(endpoint_set_t *set, endpoint_t *ep, int nonblocking) {
+    int fd = endpoint_connect_start(ep);
+    if (fd < 0) {
+        return -1;
+    }
+    struct pollfd pfd = { fd, POLLOUT, 0 };
+    int n;
+    while ((n = poll(&pfd, 1, endpoints_connect_timeout_ms(set))) < 0 && errno == EINTR) {
+    }
+    if (endpoint_connect_finish(ep, fd, n == 0 ? ETIMEDOUT : n < 0 ? errno : 0) < 0) {
+        return -1;
+    }
+    if (!nonblocking) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+    }
+    return fd;
+}
+
+// 放弃试探
+void endpoint_cancel_probe(endpoint_t *ep) {
+    __atomic_store_n(&ep->probing, 0, __ATOMIC_RELEASE);
+}
+
+// 依次选择地址并连接
+int endpoints_connect(endpoint_set_t *set, int nonblocking, endpoint_t **chosen) {
+    uint32_t tried = 0;
+    endpoint_t *ep;
+    while ((ep = endpoints_pick(set, &tried)) != NULL) {
+        int fd = endpoint_connect(set, ep, nonblocking);
+        if (fd >= 0) {
+            *chosen = ep;
+            return fd;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,339 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "include/common.h"
+#include "include/log.h"
+#include "include/protocol.h"
+#include "include/network.h"
+#include "include/request.h"
+#include "include/buffer_pool.h"
+#include "include/event_loop.h"
+
+// 每个连接的读写状态
+typedef struct connection {
+    idle_node_t idle;         // 空闲链表节点（按最近活动时间排序）
+    int fd;                   // 套接字描述符
+    request_reader_t reader;  // 请求解析状态和待发送的响应队列
+    int closed;               // 连接已关闭，等待处理中的请求结束后释放
+    struct connection *free_next; // 待释放链表
+} connection_t;
+
+// 事件循环上下文
+typedef struct event_loop {
+    int epoll_fd;             // epoll 实例
+    int listen_fd;            // 监听 socket
+    thread_pool_t *pool;      // 处理函数线程池（NULL 表示在事件循环线程中处理）
+    completion_queue_t cq;    // 线程池处理完成的请求
+    idle_list_t idle;         // 空闲连接链表
+    connection_t *free_list;  // 本轮事件处理结束后释放的连接
+} event_loop_t;
+
+// epoll 事件中用于区分监听 socket 和 eventfd 的标记
+static char listen_tag;
+static char event_tag;
+
+// 从空闲链表节点得到连接
+static connection_t *idle_to_conn(idle_node_t *node) {
+    return (connection_t *)((char *)node - offsetof(connection_t, idle));
+}
+
+// 释放连接结构体
+static void free_connection(connection_t *conn) {
+    request_reader_destroy(&conn->reader);
+    buffer_free(conn);
+}
+
+// 把连接放入待释放链表，同一轮 epoll 事件中可能还有指向它的事件
+static void defer_free_connection(event_loop_t *loop, connection_t *conn) {
+    conn->free_next = loop->free_list;
+    loop->free_list = conn;
+}
+
+// 关闭连接；仍有请求在线程池中处理时延迟到请求完成后释放
+static void close_connection(event_loop_t *loop, connection_t *conn) {
+    idle_list_remove(&loop->idle, &conn->idle);
+    epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+    close(conn->fd);
+    conn->closed = 1;
+    if (conn->reader.pending == 0) {
+        defer_free_connection(loop, conn);
+    }
+}
+
+// 读取数据直到 EAGAIN，推进状态机；返回 -1 表示需要关闭连接，
+// 返回 1 表示发送队列积压过多而暂停读取（发送后需要再次调用）
+static int handle_read(connection_t *conn) {
+    request_reader_t *reader = &conn->reader;
+    char discard[CHUNK_SIZE]; // 丢弃的数据
+    while (reader->state != CONN_READ_DONE && reader->pending < MAX_INFLIGHT_PER_CONN) {
+        if (reader->out.bytes >= MAX_QUEUED_BYTES) {
+            return 1; // 对端没有及时读取响应，暂停读取请求
+        }
+
+        // 头部和数据直接接收到解析状态机的缓冲区中
+        char *ptr;
+        uint32_t want;
+        if (request_reader_want(reader, &ptr, &want) < 0) {
+            return -1;
+        }
+        if (!ptr) {
+            ptr = discard;
+            if (want > sizeof(discard)) {
+                want = sizeof(discard);
+            }
+        }
+
+        ssize_t n = 0;
+        if (want > 0) {
+            n = recv(conn->fd, ptr, want, 0);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    return 0; // 数据已读完，等待下一次事件
+                }
+                LOG_ERROR("Failed to receive data");
+                return -1;
+            }
+            if (n == 0) {
+                // 对端关闭写方向：在请求之间时发送完已有响应后再关闭，否则直接关闭
+                if (request_reader_idle(reader)) {
+                    reader->state = CONN_READ_DONE;
+                    return 0;
+                }
+                return -1;
+            }
+        }
+        if (request_reader_advance(reader, (uint32_t)n) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// 发送队列中的响应直到 EAGAIN，多个响应合并为一次 sendmsg；返回 -1 表示出错
+static int handle_write(connection_t *conn) {
+    response_queue_t *out = &conn->reader.out;
+    while (out->head) {
+        struct iovec iov[MAX_WRITE_IOV];
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = response_queue_gather(out, iov, MAX_WRITE_IOV);
+
+        ssize_t n = sendmsg(conn->fd, &msg, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return 0; // 发送缓冲区已满，等待 EPOLLOUT
+            }
+            LOG_ERROR("Failed to send response");
+            return -1;
+        }
+        response_queue_consume(out, n);
+    }
+    return 0;
+}
+
+// 推进连接的读写；返回 -1 表示连接已关闭
+static int progress_connection(event_loop_t *loop, connection_t *conn) {
+    int throttled;
+    do {
+        throttled = handle_read(conn);
+        if (throttled < 0 || handle_write(conn) < 0) {
+            close_connection(loop, conn);
+            return -1;
+        }
+    } while (throttled && conn->reader.out.bytes < MAX_QUEUED_BYTES); // 积压已发出，继续读取
+
+    // 短连接或对端已关闭写方向：响应全部发送完毕后关闭
+    if (conn->reader.state == CONN_READ_DONE && conn->reader.pending == 0 && !conn->reader.out.head) {
+        close_connection(loop, conn);
+        return -1;
+    }
+    return 0;
+}
+
+// 接收所有待处理的新连接
+static void accept_connections(event_loop_t *loop) {
+    time_t now = time(NULL);
+    while (1) {
+        int conn_fd = accept4(loop->listen_fd, NULL, NULL, SOCK_NONBLOCK);
+        if (conn_fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                LOG_ERROR("Failed to accept connection: %s", strerror(errno));
+            }
+            return;
+        }
+
+        // 与线程池模式一致关闭 Nagle 算法，流水线上的小响应不等待延迟确认
+        int nodelay = 1;
+        setsockopt(conn_fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+        connection_t *conn = (connection_t *)buffer_alloc(sizeof(connection_t));
+        if (!conn) {
+            LOG_ERROR("Failed to allocate memory for connection");
+            close(conn_fd);
+            continue;
+        }
+        memset(conn, 0, sizeof(*conn));
+        conn->fd = conn_fd;
+        request_reader_init(&conn->reader, conn, loop->pool, &loop->cq);
+
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.ptr = conn;
+        if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, conn_fd, &ev) < 0) {
+            LOG_ERROR("Failed to add connection to epoll");
+            close(conn_fd);
+            buffer_free(conn);
+            continue;
+        }
+        idle_list_touch(&loop->idle, &conn->idle, now);
+    }
+}
+
+// 处理线程池完成的请求，把响应放入对应连接的发送队列
+static void handle_completions(event_loop_t *loop, time_t now) {
+    uint64_t value;
+    while (read(loop->cq.event_fd, &value, sizeof(value)) > 0) {
+    }
+
+    request_ctx_t *ctx = completion_queue_drain(&loop->cq);
+    while (ctx) {
+        request_ctx_t *next = ctx->next;
+        connection_t *conn = (connection_t *)ctx->conn;
+        conn->reader.pending--;
+
+        if (conn->closed) {
+            request_free(ctx);
+            if (conn->reader.pending == 0) {
+                defer_free_connection(loop, conn);
+            }
+        } else {
+            response_deliver(&conn->reader.out, &conn->reader.stream, ctx);
+            idle_list_touch(&loop->idle, &conn->idle, now);
+            progress_connection(loop, conn); // 发送响应，并在低于在途上限时恢复读取
+        }
+        ctx = next;
+    }
+}
+
+// 关闭超过空闲超时时间的连接（仍有请求在处理中的连接不算空闲）
+static void close_idle_connections(event_loop_t *loop, time_t now) {
+    while (loop->idle.head && now - loop->idle.head->last_active >= IDLE_TIMEOUT) {
+        connection_t *conn = idle_to_conn(loop->idle.head);
+        if (conn->reader.pending > 0) {
+            idle_list_touch(&loop->idle, &conn->idle, now);
+            continue;
+        }
+        LOG_INFO("Closing idle connection (fd %d)", conn->fd);
+        close_connection(loop, conn);
+    }
+}
+
+// 运行基于 epoll 的事件循环
+int event_loop_run(int listen_fd, thread_pool_t *pool) {
+    if (set_nonblocking(listen_fd) < 0) {
+        LOG_ERROR("Failed to set listen socket non-blocking");
+        return -1;
+    }
+
+    event_loop_t loop;
+    memset(&loop, 0, sizeof(loop));
+    loop.listen_fd = listen_fd;
+    loop.pool = pool;
+    if (completion_queue_init(&loop.cq) < 0) {
+        LOG_ERROR("Failed to create completion queue");
+        return -1;
+    }
+    loop.epoll_fd = epoll_create1(0);
+    if (loop.epoll_fd < 0) {
+        LOG_ERROR("Failed to create epoll instance");
+        completion_queue_destroy(&loop.cq);
+        return -1;
+    }
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.ptr = &listen_tag;
+    if (epoll_ctl(loop.epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev) < 0) {
+        LOG_ERROR("Failed to add listen socket to epoll");
+        close(loop.epoll_fd);
+        completion_queue_destroy(&loop.cq);
+        return -1;
+    }
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.ptr = &event_tag;
+    if (epoll_ctl(loop.epoll_fd, EPOLL_CTL_ADD, loop.cq.event_fd, &ev) < 0) {
+        LOG_ERROR("Failed to add eventfd to epoll");
+        close(loop.epoll_fd);
+        completion_queue_destroy(&loop.cq);
+        return -1;
+    }
+
+    struct epoll_event events[MAX_EPOLL_EVENTS];
+    time_t last_sweep = time(NULL);
+    while (1) {
+        int n = epoll_wait(loop.epoll_fd, events, MAX_EPOLL_EVENTS, 1000);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG_ERROR("epoll_wait failed");
+            break;
+        }
+
+        time_t now = time(NULL);
+        for (int i = 0; i < n; i++) {
+            void *ptr = events[i].data.ptr;
+            if (ptr == &listen_tag) {
+                accept_connections(&loop);
+            } else if (ptr == &event_tag) {
+                handle_completions(&loop, now);
+            } else {
+                connection_t *conn = (connection_t *)ptr;
+                if (conn->closed) {
+                    continue; // 本轮中已被关闭
+                }
+                if (events[i].events & EPOLLERR) {
+                    close_connection(&loop, conn);
+                    continue;
+                }
+                idle_list_touch(&loop.idle, &conn->idle, now);
+                progress_connection(&loop, conn);
+            }
+        }
+
+        // 每秒检查一次空闲连接
+        if (now != last_sweep) {
+            close_idle_connections(&loop, now);
+            last_sweep = now;
+        }
+
+        // 释放本轮关闭的连接
+        while (loop.free_list) {
+            connection_t *conn = loop.free_list;
+            loop.free_list = conn->free_next;
+            free_connection(conn);
+        }
+    }
+
+    close(loop.epoll_fd);
+    completion_queue_destroy(&loop.cq);
+    return -1;
+}
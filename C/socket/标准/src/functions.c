@@ -1,104 +1,585 @@
 #include "include/functions.h"
+#include "include/log.h"
+#include "include/protocol.h"
+#include "include/buffer_pool.h"
+#include "include/rcu.h"
+#include "include/string_kernels.h"
+#include "include/stats.h"
+#include <stdio.h>
 #include <string.h>
-#include <ctype.h>
 #include <stdlib.h>
+#include <pthread.h>
 
-// 定义最大数据长度和最大函数数量
-#define MAX_DATA_SIZE 4096
-#define MAX_FUNCTIONS 100
+#define MIN_TABLE_CAPACITY 64 // 分发表最小容量（必须是 2 的幂）
 
-// 函数注册表
-static function_t function_registry[MAX_FUNCTIONS];
-static int function_count = 0; // 当前注册的函数数量
+// 分发表：开放寻址哈希表，装载因子不超过 1/2；发布后只读，修改时复制出新表
+typedef struct {
+    uint32_t mask;            // 容量 - 1
+    uint32_t count;           // 已注册的函数数量
+    function_t *slots[];      // 函数项（发布后不再修改），NULL 表示空槽
+} dispatch_table_t;
+
+// 当前分发表，读取方在 RCU 读临界区内访问
+static dispatch_table_t *dispatch_table = NULL;
+static pthread_mutex_t registry_mutex = PTHREAD_MUTEX_INITIALIZER; // 串行化注册 / 替换 / 注销
+static uint64_t function_version = 0; // 最近分配的函数项版本（由 registry_mutex 保护）
+
+// 函数ID的哈希值
+static uint32_t hash_id(int id) {
+    return (uint32_t)id * 2654435761u;
+}
+
+// 在分发表中查找函数项
+static function_t *table_lookup(const dispatch_table_t *table, int id) {
+    uint32_t i = hash_id(id) & table->mask;
+    while (table->slots[i]) {
+        if (table->slots[i]->id == id) {
+            return table->slots[i];
+        }
+        i = (i + 1) & table->mask;
+    }
+    return NULL;
+}
+
+// 创建能容纳 count 个函数的空表
+static dispatch_table_t *table_create(uint32_t count) {
+    uint32_t capacity = MIN_TABLE_CAPACITY;
+    while (capacity < count * 2) {
+        capacity *= 2;
+    }
+    dispatch_table_t *table = (dispatch_table_t *)calloc(1, sizeof(dispatch_table_t) + capacity * sizeof(function_t *));
+    if (table) {
+        table->mask = capacity - 1;
+    }
+    return table;
+}
+
+// 插入函数项（调用方保证ID不存在且容量足够）
+static void table_insert(dispatch_table_t *table, function_t *func) {
+    uint32_t i = hash_id(func->id) & table->mask;
+    while (table->slots[i]) {
+        i = (i + 1) & table->mask;
+    }
+    table->slots[i] = func;
+    table->count++;
+}
 
 // 初始化函数注册表
 void init_function_registry() {
-    function_count = 0;
-    memset(function_registry, 0, sizeof(function_registry));
+    dispatch_table_t *table = table_create(0);
+    if (!table) {
+        LOG_ERROR("Failed to allocate dispatch table");
+        return;
+    }
+    __atomic_store_n(&dispatch_table, table, __ATOMIC_RELEASE);
 }
 
-// 注册新函数
+// 修改注册表：复制当前表并替换 id 对应的函数项（func 为 NULL 表示删除），
+// 原子发布新表后等待宽限期，再释放旧表和被替换的函数项
+static int update_function(int id, function_t *func, int allow_replace) {
+    pthread_mutex_lock(&registry_mutex);
+    dispatch_table_t *old_table = dispatch_table;
+    if (!old_table) {
+        pthread_mutex_unlock(&registry_mutex);
+        return -1;
+    }
+    function_t *old_func = table_lookup(old_table, id);
+    if ((old_func && func && !allow_replace) || (!old_func && !func)) {
+        pthread_mutex_unlock(&registry_mutex);
+        return old_func ? -2 : -1; // ID已存在 / 未找到
+    }
+
+    uint32_t count = old_table->count + (func ? 1 : 0) - (old_func ? 1 : 0);
+    dispatch_table_t *table = table_create(count);
+    if (!table) {
+        pthread_mutex_unlock(&registry_mutex);
+        return -1;
+    }
+    for (uint32_t i = 0; i <= old_table->mask; i++) {
+        if (old_table->slots[i] && old_table->slots[i] != old_func) {
+            table_insert(table, old_table->slots[i]);
+        }
+    }
+    if (func) {
+        func->version = ++function_version;
+        table_insert(table, func);
+    }
+
+    __atomic_store_n(&dispatch_table, table, __ATOMIC_RELEASE);
+    rcu_synchronize(); // 之后不再有读取方引用旧表和旧函数项
+    pthread_mutex_unlock(&registry_mutex);
+
+    free(old_table);
+    free(old_func);
+    return 0;
+}
+
+// 创建函数项并加入注册表
+static int add_function(int id, handler_v2_t handler, handler_t legacy, const stream_handler_t *stream,
+                        int allow_replace) {
+    function_t *func = (function_t *)malloc(sizeof(function_t));
+    if (!func) {
+        return -1;
+    }
+    func->id = id;
+    func->handler = handler;
+    func->legacy = legacy;
+    func->stream = stream;
+    int ret = update_function(id, func, allow_replace);
+    if (ret < 0) {
+        free(func);
+    }
+    return ret;
+}
+
+// 注册旧版处理函数
 int register_function(int id, handler_t handler) {
-    if (function_count >= MAX_FUNCTIONS) {
-        return -1; // 注册表已满
+    return add_function(id, NULL, handler, NULL, 0);
+}
+
+// 注册 v2 处理函数
+int register_function_v2(int id, handler_v2_t handler) {
+    return add_function(id, handler, NULL, NULL, 0);
+}
+
+// 注册或替换处理函数
+int replace_function_v2(int id, handler_v2_t handler) {
+    return add_function(id, handler, NULL, NULL, 1);
+}
+
+// 注册或替换支持流式请求的处理函数
+int register_function_stream(int id, handler_v2_t handler, const stream_handler_t *stream) {
+    if (!stream || !stream->process) {
+        return -1;
+    }
+    return add_function(id, handler, NULL, stream, 1);
+}
+
+// 恢复保存的函数项
+int restore_function(const function_t *func) {
+    return add_function(func->id, func->handler, func->legacy, func->stream, 1);
+}
+
+// 注销处理函数
+int unregister_function(int id) {
+    return update_function(id, NULL, 0);
+}
+
+// 确保输出缓冲区还能写入 extra 字节，容量不足时按倍数扩展
+char *output_reserve(output_buffer_t *out, uint32_t extra) {
+    if (extra > UINT32_MAX - out->length) {
+        return NULL; // 超过线路格式能表示的长度
+    }
+    uint32_t needed = out->length + extra;
+    if (needed > out->capacity) {
+        uint64_t capacity = (uint64_t)out->capacity * 2;
+        if (capacity < needed) {
+            capacity = needed;
+        }
+        if (capacity > UINT32_MAX) {
+            capacity = UINT32_MAX;
+        }
+        char *data = (char *)buffer_alloc(capacity);
+        if (!data) {
+            return NULL;
+        }
+        if (out->length > 0) {
+            memcpy(data, out->data, out->length);
+        }
+        buffer_free(out->data);
+        out->data = data;
+
+        // 缓冲区池按大小类分配，实际容量可能大于请求的容量
+        size_t actual = buffer_size(data);
+        out->capacity = actual > UINT32_MAX ? UINT32_MAX : (uint32_t)actual;
+    }
+    return out->data + out->length;
+}
+
+// 追加数据到输出缓冲区
+int output_append(output_buffer_t *out, const void *data, uint32_t length) {
+    char *dst = output_reserve(out, length);
+    if (!dst) {
+        return -1;
     }
+    memcpy(dst, data, length);
+    out->length += length;
+    return 0;
+}
 
-    // 检查ID是否已存在
-    for (int i = 0; i < function_count; i++) {
-        if (function_registry[i].id == id) {
-            return -2; // ID已存在
+// 旧版处理函数适配层：在输出缓冲区末尾预留 max(输入长度 * 2, MAX_DATA_SIZE) 字节（外加 null 终止符）；
+// 旧版处理函数要求输入以 null 结尾（只能看到第一个 NUL 之前的数据），批量条目没有终止符时先复制
+static int call_legacy_handler(handler_t legacy, const char *input, uint32_t length, int terminated,
+                               output_buffer_t *out) {
+    uint64_t size = (uint64_t)length * 2;
+    if (size < MAX_DATA_SIZE) {
+        size = MAX_DATA_SIZE;
+    }
+    char *output;
+    if (size >= UINT32_MAX || !(output = output_reserve(out, (uint32_t)size + 1))) {
+        return STATUS_NO_MEMORY;
+    }
+
+    char *copy = NULL;
+    if (!terminated) {
+        copy = (char *)buffer_alloc((size_t)length + 1);
+        if (!copy) {
+            return STATUS_NO_MEMORY;
         }
+        memcpy(copy, input, length);
+        copy[length] = '\0';
+        input = copy;
+    }
+    uint32_t written = 0;
+    legacy(input, output, &written);
+    out->length += written <= size ? written : (uint32_t)size;
+    buffer_free(copy);
+    return STATUS_OK;
+}
+
+// 只有流式处理函数时，普通请求的全部数据作为一个输入块处理
+static int call_stream_handler(const stream_handler_t *stream, const char *input, uint32_t length,
+                               output_buffer_t *out, char *error_msg) {
+    char *state = NULL;
+    if (stream->state_size > 0) {
+        if (!(state = (char *)buffer_alloc(stream->state_size))) {
+            return STATUS_NO_MEMORY;
+        }
+        memset(state, 0, stream->state_size);
+    }
+    int status = stream->process(state, input, length, out, error_msg);
+    if (status == STATUS_OK && stream->finish) {
+        status = stream->finish(state, out, error_msg);
     }
+    buffer_free(state);
+    return status;
+}
 
-    // 添加新函数
-    function_registry[function_count].id = id;
-    function_registry[function_count].handler = handler;
-    function_count++;
-    return 0; // 成功
+// 按ID调用处理函数，输出追加到 out（调用方必须处于 RCU 读临界区）
+static int invoke_handler(int id, const char *input, uint32_t length, int terminated,
+                          output_buffer_t *out, char *error_msg) {
+    function_t *func = get_function_by_id(id);
+    if (!func) {
+        snprintf(error_msg, ERROR_MSG_SIZE, "Unknown function ID: %d", id);
+        return STATUS_UNKNOWN_FUNCTION;
+    }
+    if (func->legacy) {
+        return call_legacy_handler(func->legacy, input, length, terminated, out);
+    }
+    if (!func->handler) {
+        return call_stream_handler(func->stream, input, length, out, error_msg);
+    }
+    return func->handler(input, length, out, error_msg);
 }
 
-// 根据ID获取函数
+// 根据ID获取函数（调用方必须处于 RCU 读临界区）
 function_t *get_function_by_id(int id) {
-    for (int i = 0; i < function_count; i++) {
-        if (function_registry[i].id == id) {
-            return &function_registry[i];
+    dispatch_table_t *table = __atomic_load_n(&dispatch_table, __ATOMIC_ACQUIRE);
+    return table ? table_lookup(table, id) : NULL;
+}
+
+// 批量请求：先校验整个批量帧，再依次处理每个条目；单个条目失败不影响其他条目
+static void dispatch_batch(const header_t *header, const char *data, response_t *response) {
+    uint32_t count, offset, first;
+    batch_entry_t entry;
+    int valid = decode_batch_count(data, header->length, &count, &first) == 0;
+    offset = first;
+    for (uint32_t i = 0; valid && i < count; i++) {
+        valid = decode_batch_entry(data, header->length, &offset, &entry) == 0;
+    }
+    if (!valid || offset != header->length) {
+        response->status = STATUS_INVALID_INPUT;
+        snprintf(response->error_msg, ERROR_MSG_SIZE, "Malformed batch request");
+        return;
+    }
+
+    output_buffer_t out = { NULL, 0, 0 };
+    char error_msg[ERROR_MSG_SIZE];
+    uint64_t start_ns = stats_now();
+    uint64_t mark_ns = start_ns;
+    int status = STATUS_OK;
+    if (!output_reserve(&out, 4 + count * BATCH_ENTRY_HEADER_SIZE)) {
+        status = STATUS_NO_MEMORY;
+    } else {
+        encode_batch_count(out.data, count);
+        out.length = 4;
+    }
+
+    rcu_read_lock();
+    offset = first;
+    for (uint32_t i = 0; status == STATUS_OK && i < count; i++) {
+        decode_batch_entry(data, header->length, &offset, &entry);
+
+        // 预留条目头部，处理结果直接追加在其后
+        uint32_t entry_start = out.length;
+        if (!output_reserve(&out, BATCH_ENTRY_HEADER_SIZE)) {
+            status = STATUS_NO_MEMORY;
+            break;
         }
+        out.length += BATCH_ENTRY_HEADER_SIZE;
+        error_msg[0] = '\0';
+        int entry_status = invoke_handler(entry.code, entry.data, entry.length, 0, &out, error_msg);
+
+        // 每个条目只读一次时钟：条目处理时间为与上一个条目结束时间之差
+        uint64_t now_ns = stats_now();
+        stats_record_call(entry.code, entry_status, entry.length, entry_status == STATUS_OK ?
+                          out.length - entry_start - BATCH_ENTRY_HEADER_SIZE : 0, now_ns - mark_ns);
+        mark_ns = now_ns;
+        if (entry_status != STATUS_OK) {
+            // 丢弃部分输出，改为返回错误信息
+            out.length = entry_start + BATCH_ENTRY_HEADER_SIZE;
+            if (error_msg[0] == '\0') {
+                snprintf(error_msg, ERROR_MSG_SIZE, "Handler failed with status %d", entry_status);
+            }
+            if (output_append(&out, error_msg, strnlen(error_msg, ERROR_MSG_SIZE)) < 0) {
+                status = STATUS_NO_MEMORY;
+                break;
+            }
+        }
+        encode_batch_entry(out.data + entry_start, entry_status,
+                           out.length - entry_start - BATCH_ENTRY_HEADER_SIZE);
+    }
+    rcu_read_unlock();
+    response->server_time = (stats_now() - start_ns) / 1e9;
+
+    if (status != STATUS_OK) {
+        response->status = status;
+        snprintf(response->error_msg, ERROR_MSG_SIZE, "Server out of memory");
+        buffer_free(out.data);
+        return;
     }
-    return NULL; // 未找到
+    response->data = out.data;
+    response->length = out.length;
 }
 
-// 处理函数实现
+// 根据请求头调用处理函数并填充响应包
+void dispatch_request(const header_t *header, const char *data, response_t *response) {
+    // 初始化响应包
+    response->status = 0; // 默认状态为成功
+    response->request_id = header->request_id; // 原样返回请求ID
+    memset(response->error_msg, 0, ERROR_MSG_SIZE);
+    response->length = 0;
+    response->server_time = 0;
+    response->traced = 0;
+    response->data = NULL;
+
+    // 心跳消息直接应答 ACK
+    if (header->is_heartbeat) {
+        response->data = (char *)buffer_alloc(sizeof(HEARTBEAT_ACK));
+        if (response->data) {
+            memcpy(response->data, HEARTBEAT_ACK, sizeof(HEARTBEAT_ACK));
+            response->length = strlen(HEARTBEAT_ACK);
+        }
+        return;
+    }
+
+    // 批量请求：依次调用每个子请求的处理函数，结果合并为一个响应
+    if (header->is_batch) {
+        dispatch_batch(header, data, response);
+        return;
+    }
+
+    // 根据ID调用处理函数，输出缓冲区由处理函数按需扩展；处理函数执行完毕前注册表不会释放该函数项
+    output_buffer_t out = { NULL, 0, 0 };
+    uint64_t start_ns = stats_now();
+    rcu_read_lock();
+    int status = invoke_handler(header->id, data, header->length, 1, &out, response->error_msg);
+    rcu_read_unlock();
+    uint64_t handler_ns = stats_now() - start_ns;
+    response->server_time = handler_ns / 1e9;
+    stats_record_call(header->id, status, header->length, status == STATUS_OK ? out.length : 0, handler_ns);
+
+    if (status != STATUS_OK) {
+        LOG_ERROR("Handler %d failed with status %d", header->id, status);
+        response->status = status;
+        if (response->error_msg[0] == '\0') {
+            snprintf(response->error_msg, ERROR_MSG_SIZE, status == STATUS_NO_MEMORY ? "Server out of memory"
+                     : "Handler failed with status %d", status);
+        }
+        buffer_free(out.data);
+        return;
+    }
+    response->data = out.data;
+    response->length = out.length;
+}
+
+// 开始流式请求：只记录函数项版本并分配状态，处理函数在每个输入块到达时重新查找，
+// 因此插件可以在流式请求进行中卸载（此后的输入块返回错误）
+int stream_open(stream_t *stream, int id, char *error_msg) {
+    stream->id = id;
+    stream->state = NULL;
+    stream->status = STATUS_OK;
+    stream->bytes_in = 0;
+    stream->bytes_out = 0;
+    stream->handler_ns = 0;
+
+    rcu_read_lock();
+    function_t *func = get_function_by_id(id);
+    uint32_t state_size = func && func->stream ? func->stream->state_size : 0;
+    int status = STATUS_OK;
+    if (!func) {
+        snprintf(error_msg, ERROR_MSG_SIZE, "Unknown function ID: %d", id);
+        status = STATUS_UNKNOWN_FUNCTION;
+    } else if (!func->stream) {
+        snprintf(error_msg, ERROR_MSG_SIZE, "Function %d does not support streaming", id);
+        status = STATUS_INVALID_INPUT;
+    } else {
+        stream->version = func->version;
+    }
+    rcu_read_unlock();
+
+    if (status == STATUS_OK && state_size > 0) {
+        if (!(stream->state = buffer_alloc(state_size))) {
+            snprintf(error_msg, ERROR_MSG_SIZE, "Server out of memory");
+            return STATUS_NO_MEMORY;
+        }
+        memset(stream->state, 0, state_size);
+    }
+    return status;
+}
+
+// 调用流式处理函数的 process（input 不为 NULL）或 finish（input 为 NULL）
+static int stream_call(stream_t *stream, const char *input, uint32_t length, output_buffer_t *out, char *error_msg) {
+    uint64_t start_ns = stats_now();
+    rcu_read_lock();
+    function_t *func = get_function_by_id(stream->id);
+    int status = STATUS_OK;
+    if (!func || func->version != stream->version) {
+        snprintf(error_msg, ERROR_MSG_SIZE, "Function %d was replaced during the stream", stream->id);
+        status = STATUS_HANDLER_ERROR;
+    } else if (input) {
+        status = func->stream->process(stream->state, input, length, out, error_msg);
+    } else if (func->stream->finish) {
+        status = func->stream->finish(stream->state, out, error_msg);
+    }
+    rcu_read_unlock();
+
+    if (status == STATUS_OK && out->length > MAX_CHUNK_SIZE) {
+        snprintf(error_msg, ERROR_MSG_SIZE, "Stream output exceeds %d bytes per chunk", MAX_CHUNK_SIZE);
+        status = STATUS_HANDLER_ERROR;
+    }
+    if (status != STATUS_OK && error_msg[0] == '\0') {
+        snprintf(error_msg, ERROR_MSG_SIZE, "Handler failed with status %d", status);
+    }
+
+    // 整个流式请求在关闭时作为一次调用统计
+    stream->handler_ns += stats_now() - start_ns;
+    stream->bytes_in += length;
+    if (status == STATUS_OK) {
+        stream->bytes_out += out->length;
+    } else {
+        stream->status = status;
+    }
+    return status;
+}
+
+// 处理一个输入块
+int stream_process(stream_t *stream, const char *input, uint32_t length, output_buffer_t *out, char *error_msg) {
+    return stream_call(stream, input, length, out, error_msg);
+}
+
+// 输入结束
+int stream_finish(stream_t *stream, output_buffer_t *out, char *error_msg) {
+    return stream_call(stream, NULL, 0, out, error_msg);
+}
+
+// 释放流式请求状态
+void stream_close(stream_t *stream) {
+    stats_record_call(stream->id, stream->status, stream->bytes_in, stream->bytes_out, stream->handler_ns);
+    buffer_free(stream->state);
+    stream->state = NULL;
+}
+
+// 处理函数实现：输入按长度处理，可以包含 NUL 字节；大小写转换和反转使用按 CPU 特性选择的向量化内核
 
 // 字符串反转
-void str_reverse(const char *input, char *output, uint32_t *length) {
-    size_t len = strlen(input);
-    for (size_t i = 0; i < len; i++) {
-        output[i] = input[len - 1 - i];
+static int str_reverse(const char *input, uint32_t length, output_buffer_t *out, char *error_msg) {
+    char *output = output_reserve(out, length);
+    if (!output) {
+        return STATUS_NO_MEMORY;
     }
-    output[len] = '\0';
-    *length = len;
+    string_kernels()->reverse(output, input, length);
+    out->length += length;
+    return STATUS_OK;
 }
 
-// 字符串转大写
-void str_upper(const char *input, char *output, uint32_t *length) {
-    size_t len = strlen(input);
-    for (size_t i = 0; i < len; i++) {
-        output[i] = toupper(input[i]);
+// 字符串转大写（ASCII）
+static int str_upper(const char *input, uint32_t length, output_buffer_t *out, char *error_msg) {
+    char *output = output_reserve(out, length);
+    if (!output) {
+        return STATUS_NO_MEMORY;
     }
-    output[len] = '\0';
-    *length = len;
+    string_kernels()->upper(output, input, length);
+    out->length += length;
+    return STATUS_OK;
 }
 
-// 字符串转小写
-void str_lower(const char *input, char *output, uint32_t *length) {
-    size_t len = strlen(input);
-    for (size_t i = 0; i < len; i++) {
-        output[i] = tolower(input[i]);
+// 字符串转小写（ASCII）
+static int str_lower(const char *input, uint32_t length, output_buffer_t *out, char *error_msg) {
+    char *output = output_reserve(out, length);
+    if (!output) {
+        return STATUS_NO_MEMORY;
     }
-    output[len] = '\0';
-    *length = len;
+    string_kernels()->lower(output, input, length);
+    out->length += length;
+    return STATUS_OK;
+}
+
+// 计算字符串长度（字节数，直接使用头部中的长度，不扫描数据）
+static int str_length(const char *input, uint32_t length, output_buffer_t *out, char *error_msg) {
+    char text[16];
+    int n = snprintf(text, sizeof(text), "%u", length);
+    return output_append(out, text, n) == 0 ? STATUS_OK : STATUS_NO_MEMORY;
 }
 
-// 计算字符串长度
-void str_length(const char *input, char *output, uint32_t *length) {
-    size_t len = strlen(input);
-    snprintf(output, MAX_DATA_SIZE, "%zu", len);  // 确保输出格式正确
-    *length = strlen(output);
-    output[*length] = '\0'; // 确保 null 终止
+// 流式处理：大小写转换逐块进行，长度在输入结束时输出
+
+static int stream_upper(void *state, const char *input, uint32_t length, output_buffer_t *out, char *error_msg) {
+    return str_upper(input, length, out, error_msg);
+}
+
+static int stream_lower(void *state, const char *input, uint32_t length, output_buffer_t *out, char *error_msg) {
+    return str_lower(input, length, out, error_msg);
 }
 
-// 字符串拼接
-void str_concat(const char *input, char *output, uint32_t *length) {
-    snprintf(output, MAX_DATA_SIZE, "%s_%s", input, input);
-    *length = strlen(output);
-    output[*length] = '\0'; // 确保 null 终止
+static int stream_length(void *state, const char *input, uint32_t length, output_buffer_t *out, char *error_msg) {
+    *(uint64_t *)state += length;
+    return STATUS_OK;
+}
+
+static int stream_length_finish(void *state, output_buffer_t *out, char *error_msg) {
+    char text[24];
+    int n = snprintf(text, sizeof(text), "%llu", (unsigned long long)*(uint64_t *)state);
+    return output_append(out, text, n) == 0 ? STATUS_OK : STATUS_NO_MEMORY;
+}
+
+static const stream_handler_t upper_stream = { 0, stream_upper, NULL };
+static const stream_handler_t lower_stream = { 0, stream_lower, NULL };
+static const stream_handler_t length_stream = { sizeof(uint64_t), stream_length, stream_length_finish };
+
+// 字符串拼接：输出 "<input>_<input>"
+static int str_concat(const char *input, uint32_t length, output_buffer_t *out, char *error_msg) {
+    if (length > (UINT32_MAX - 1) / 2) {
+        snprintf(error_msg, ERROR_MSG_SIZE, "Input too large to concatenate");
+        return STATUS_INVALID_INPUT;
+    }
+    if (!output_reserve(out, length * 2 + 1)) {
+        return STATUS_NO_MEMORY;
+    }
+    output_append(out, input, length);
+    output_append(out, "_", 1);
+    output_append(out, input, length);
+    return STATUS_OK;
 }
 
 // 初始化默认函数
 void init_default_functions() {
-    register_function(1, str_reverse); // ID 1：字符串反转
-    register_function(2, str_upper);   // ID 2：字符串转大写
-    register_function(3, str_lower);   // ID 3：字符串转小写
-    register_function(4, str_length);  // ID 4：计算字符串长度
-    register_function(5, str_concat);  // ID 5：字符串拼接
+    string_kernels_init();
+    LOG_INFO("String kernels: %s", string_kernels()->name);
+
+    register_function_v2(1, str_reverse); // ID 1：字符串反转
+    register_function_stream(2, str_upper, &upper_stream);   // ID 2：字符串转大写（支持流式请求）
+    register_function_stream(3, str_lower, &lower_stream);   // ID 3：字符串转小写（支持流式请求）
+    register_function_stream(4, str_length, &length_stream); // ID 4：计算字符串长度（支持流式请求）
+    register_function_v2(5, str_concat);  // ID 5：字符串拼接
 }
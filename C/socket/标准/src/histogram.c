@@ -0,0 +1,54 @@
+#include "include/histogram.h"
+
+// 桶内的最大值
+static uint64_t hist_bucket_value(int index) {
+    if (index < HIST_SUB) {
+        return (uint64_t)index;
+    }
+    int shift = index / HIST_SUB - 1;
+    return ((uint64_t)(HIST_SUB + index % HIST_SUB) << shift) + ((1ULL << shift) - 1);
+}
+
+// 合并延迟分布
+void hist_merge(histogram_t *dst, const histogram_t *src) {
+    dst->count += __atomic_load_n(&src->count, __ATOMIC_RELAXED);
+    dst->sum += __atomic_load_n(&src->sum, __ATOMIC_RELAXED);
+    uint64_t max = __atomic_load_n(&src->max, __ATOMIC_RELAXED);
+    if (max > dst->max) {
+        dst->max = max;
+    }
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        dst->buckets[i] += __atomic_load_n(&src->buckets[i], __ATOMIC_RELAXED);
+    }
+}
+
+// 分位数；合并时各计数不是同一时刻的快照，按桶累计的总数为准
+uint64_t hist_percentile(const histogram_t *hist, double quantile) {
+    uint64_t total = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        total += hist->buckets[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    // 第 ceil(quantile * total) 个值所在的桶
+    uint64_t target = (uint64_t)(quantile * total);
+    if (target < quantile * total || target == 0) {
+        target++;
+    }
+    uint64_t seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += hist->buckets[i];
+        if (seen >= target) {
+            uint64_t value = hist_bucket_value(i);
+            return value < hist->max ? value : hist->max;
+        }
+    }
+    return hist->max;
+}
+
+// 平均值
+double hist_mean(const histogram_t *hist) {
+    return hist->count ? (double)hist->sum / hist->count : 0;
+}
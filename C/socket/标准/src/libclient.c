@@ -0,0 +1,1356 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include "include/libclient.h"
+#include "include/log.h"
+#include "include/network.h"
+#include "include/protocol.h"
+#include "include/buffer_pool.h"
+
+// 重连服务端
+int reconnect_to_server(client_request_t *request) {
+    endpoint_set_t *set = request->endpoints ? request->endpoints : endpoints_default();
+    int backoff_ms = RETRY_INTERVAL_MS; // 初始重连间隔
+
+    for (int retry_count = 0; retry_count < MAX_RETRY_ATTEMPTS; retry_count++) {
+        LOG_INFO("Attempting to reconnect to server (attempt %d/%d)...", retry_count + 1, MAX_RETRY_ATTEMPTS);
+
+        // 关闭旧的 socket（如果存在），按策略依次连接可用的地址
+        pthread_mutex_lock(&request->sock_mutex);
+        if (request->sock > 0) {
+            close(request->sock);
+            request->sock = -1;
+        }
+        endpoint_t *endpoint = NULL;
+        request->sock = endpoints_connect(set, 0, &endpoint);
+        if (request->sock >= 0) {
+            request->endpoint = endpoint;
+            LOG_INFO("Reconnected to server %s successfully", endpoint->name);
+            pthread_mutex_unlock(&request->sock_mutex);
+            return 0; // 重连成功
+        }
+        pthread_mutex_unlock(&request->sock_mutex);
+
+        // 所有地址都不可用：指数退避，实际间隔在 [backoff/2, backoff] 之间随机，避免多个客户端同时重连
+        LOG_ERROR("No server endpoint available");
+        if (retry_count + 1 < MAX_RETRY_ATTEMPTS) {
+            int sleep_ms = backoff_ms / 2 + rand() % (backoff_ms / 2 + 1);
+            struct timespec delay = { sleep_ms / 1000, (long)(sleep_ms % 1000) * 1000000 };
+            nanosleep(&delay, NULL);
+            backoff_ms *= 2;
+        }
+    }
+
+    LOG_ERROR("Failed to reconnect to server after %d attempts", MAX_RETRY_ATTEMPTS);
+    return -1; // 重连失败
+}
+
+// 心跳机制线程
+static void *heartbeat_thread(void *arg) {
+    client_request_t *request = (client_request_t *)arg;
+    int heartbeat_timeout_count = 0; // 心跳超时计数器
+
+    while (1) {
+        // 检查是否需要关闭连接
+        pthread_mutex_lock(&request->sock_mutex);
+        if (request->mode == SHORT_CONNECTION || request->sock <= 0) {
+            pthread_mutex_unlock(&request->sock_mutex);
+            break;
+        }
+
+        // 组装心跳消息的头部
+        header_t header;
+        header.length = strlen(HEARTBEAT_MSG);
+        header.id = 0;
+        header.mode = request->mode;
+        header.is_heartbeat = 1;
+        header.is_batch = 0;
+        header.is_stream = 0;
+        header.is_traced = 0;
+        header.request_id = 0; // 心跳消息不占用请求ID
+
+        // 发送心跳消息（头部 + 内容）
+        if (send_request(request->sock, &header, HEARTBEAT_MSG) < 0) {
+            LOG_ERROR("Failed to send heartbeat message");
+            pthread_mutex_unlock(&request->sock_mutex);
+            if (reconnect_to_server(request) < 0) {
+                break; // 重连失败，退出心跳线程
+            }
+            continue;
+        }
+
+        // 设置接收超时时间
+        struct timeval timeout;
+        timeout.tv_sec = HEARTBEAT_INTERVAL + 1;
+        timeout.tv_usec = 0;
+        if (setsockopt(request->sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) < 0) {
+            LOG_ERROR("Setsockopt failed");
+            pthread_mutex_unlock(&request->sock_mutex);
+            if (reconnect_to_server(request) < 0) {
+                break; // 重连失败，退出心跳线程
+            }
+            continue;
+        }
+
+        // 等待服务端响应（响应头部 + ACK）
+        response_t resp;
+        char *ack = NULL;
+        int ok = receive_response(request->sock, &resp, &ack) == 0 && ack != NULL;
+        pthread_mutex_unlock(&request->sock_mutex);
+        if (!ok) {
+            LOG_ERROR("No response to heartbeat, connection may be broken");
+            heartbeat_timeout_count++;
+            if (heartbeat_timeout_count > MAX_RETRY_ATTEMPTS) {
+                LOG_ERROR("Heartbeat timeout count exceeded, exiting heartbeat thread");
+                break; // 心跳超时次数超过限制，退出心跳线程
+            }
+            if (reconnect_to_server(request) < 0) {
+                break; // 重连失败，退出心跳线程
+            }
+            continue;
+        }
+
+        // 检查响应是否正确
+        int valid = strcmp(ack, HEARTBEAT_ACK) == 0;
+        buffer_free(ack);
+        if (!valid) {
+            LOG_ERROR("Invalid heartbeat response");
+            if (reconnect_to_server(request) < 0) {
+                break; // 重连失败，退出心跳线程
+            }
+            continue;
+        }
+
+        // 重置心跳超时计数器
+        heartbeat_timeout_count = 0;
+
+        // 休眠心跳间隔时间，关闭连接时会被提前唤醒
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += HEARTBEAT_INTERVAL;
+        pthread_mutex_lock(&request->sock_mutex);
+        while (request->mode == LONG_CONNECTION &&
+               pthread_cond_timedwait(&request->heartbeat_cond, &request->sock_mutex, &deadline) == 0) {
+        }
+        pthread_mutex_unlock(&request->sock_mutex);
+    }
+
+    // 关闭连接
+    pthread_mutex_lock(&request->sock_mutex);
+    if (request->sock > 0) {
+        close(request->sock);
+        request->sock = -1;
+    }
+    pthread_mutex_unlock(&request->sock_mutex);
+    return NULL;
+}
+
+// 关闭长连接：通知心跳线程退出并等待其结束
+void client_close(client_request_t *request) {
+    pthread_mutex_lock(&request->sock_mutex);
+    request->mode = SHORT_CONNECTION;
+    pthread_cond_signal(&request->heartbeat_cond);
+    pthread_mutex_unlock(&request->sock_mutex);
+
+    if (request->heartbeat_tid != 0) {
+        pthread_join(request->heartbeat_tid, NULL);
+        request->heartbeat_tid = 0;
+    }
+    if (request->sock > 0) {
+        close(request->sock);
+        request->sock = -1;
+    }
+}
+
+// 客户端请求函数
+void client_request(client_request_t *request) {
+    double start_time = get_current_time();  // 记录请求开始时间
+
+    // 检查socket fd是否有效
+    if (request->sock <= 0) {
+        if (reconnect_to_server(request) < 0) {
+            snprintf(request->error_msg, ERROR_MSG_SIZE, "No server endpoint available");
+            return; // 重连失败，直接返回
+        }
+    }
+
+    // 组装请求包头部
+    header_t header;
+    header.length = request->data_len;
+    header.id = request->id;
+    header.mode = request->mode;
+    header.is_heartbeat = 0; // 标记为正常请求
+    header.is_batch = 0;
+    header.is_stream = 0;
+    header.is_traced = request->trace;
+
+    // 发送请求；发送失败时剔除当前地址，重连（切换到其他地址）后重发一次
+    pthread_mutex_lock(&request->sock_mutex);
+    header.request_id = ++request->request_id; // 分配新的请求ID
+    if (send_request(request->sock, &header, request->data) < 0) {
+        LOG_ERROR("Failed to send request");
+        if (request->endpoint) {
+            endpoint_failed(request->endpoint);
+        }
+        pthread_mutex_unlock(&request->sock_mutex);
+        if (reconnect_to_server(request) < 0) {
+            return; // 重连失败，直接返回
+        }
+        pthread_mutex_lock(&request->sock_mutex);
+        if (send_request(request->sock, &header, request->data) < 0) {
+            LOG_ERROR("Failed to resend request");
+            endpoint_failed(request->endpoint);
+            pthread_mutex_unlock(&request->sock_mutex);
+            return;
+        }
+    }
+
+    // 接收响应（成功时响应数据以 null 结尾），期间计入该地址的在途请求数
+    endpoint_t *endpoint = request->endpoint;
+    if (endpoint) {
+        endpoint_acquire(endpoint);
+    }
+    response_t resp;
+    int received = receive_response(request->sock, &resp, &request->response);
+    if (endpoint) {
+        endpoint_release(endpoint);
+    }
+    if (received < 0) {
+        LOG_ERROR("Failed to receive response");
+        snprintf(request->error_msg, ERROR_MSG_SIZE, "Failed to receive response");
+        if (endpoint) {
+            endpoint_failed(endpoint);
+        }
+        close(request->sock);
+        request->sock = -1;
+        pthread_mutex_unlock(&request->sock_mutex);
+        return;
+    }
+
+    // 计算客户端响应时间
+    request->client_time = get_current_time() - start_time;
+    request->traced = resp.traced;
+    memcpy(request->trace_ns, resp.trace_ns, sizeof(resp.trace_ns));
+
+    // 检查响应是否对应本次请求
+    if (resp.request_id != header.request_id) {
+        resp.status = 1;
+        snprintf(resp.error_msg, ERROR_MSG_SIZE, "Mismatched response ID: expected %u, got %u",
+                 header.request_id, resp.request_id);
+    }
+
+    // 检查服务端返回的状态
+    if (resp.status == 0) {
+        // 请求成功
+        request->response_len = resp.length;
+        request->server_time = resp.server_time;
+        request->error_msg[0] = '\0'; // 清空错误信息
+        LOG_INFO("Request succeeded. Response: %s", request->response); // 添加成功日志
+    } else {
+        // 请求失败
+        request->response_len = 0;
+        request->server_time = 0;
+        strncpy(request->error_msg, resp.error_msg, ERROR_MSG_SIZE); // 返回错误信息
+        LOG_ERROR("Request failed. Error: %s", request->error_msg); // 添加失败日志
+    }
+
+    // 根据连接模式决定是否启动心跳机制
+    if (request->mode == LONG_CONNECTION && request->heartbeat_tid == 0) {
+        pthread_t tid;
+        if (pthread_create(&tid, NULL, heartbeat_thread, request)) {
+            LOG_ERROR("Failed to create heartbeat thread");
+            pthread_mutex_unlock(&request->sock_mutex);
+            close(request->sock);
+            request->sock = -1;
+            return;
+        }
+        request->heartbeat_tid = tid; // 由 client_close 等待线程结束
+    }
+
+    pthread_mutex_unlock(&request->sock_mutex);
+}
+
+// 单调时钟（秒），用于判断连接空闲时间
+static double monotonic_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// 健康检查：空闲连接上不应有可读数据，可读说明对端已关闭（或发来了意外的数据）；
+// 只是一次非阻塞的 recv，不需要往返
+static int conn_healthy(const client_conn_t *conn) {
+    char byte;
+    ssize_t n = recv(conn->sock, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+    return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+// 关闭并释放连接
+static void conn_free(client_conn_t *conn) {
+    close(conn->sock);
+    free(conn);
+}
+
+// 创建连接池
+client_pool_t *client_pool_create(const client_pool_config_t *config) {
+    client_pool_t *pool = (client_pool_t *)calloc(1, sizeof(client_pool_t));
+    if (!pool) {
+        return NULL;
+    }
+    if (config) {
+        pool->config = *config;
+    }
+    if (!pool->config.host) {
+        pool->config.host = SERVER_IP;
+    }
+    if (pool->config.port <= 0) {
+        pool->config.port = SERVER_PORT;
+    }
+    if (pool->config.max_size <= 0) {
+        pool->config.max_size = POOL_DEFAULT_SIZE;
+    }
+    if (pool->config.max_idle_ms <= 0) {
+        pool->config.max_idle_ms = POOL_MAX_IDLE_MS;
+    }
+    pool->endpoints = pool->config.endpoints;
+    if (!pool->endpoints) {
+        endpoints_init(&pool->own_endpoints, BALANCE_ROUND_ROBIN);
+        if (endpoints_add(&pool->own_endpoints, pool->config.host, pool->config.port) < 0) {
+            LOG_ERROR("Invalid server address %s:%d", pool->config.host, pool->config.port);
+            free(pool);
+            return NULL;
+        }
+        pool->endpoints = &pool->own_endpoints;
+    }
+
+    // 等待归还的超时使用单调时钟，不受系统时间调整影响
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&pool->returned, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&pool->mutex, NULL);
+    return pool;
+}
+
+// 释放连接池
+void client_pool_destroy(client_pool_t *pool) {
+    if (!pool) {
+        return;
+    }
+    if (pool->total != pool->idle_count) {
+        LOG_ERROR("Destroying pool with %d connections still checked out", pool->total - pool->idle_count);
+    }
+    while (pool->idle) {
+        client_conn_t *conn = pool->idle;
+        pool->idle = conn->next;
+        conn_free(conn);
+    }
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->returned);
+    free(pool);
+}
+
+// 从空闲连接中取出到 endpoint 的最近归还的连接（endpoint 为 NULL 时取到任意未被剔除地址的连接），
+// 途中遇到的空闲过久或已被对端关闭的连接直接关闭。调用时持有 pool->mutex
+static client_conn_t *pool_take_idle(client_pool_t *pool, endpoint_t *endpoint) {
+    double now = monotonic_seconds();
+    client_conn_t **link = &pool->idle;
+    while (*link) {
+        client_conn_t *conn = *link;
+        if ((now - conn->last_used) * 1000 >= pool->config.max_idle_ms || !conn_healthy(conn)) {
+            *link = conn->next;
+            pool->idle_count--;
+            pool->total--;
+            pool->discarded++;
+            conn_free(conn);
+            continue;
+        }
+        if (endpoint ? conn->endpoint == endpoint : __atomic_load_n(&conn->endpoint->failures, __ATOMIC_ACQUIRE) == 0) {
+            *link = conn->next;
+            pool->idle_count--;
+            conn->next = NULL;
+            return conn;
+        }
+        link = &conn->next;
+    }
+    return NULL;
+}
+
+// 借出连接
+client_conn_t *client_pool_checkout(client_pool_t *pool) {
+    struct timespec deadline;
+    if (pool->config.checkout_timeout_ms > 0) {
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += pool->config.checkout_timeout_ms / 1000;
+        deadline.tv_nsec += (long)(pool->config.checkout_timeout_ms % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+    }
+
+    uint32_t tried = 0; // 本轮已经连接失败的地址
+    pthread_mutex_lock(&pool->mutex);
+    while (1) {
+        // 按策略选择地址；所有地址都被剔除或连接失败时放弃
+        endpoint_t *endpoint = endpoints_pick(pool->endpoints, &tried);
+        if (!endpoint) {
+            pthread_mutex_unlock(&pool->mutex);
+            LOG_ERROR("No server endpoint available for pooled connection");
+            return NULL;
+        }
+        int probing = __atomic_load_n(&endpoint->failures, __ATOMIC_ACQUIRE) != 0;
+
+        // 优先使用到该地址的最近归还的连接
+        client_conn_t *conn = pool_take_idle(pool, endpoint);
+        if (conn) {
+            pool->reuses++;
+            pthread_mutex_unlock(&pool->mutex);
+            conn->probing = probing;
+            endpoint_acquire(endpoint);
+            return conn;
+        }
+
+        // 未达到上限时在锁外建立新连接（先占用名额），连接失败的地址已被剔除，换下一个地址
+        if (pool->total < pool->config.max_size) {
+            pool->total++;
+            pool->connects++;
+            pthread_mutex_unlock(&pool->mutex);
+
+            conn = (client_conn_t *)calloc(1, sizeof(client_conn_t));
+            int sock = conn ? endpoint_connect(pool->endpoints, endpoint, 0) : -1;
+            if (sock >= 0) {
+                conn->sock = sock;
+                conn->endpoint = endpoint;
+                conn->probing = probing;
+                endpoint_acquire(endpoint);
+                return conn;
+            }
+            if (!conn && probing) {
+                endpoint_cancel_probe(endpoint);
+            }
+            free(conn);
+            pthread_mutex_lock(&pool->mutex);
+            pool->total--;
+            pthread_cond_signal(&pool->returned);
+            if (!conn) {
+                pthread_mutex_unlock(&pool->mutex);
+                return NULL;
+            }
+            continue;
+        }
+
+        // 达到上限：使用到其他正常地址的空闲连接（不再试探选中的地址）
+        if (probing) {
+            endpoint_cancel_probe(endpoint);
+        }
+        conn = pool_take_idle(pool, NULL);
+        if (conn) {
+            pool->reuses++;
+            pthread_mutex_unlock(&pool->mutex);
+            conn->probing = 0;
+            endpoint_acquire(conn->endpoint);
+            return conn;
+        }
+
+        // 没有空闲连接：等待其他线程归还，之后重新选择地址
+        int rc = pool->config.checkout_timeout_ms > 0
+                 ? pthread_cond_timedwait(&pool->returned, &pool->mutex, &deadline)
+                 : pthread_cond_wait(&pool->returned, &pool->mutex);
+        if (rc == ETIMEDOUT) {
+            pthread_mutex_unlock(&pool->mutex);
+            LOG_ERROR("Timed out waiting for a pooled connection");
+            return NULL;
+        }
+        tried = 0;
+    }
+}
+
+// 归还连接
+void client_pool_return(client_pool_t *pool, client_conn_t *conn, int broken) {
+    endpoint_release(conn->endpoint);
+    int probing = conn->probing;
+    conn->probing = 0;
+    if (broken) {
+        // 试探中的连接失败时调用方不一定剔除了地址（复用的连接失败、响应ID不匹配），
+        // 必须结束试探，否则地址一直处于试探状态，再也不会被选中
+        if (probing) {
+            endpoint_cancel_probe(conn->endpoint);
+        }
+        conn_free(conn);
+        pthread_mutex_lock(&pool->mutex);
+        pool->total--;
+    } else {
+        endpoint_succeeded(conn->endpoint);
+        conn->last_used = monotonic_seconds();
+        pthread_mutex_lock(&pool->mutex);
+        conn->next = pool->idle;
+        pool->idle = conn;
+        pool->idle_count++;
+    }
+    pthread_cond_signal(&pool->returned);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+// 借出连接、完成一次请求、归还连接
+int client_pool_call(client_pool_t *pool, int id, const char *data, uint32_t length, client_result_t *result) {
+    double start_time = get_current_time();
+    memset(result, 0, sizeof(*result));
+    result->status = -1;
+
+    // 每次失败都关闭一个连接（新连接失败时还剔除其地址），重试次数不超过连接池大小
+    for (int attempt = 0; attempt <= pool->config.max_size; attempt++) {
+        client_conn_t *conn = client_pool_checkout(pool);
+        if (!conn) {
+            snprintf(result->error_msg, ERROR_MSG_SIZE, "No connection available");
+            break;
+        }
+        int reused = conn->request_id != 0;
+
+        header_t header;
+        memset(&header, 0, sizeof(header));
+        header.length = length;
+        header.id = id;
+        header.mode = LONG_CONNECTION;
+        header.request_id = ++conn->request_id;
+
+        response_t resp;
+        char *response = NULL;
+        if (send_request(conn->sock, &header, data) < 0 || receive_response(conn->sock, &resp, &response) < 0) {
+            // 复用的连接失败可能只是服务端关闭了该连接，不剔除地址
+            if (!reused) {
+                endpoint_failed(conn->endpoint);
+            }
+            LOG_INFO("Pooled connection to %s failed, retrying on another connection", conn->endpoint->name);
+            client_pool_return(pool, conn, 1);
+            snprintf(result->error_msg, ERROR_MSG_SIZE, "Connection failed");
+            continue;
+        }
+        if (resp.request_id != header.request_id) {
+            client_pool_return(pool, conn, 1);
+            buffer_free(response);
+            snprintf(result->error_msg, ERROR_MSG_SIZE, "Mismatched response ID: expected %u, got %u",
+                     header.request_id, resp.request_id);
+            break;
+        }
+        client_pool_return(pool, conn, 0);
+
+        result->status = resp.status;
+        if (resp.status == 0) {
+            result->response = response;
+            result->response_len = resp.length;
+            result->server_time = resp.server_time;
+        } else {
+            buffer_free(response);
+            snprintf(result->error_msg, ERROR_MSG_SIZE, "%s", resp.error_msg);
+        }
+        break;
+    }
+    result->client_time = get_current_time() - start_time;
+    return result->status;
+}
+
+#define ASYNC_SLOT_MASK ((1u << ASYNC_SLOT_BITS) - 1)
+#define ASYNC_READ_SIZE 65536     // 每次接收的缓冲区大小
+#define ASYNC_MAX_EVENTS 64
+
+// 异步请求
+struct client_call {
+    header_t header;          // 请求头部（请求ID在分配连接时确定）
+    char *data;               // 请求数据的副本，写入连接的发送缓冲区后释放
+    client_callback_t callback;
+    void *arg;
+    int done;                 // 没有回调的请求是否已完成（受 async->mutex 保护）
+    double start_time;
+    client_result_t result;
+    struct client_call *next; // 提交队列 / 排队队列 / 完成列表
+};
+
+// 异步客户端的一个连接（只由事件循环线程访问）
+typedef struct {
+    int fd;                   // -1 表示未连接
+    endpoint_t *endpoint;     // 连接的地址
+    int connecting;           // 非阻塞连接是否尚未完成（期间请求只写入发送缓冲区）
+    double connect_deadline;  // 连接超时时间（单调时钟）
+    uint32_t tried;           // 本次建立连接已尝试过的地址
+    double retry_at;          // 没有可用地址时下次尝试连接的时间（单调时钟）
+    char *wbuf;               // 待发送的请求
+    size_t wlen;
+    size_t wcap;
+    size_t wsent;             // 已发送的字节数
+    int want_out;             // 是否在监听 EPOLLOUT
+    client_call_t **slots;    // 在途请求，按请求ID的低位索引
+    uint32_t *slot_ids;       // 各槽位上请求的完整ID
+    uint32_t *free_slots;     // 空闲槽位栈
+    int free_count;
+    int inflight;             // 在途请求数
+    uint32_t seq;             // 请求ID的高位，每次分配递增
+    uint8_t head[WIRE_RESPONSE_MAX]; // 正在接收的响应头部
+    uint32_t head_len;
+    uint32_t head_need;       // 头部长度（带阶段耗时时更长）
+    int in_body;              // 是否正在接收响应数据
+    response_t resp;          // 已解码的响应头部
+    char *body;               // 成功响应的数据
+    uint32_t body_got;        // 已接收的响应数据字节数
+    char error[ERROR_MSG_SIZE]; // 失败响应的错误信息（超出部分丢弃）
+} async_conn_t;
+
+struct client_async {
+    client_async_config_t config;
+    endpoint_set_t own_endpoints; // 没有配置 endpoints 时由 host 和 port 组成的集合
+    endpoint_set_t *endpoints;
+    async_conn_t *conns;
+    unsigned next;            // 轮询策略下一个连接的位置（只由事件循环访问）
+    int epoll_fd;
+    int wake_fd;              // eventfd：提交请求或停止时唤醒事件循环
+    pthread_t thread;
+    pthread_mutex_t mutex;    // 保护 submitted、stopping、waiters 和各句柄的 done
+    pthread_cond_t completed; // 有请求完成
+    client_call_t *submitted; // 已提交、尚未被事件循环取走的请求（后进先出，取走时反转）
+    int stopping;
+    int waiters;              // 正在 client_call_wait 中等待的线程数
+    client_call_t *queued;    // 所有连接都已满时排队的请求（只由事件循环访问）
+    client_call_t *queued_tail;
+};
+
+// 把请求加入完成列表
+static void async_complete(client_call_t **done, client_call_t *call, int status, const char *error_msg) {
+    call->result.status = status;
+    if (error_msg) {
+        snprintf(call->result.error_msg, ERROR_MSG_SIZE, "%s", error_msg);
+    }
+    buffer_free(call->data);
+    call->data = NULL;
+    call->next = *done;
+    *done = call;
+}
+
+// 连接失败：关闭连接，所有在途请求以失败完成；eject 非 0 时剔除该地址，下次使用时改连其他地址
+static void async_conn_fail(client_async_t *async, async_conn_t *c, const char *reason, int eject,
+                            client_call_t **done) {
+    LOG_ERROR("Async connection to %s failed: %s", c->endpoint->name, reason);
+    if (eject) {
+        endpoint_failed(c->endpoint);
+    }
+    if (c->fd >= 0) {
+        close(c->fd);
+    }
+    c->fd = -1;
+    c->connecting = 0;
+    c->retry_at = 0;
+    c->wlen = c->wsent = 0;
+    c->want_out = 0;
+    c->head_len = 0;
+    c->head_need = WIRE_RESPONSE_SIZE;
+    c->in_body = 0;
+    buffer_free(c->body);
+    c->body = NULL;
+    for (int i = 0; i < async->config.max_inflight; i++) {
+        if (c->slots[i]) {
+            async_complete(done, c->slots[i], -1, reason);
+            endpoint_release(c->endpoint);
+            c->slots[i] = NULL;
+            c->free_slots[c->free_count++] = i;
+        }
+    }
+    c->inflight = 0;
+}
+
+// 开始连接下一个可用的地址（不等待连接完成）：正在连接的 socket 监听 EPOLLOUT，可写或超时时由
+// async_connect_done 完成。已写入发送缓冲区的请求跟随连接改用新地址。没有可用的地址时返回 -1
+static int async_connect_start(client_async_t *async, async_conn_t *c) {
+    endpoint_t *ep;
+    while ((ep = endpoints_pick(async->endpoints, &c->tried)) != NULL) {
+        int fd = endpoint_connect_start(ep);
+        if (fd < 0) {
+            continue;
+        }
+        for (int i = 0; i < c->inflight; i++) {
+            endpoint_release(c->endpoint);
+            endpoint_acquire(ep);
+        }
+        c->endpoint = ep;
+        c->fd = fd;
+        c->connecting = 1;
+        c->connect_deadline = monotonic_seconds() + endpoints_connect_timeout_ms(async->endpoints) / 1000.0;
+        c->want_out = 1;
+        struct epoll_event ev;
+        ev.events = EPOLLOUT;
+        ev.data.ptr = c;
+        epoll_ctl(async->epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+        return 0;
+    }
+    return -1;
+}
+
+// 按策略选择连接（轮询 / 在途最少 / 随机两个取较少），必要时开始建立连接；所有连接都已满时返回 NULL 且 *full 为 1，
+// 没有可用的连接时返回 NULL 且 *full 为 0
+static async_conn_t *async_pick(client_async_t *async, int *full) {
+    while (1) {
+        double now = monotonic_seconds();
+        int n = async->config.connections;
+        async_conn_t *candidates[n];
+        int count = 0;
+        *full = 0;
+        for (int i = 0; i < n; i++) {
+            // 轮询策略从上次的位置开始，其他策略的比较也因此在相同时轮流选择
+            async_conn_t *c = &async->conns[(async->next + i) % n];
+            if (c->fd < 0 && now < c->retry_at) {
+                continue;
+            }
+            if (c->inflight >= async->config.max_inflight) {
+                *full = 1;
+                continue;
+            }
+            candidates[count++] = c;
+        }
+        if (count == 0) {
+            return NULL;
+        }
+
+        // 未连接的连接没有在途请求，在途最少和随机两个的策略会优先选中它，因此各连接在开始时就依次建立
+        async_conn_t *best = candidates[0];
+        if (async->endpoints->policy == BALANCE_LEAST_OUTSTANDING) {
+            for (int i = 1; i < count; i++) {
+                if (candidates[i]->inflight < best->inflight) {
+                    best = candidates[i];
+                }
+            }
+        } else if (async->endpoints->policy == BALANCE_P2C && count > 1) {
+            // 与 endpoints_pick 相同：选出两个不同的连接
+            async_conn_t *a = candidates[rand() % count];
+            async_conn_t *b = candidates[rand() % (count - 1)];
+            if (b == a) {
+                b = candidates[count - 1];
+            }
+            best = b->inflight < a->inflight ? b : a;
+        }
+        async->next = (unsigned)(best - async->conns) + 1;
+        if (best->fd >= 0) {
+            return best;
+        }
+
+        // 开始连接（不阻塞事件循环），请求先写入发送缓冲区，连接完成后发出
+        best->tried = 0;
+        if (async_connect_start(async, best) == 0) {
+            return best;
+        }
+        best->retry_at = now + ASYNC_RECONNECT_MS / 1000.0;
+    }
+}
+
+// 把请求编码到连接的发送缓冲区并登记为在途请求
+static int async_append(client_async_t *async, async_conn_t *c, client_call_t *call) {
+    size_t need = WIRE_HEADER_SIZE + call->header.length;
+    if (c->wsent > 0 && c->wsent >= c->wlen / 2) {
+        memmove(c->wbuf, c->wbuf + c->wsent, c->wlen - c->wsent);
+        c->wlen -= c->wsent;
+        c->wsent = 0;
+    }
+    if (c->wlen + need > c->wcap) {
+        size_t cap = c->wcap ? c->wcap : 65536;
+        while (cap < c->wlen + need) {
+            cap *= 2;
+        }
+        char *grown = (char *)realloc(c->wbuf, cap);
+        if (!grown) {
+            return -1;
+        }
+        c->wbuf = grown;
+        c->wcap = cap;
+    }
+
+    uint32_t slot = c->free_slots[--c->free_count];
+    call->header.request_id = (++c->seq << ASYNC_SLOT_BITS) | slot;
+    c->slots[slot] = call;
+    c->slot_ids[slot] = call->header.request_id;
+    c->inflight++;
+    endpoint_acquire(c->endpoint);
+
+    encode_header(&call->header, (uint8_t *)c->wbuf + c->wlen);
+    if (call->header.length > 0) {
+        memcpy(c->wbuf + c->wlen + WIRE_HEADER_SIZE, call->data, call->header.length);
+    }
+    c->wlen += need;
+    buffer_free(call->data);
+    call->data = NULL;
+    return 0;
+}
+
+// 为排队的请求分配连接，直到队列为空或所有连接都已满
+static void async_drain_queue(client_async_t *async, client_call_t **done) {
+    while (async->queued) {
+        int full;
+        async_conn_t *c = async_pick(async, &full);
+        if (!c) {
+            if (full) {
+                return;
+            }
+            // 没有可用的连接：所有排队的请求以失败完成
+            while (async->queued) {
+                client_call_t *call = async->queued;
+                async->queued = call->next;
+                async_complete(done, call, -1, "No connection available");
+            }
+            break;
+        }
+        client_call_t *call = async->queued;
+        async->queued = call->next;
+        if (async_append(async, c, call) < 0) {
+            async_complete(done, call, -1, "Client out of memory");
+        }
+    }
+    async->queued_tail = NULL;
+}
+
+// 发送缓冲区中的请求直到 EAGAIN，未发完时监听 EPOLLOUT
+static void async_flush(client_async_t *async, async_conn_t *c, client_call_t **done) {
+    while (c->wsent < c->wlen) {
+        ssize_t n = send(c->fd, c->wbuf + c->wsent, c->wlen - c->wsent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            async_conn_fail(async, c, "Failed to send request", 1, done);
+            return;
+        }
+        c->wsent += n;
+    }
+    if (c->wsent == c->wlen) {
+        c->wlen = c->wsent = 0;
+    }
+    int want_out = c->wlen > 0;
+    if (want_out != c->want_out) {
+        struct epoll_event ev;
+        ev.events = EPOLLIN | (want_out ? EPOLLOUT : 0);
+        ev.data.ptr = c;
+        epoll_ctl(async->epoll_fd, EPOLL_CTL_MOD, c->fd, &ev);
+        c->want_out = want_out;
+    }
+}
+
+// 非阻塞连接完成（err 为 ETIMEDOUT 表示超时）：成功时开始收发；失败时剔除该地址并改连下一个地址，
+// 没有可用的地址时等待的请求以失败完成
+static void async_connect_done(client_async_t *async, async_conn_t *c, int err, client_call_t **done) {
+    if (endpoint_connect_finish(c->endpoint, c->fd, err) == 0) {
+        c->connecting = 0;
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLOUT;
+        ev.data.ptr = c;
+        epoll_ctl(async->epoll_fd, EPOLL_CTL_MOD, c->fd, &ev);
+        async_flush(async, c, done);
+        return;
+    }
+    c->fd = -1; // 已被 endpoint_connect_finish 关闭
+    if (async_connect_start(async, c) == 0) {
+        return;
+    }
+    async_conn_fail(async, c, "No connection available", 0, done);
+    c->retry_at = monotonic_seconds() + ASYNC_RECONNECT_MS / 1000.0;
+}
+
+// 最近的连接超时距现在的毫秒数，没有正在连接的连接时返回 -1
+static int async_timeout_ms(client_async_t *async) {
+    double deadline = 0;
+    for (int i = 0; i < async->config.connections; i++) {
+        async_conn_t *c = &async->conns[i];
+        if (c->connecting && (deadline == 0 || c->connect_deadline < deadline)) {
+            deadline = c->connect_deadline;
+        }
+    }
+    if (deadline == 0) {
+        return -1;
+    }
+    double wait = (deadline - monotonic_seconds()) * 1000;
+    return wait > 0 ? (int)wait + 1 : 0;
+}
+
+// 一个响应接收完毕：按请求ID找到在途请求并填入结果
+static int async_response_done(client_async_t *async, async_conn_t *c, client_call_t **done) {
+    uint32_t slot = c->resp.request_id & ASYNC_SLOT_MASK;
+    if (slot >= (uint32_t)async->config.max_inflight || !c->slots[slot] ||
+        c->slot_ids[slot] != c->resp.request_id) {
+        return -1;
+    }
+    client_call_t *call = c->slots[slot];
+    c->slots[slot] = NULL;
+    c->free_slots[c->free_count++] = slot;
+    c->inflight--;
+    endpoint_release(c->endpoint);
+
+    if (c->resp.status == 0) {
+        c->body[c->resp.length] = '\0';
+        call->result.response = c->body;
+        call->result.response_len = c->resp.length;
+        call->result.server_time = c->resp.server_time;
+        c->body = NULL;
+        async_complete(done, call, 0, NULL);
+    } else {
+        async_complete(done, call, c->resp.status, c->error);
+    }
+    c->in_body = 0;
+    c->head_len = 0;
+    c->head_need = WIRE_RESPONSE_SIZE;
+    return 0;
+}
+
+// 解析接收到的数据，返回 -1 表示协议错误（调用方关闭连接）
+static int async_parse(client_async_t *async, async_conn_t *c, const char *p, size_t left, client_call_t **done,
+                       const char **reason) {
+    while (left > 0) {
+        if (!c->in_body) {
+            uint32_t take = c->head_need - c->head_len;
+            if (take > left) {
+                take = left;
+            }
+            memcpy(c->head + c->head_len, p, take);
+            c->head_len += take;
+            p += take;
+            left -= take;
+            if (c->head_len < c->head_need) {
+                break;
+            }
+            if (c->head_need == WIRE_RESPONSE_SIZE) {
+                if (decode_response(c->head, &c->resp) < 0) {
+                    *reason = "Invalid response header";
+                    return -1;
+                }
+                // 带阶段耗时的响应：继续接收阶段耗时（异步接口不返回，只跳过）
+                if (c->resp.traced) {
+                    c->head_need = WIRE_RESPONSE_MAX;
+                    continue;
+                }
+            }
+            if (c->resp.status == 0 && c->resp.length == STREAM_LENGTH) {
+                *reason = "Unexpected stream response";
+                return -1;
+            }
+            if (c->resp.status == 0) {
+                c->body = (char *)buffer_alloc(c->resp.length + 1);
+                if (!c->body) {
+                    *reason = "Client out of memory";
+                    return -1;
+                }
+            }
+            c->error[0] = '\0';
+            c->body_got = 0;
+            c->in_body = 1;
+        } else {
+            uint32_t take = c->resp.length - c->body_got;
+            if (take > left) {
+                take = left;
+            }
+            if (c->resp.status == 0) {
+                memcpy(c->body + c->body_got, p, take);
+            } else if (c->body_got < ERROR_MSG_SIZE - 1) {
+                uint32_t keep = ERROR_MSG_SIZE - 1 - c->body_got;
+                keep = keep < take ? keep : take;
+                memcpy(c->error + c->body_got, p, keep);
+                c->error[c->body_got + keep] = '\0';
+            }
+            c->body_got += take;
+            p += take;
+            left -= take;
+        }
+        if (c->in_body && c->body_got == c->resp.length && async_response_done(async, c, done) < 0) {
+            *reason = "Unexpected response ID";
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// 接收响应直到 EAGAIN
+static void async_read(client_async_t *async, async_conn_t *c, client_call_t **done) {
+    char buf[ASYNC_READ_SIZE];
+    while (1) {
+        ssize_t n = recv(c->fd, buf, sizeof(buf), 0);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                async_conn_fail(async, c, "Failed to receive response", 1, done);
+            }
+            return;
+        }
+        if (n == 0) {
+            async_conn_fail(async, c, "Connection closed by server", 1, done);
+            return;
+        }
+        const char *reason = NULL;
+        if (async_parse(async, c, buf, (size_t)n, done, &reason) < 0) {
+            async_conn_fail(async, c, reason, 0, done);
+            return;
+        }
+    }
+}
+
+// 通知完成的请求：有回调的调用回调（不持有锁），其余的标记完成并唤醒等待的线程
+static void async_finish(client_async_t *async, client_call_t *done) {
+    client_call_t *waited = NULL;
+    double now = get_current_time();
+    while (done) {
+        client_call_t *call = done;
+        done = call->next;
+        call->next = NULL;
+        call->result.client_time = now - call->start_time;
+        if (call->callback) {
+            call->callback(call, &call->result, call->arg);
+        } else {
+            call->next = waited;
+            waited = call;
+        }
+    }
+    if (waited) {
+        pthread_mutex_lock(&async->mutex);
+        for (client_call_t *call = waited; call; ) {
+            client_call_t *next = call->next;
+            call->done = 1; // 设置后等待的线程可能立即释放句柄，不能再访问
+            call = next;
+        }
+        if (async->waiters > 0) {
+            pthread_cond_broadcast(&async->completed);
+        }
+        pthread_mutex_unlock(&async->mutex);
+    }
+}
+
+// 事件循环线程
+static void *async_loop(void *arg) {
+    client_async_t *async = (client_async_t *)arg;
+    struct epoll_event events[ASYNC_MAX_EVENTS];
+    int stopping = 0;
+    while (!stopping) {
+        int n = epoll_wait(async->epoll_fd, events, ASYNC_MAX_EVENTS, async_timeout_ms(async));
+        if (n < 0 && errno != EINTR) {
+            LOG_ERROR("epoll_wait failed");
+            break;
+        }
+        client_call_t *done = NULL;
+        client_call_t *submitted = NULL;
+        for (int i = 0; i < n; i++) {
+            async_conn_t *c = (async_conn_t *)events[i].data.ptr;
+            if (!c) {
+                // 取走新提交的请求
+                uint64_t value;
+                if (read(async->wake_fd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+                    LOG_ERROR("Failed to read wake eventfd");
+                }
+                pthread_mutex_lock(&async->mutex);
+                submitted = async->submitted;
+                async->submitted = NULL;
+                stopping = async->stopping;
+                pthread_mutex_unlock(&async->mutex);
+                continue;
+            }
+            if (c->connecting) {
+                async_connect_done(async, c, 0, &done);
+                continue;
+            }
+            if (c->fd >= 0 && (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP))) {
+                async_read(async, c, &done);
+            }
+            if (c->fd >= 0 && (events[i].events & EPOLLOUT)) {
+                async_flush(async, c, &done);
+            }
+        }
+
+        // 超时的连接改连下一个地址
+        double now = monotonic_seconds();
+        for (int i = 0; i < async->config.connections; i++) {
+            async_conn_t *c = &async->conns[i];
+            if (c->connecting && now >= c->connect_deadline) {
+                async_connect_done(async, c, ETIMEDOUT, &done);
+            }
+        }
+
+        // 新提交的请求按提交顺序排在已排队的请求之后
+        client_call_t *ordered = NULL;
+        while (submitted) {
+            client_call_t *call = submitted;
+            submitted = call->next;
+            call->next = ordered;
+            ordered = call;
+        }
+        while (ordered) {
+            client_call_t *call = ordered;
+            ordered = call->next;
+            call->next = NULL;
+            if (async->queued_tail) {
+                async->queued_tail->next = call;
+            } else {
+                async->queued = call;
+            }
+            async->queued_tail = call;
+        }
+        if (!stopping) {
+            async_drain_queue(async, &done);
+        }
+        for (int i = 0; i < async->config.connections; i++) {
+            async_conn_t *c = &async->conns[i];
+            if (c->fd >= 0 && !c->connecting && c->wlen > c->wsent) {
+                async_flush(async, c, &done);
+            }
+        }
+        async_finish(async, done);
+    }
+
+    // 停止：在途和排队的请求以失败完成
+    client_call_t *done = NULL;
+    for (int i = 0; i < async->config.connections; i++) {
+        if (async->conns[i].fd >= 0) {
+            async_conn_fail(async, &async->conns[i], "Client closed", 0, &done);
+        }
+    }
+    while (async->queued) {
+        client_call_t *call = async->queued;
+        async->queued = call->next;
+        async_complete(&done, call, -1, "Client closed");
+    }
+    async->queued_tail = NULL;
+    async_finish(async, done);
+    return NULL;
+}
+
+// 释放连接数组
+static void async_free_conns(client_async_t *async) {
+    for (int i = 0; i < async->config.connections; i++) {
+        async_conn_t *c = &async->conns[i];
+        if (c->fd >= 0) {
+            close(c->fd);
+        }
+        free(c->wbuf);
+        free(c->slots);
+        free(c->slot_ids);
+        free(c->free_slots);
+        buffer_free(c->body);
+    }
+    free(async->conns);
+}
+
+// 创建异步客户端
+client_async_t *client_async_create(const client_async_config_t *config) {
+    client_async_t *async = (client_async_t *)calloc(1, sizeof(client_async_t));
+    if (!async) {
+        return NULL;
+    }
+    if (config) {
+        async->config = *config;
+    }
+    if (!async->config.host) {
+        async->config.host = SERVER_IP;
+    }
+    if (async->config.port <= 0) {
+        async->config.port = SERVER_PORT;
+    }
+    if (async->config.connections <= 0) {
+        async->config.connections = ASYNC_DEFAULT_CONNECTIONS;
+    }
+    if (async->config.max_inflight <= 0) {
+        async->config.max_inflight = ASYNC_DEFAULT_INFLIGHT;
+    }
+    if (async->config.max_inflight > (1 << ASYNC_SLOT_BITS)) {
+        async->config.max_inflight = 1 << ASYNC_SLOT_BITS;
+    }
+    async->endpoints = async->config.endpoints;
+    if (!async->endpoints) {
+        endpoints_init(&async->own_endpoints, BALANCE_LEAST_OUTSTANDING);
+        if (endpoints_add(&async->own_endpoints, async->config.host, async->config.port) < 0) {
+            LOG_ERROR("Invalid server address %s:%d", async->config.host, async->config.port);
+            free(async);
+            return NULL;
+        }
+        async->endpoints = &async->own_endpoints;
+    }
+
+    int max = async->config.max_inflight;
+    async->conns = (async_conn_t *)calloc(async->config.connections, sizeof(async_conn_t));
+    if (!async->conns) {
+        free(async);
+        return NULL;
+    }
+    int ok = 1;
+    for (int i = 0; i < async->config.connections; i++) {
+        async_conn_t *c = &async->conns[i];
+        c->fd = -1;
+        c->head_need = WIRE_RESPONSE_SIZE;
+        c->slots = (client_call_t **)calloc(max, sizeof(client_call_t *));
+        c->slot_ids = (uint32_t *)calloc(max, sizeof(uint32_t));
+        c->free_slots = (uint32_t *)malloc(max * sizeof(uint32_t));
+        if (!c->slots || !c->slot_ids || !c->free_slots) {
+            ok = 0;
+            continue;
+        }
+        for (int j = 0; j < max; j++) {
+            c->free_slots[j] = max - 1 - j;
+        }
+        c->free_count = max;
+    }
+
+    async->epoll_fd = epoll_create1(0);
+    async->wake_fd = eventfd(0, EFD_NONBLOCK);
+    if (!ok || async->epoll_fd < 0 || async->wake_fd < 0) {
+        LOG_ERROR("Failed to create async client");
+        ok = 0;
+    } else {
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.ptr = NULL;
+        epoll_ctl(async->epoll_fd, EPOLL_CTL_ADD, async->wake_fd, &ev);
+    }
+
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&async->completed, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&async->mutex, NULL);
+
+    if (ok && pthread_create(&async->thread, NULL, async_loop, async) != 0) {
+        LOG_ERROR("Failed to start async client thread");
+        ok = 0;
+    }
+    if (!ok) {
+        if (async->epoll_fd >= 0) {
+            close(async->epoll_fd);
+        }
+        if (async->wake_fd >= 0) {
+            close(async->wake_fd);
+        }
+        async_free_conns(async);
+        pthread_mutex_destroy(&async->mutex);
+        pthread_cond_destroy(&async->completed);
+        free(async);
+        return NULL;
+    }
+    return async;
+}
+
+// 唤醒事件循环
+static void async_wake(client_async_t *async) {
+    uint64_t one = 1;
+    if (write(async->wake_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        LOG_ERROR("Failed to wake async client thread");
+    }
+}
+
+// 停止并释放异步客户端
+void client_async_destroy(client_async_t *async) {
+    if (!async) {
+        return;
+    }
+    pthread_mutex_lock(&async->mutex);
+    async->stopping = 1;
+    pthread_mutex_unlock(&async->mutex);
+    async_wake(async);
+    pthread_join(async->thread, NULL);
+
+    close(async->epoll_fd);
+    close(async->wake_fd);
+    async_free_conns(async);
+    pthread_mutex_destroy(&async->mutex);
+    pthread_cond_destroy(&async->completed);
+    free(async);
+}
+
+// 提交请求
+client_call_t *client_async_submit(client_async_t *async, int id, const char *data, uint32_t length,
+                                   client_callback_t callback, void *arg) {
+    client_call_t *call = (client_call_t *)calloc(1, sizeof(client_call_t));
+    if (!call) {
+        return NULL;
+    }
+    if (length > 0) {
+        call->data = (char *)buffer_alloc(length);
+        if (!call->data) {
+            free(call);
+            return NULL;
+        }
+        memcpy(call->data, data, length);
+    }
+    call->header.length = length;
+    call->header.id = id;
+    call->header.mode = LONG_CONNECTION;
+    call->callback = callback;
+    call->arg = arg;
+    call->start_time = get_current_time();
+
+    // 队列由空变为非空时才需要唤醒事件循环，事件循环处理一批期间提交的请求合并为一次唤醒
+    pthread_mutex_lock(&async->mutex);
+    if (async->stopping) {
+        pthread_mutex_unlock(&async->mutex);
+        buffer_free(call->data);
+        free(call);
+        return NULL;
+    }
+    int wake = async->submitted == NULL;
+    call->next = async->submitted;
+    async->submitted = call;
+    pthread_mutex_unlock(&async->mutex);
+    if (wake) {
+        async_wake(async);
+    }
+    return call;
+}
+
+// 等待请求完成
+int client_call_wait(client_async_t *async, client_call_t *call, int timeout_ms) {
+    struct timespec deadline;
+    if (timeout_ms > 0) {
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+    }
+    pthread_mutex_lock(&async->mutex);
+    async->waiters++;
+    while (!call->done) {
+        int rc = timeout_ms > 0 ? pthread_cond_timedwait(&async->completed, &async->mutex, &deadline)
+                                : pthread_cond_wait(&async->completed, &async->mutex);
+        if (rc == ETIMEDOUT) {
+            break;
+        }
+    }
+    async->waiters--;
+    int done = call->done;
+    pthread_mutex_unlock(&async->mutex);
+    return done ? 0 : -1;
+}
+
+// 请求是否已完成
+int client_call_done(client_async_t *async, client_call_t *call) {
+    pthread_mutex_lock(&async->mutex);
+    int done = call->done;
+    pthread_mutex_unlock(&async->mutex);
+    return done;
+}
+
+// 请求结果
+const client_result_t *client_call_result(const client_call_t *call) {
+    return &call->result;
+}
+
+// 释放句柄
+void client_call_free(client_call_t *call) {
+    if (call) {
+        buffer_free(call->result.response);
+        buffer_free(call->data);
+        free(call);
+    }
+}
@@ -0,0 +1,629 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "include/common.h"
+#include "include/protocol.h"
+#include "include/network.h"
+#include "include/histogram.h"
+
+// 压测工具：多个线程各自用 epoll 驱动一组长连接，按函数ID组合和数据长度发送请求，统计吞吐量和延迟分位数。
+// 闭环模式下每个连接保持固定数量的在途请求，收到响应后立即发送下一个；
+// 开环模式下按固定总速率发送，延迟从计划发送时间算起（修正协调遗漏：服务端变慢导致的推迟发送计入延迟）
+
+#define MAX_MIX 16                // 函数ID组合中最多的函数数
+#define INFLIGHT_SLOTS 1024       // 每个连接的在途请求槽位数（2 的幂），下一个请求ID的槽位被占用时推迟发送
+#define RECV_BUF_SIZE 65536       // 每次接收的缓冲区大小
+#define MAX_PAYLOAD (1 << 20)     // 请求数据的最大长度
+
+// 函数ID组合中的一项
+typedef struct {
+    int id;
+    unsigned weight;
+} mix_entry_t;
+
+// 压测配置
+typedef struct {
+    const char *host;
+    int port;
+    int connections;          // 连接数
+    int threads;              // 线程数
+    int pipeline;             // 闭环模式下每个连接的在途请求数
+    int duration;             // 持续时间（秒）
+    uint32_t min_size;        // 请求数据长度范围
+    uint32_t max_size;
+    double rate;              // 开环模式的总请求速率（每秒），0 表示闭环
+    mix_entry_t mix[MAX_MIX]; // 函数ID组合
+    int mix_count;
+    unsigned mix_total;       // 权重之和
+} config_t;
+
+// 一个连接的状态
+typedef struct {
+    int fd;                   // -1 表示连接已失败
+    uint32_t next_id;         // 下一个请求ID
+    uint32_t slot_id[INFLIGHT_SLOTS];     // 占用槽位的完整请求ID（按请求ID取模）
+    uint64_t sent_at[INFLIGHT_SLOTS];     // 在途请求的实际发送时间
+    uint64_t intended_at[INFLIGHT_SLOTS]; // 在途请求的计划发送时间，0 表示空槽位
+    int inflight;             // 在途请求数
+    int owed;                 // 闭环：因槽位被占用而推迟发送的请求数
+    char *wbuf;               // 待发送的请求
+    size_t wlen;
+    size_t wcap;
+    size_t wsent;             // 已发送的字节数
+    uint8_t head[WIRE_RESPONSE_SIZE]; // 正在接收的响应头部
+    uint32_t head_len;
+    uint32_t body_left;       // 正在跳过的响应数据字节数
+    response_t response;      // 已解码的响应头部
+    uint64_t next_send;       // 开环：下一个请求的计划发送时间
+    uint64_t interval;        // 开环：请求间隔（纳秒）
+} lg_conn_t;
+
+// 工作线程
+typedef struct {
+    const config_t *cfg;
+    lg_conn_t *conns;
+    int nconns;
+    int first_conn;           // 第一个连接的全局编号（用于错开开环模式的发送时间）
+    const char *payload;
+    uint64_t rng;
+    uint64_t deadline;        // 停止发送的时间
+    uint64_t started;         // 开始和结束发送的时间（用于计算实际持续时间）
+    uint64_t finished;
+    uint64_t completed;       // 收到的响应数
+    uint64_t errors;          // 失败响应数
+    uint64_t unsent;          // 开环：到结束时仍未发出的计划请求数
+    uint64_t bytes_out;
+    uint64_t bytes_in;
+    int failed;               // 失败的连接数
+    histogram_t latency;      // 闭环为响应时间；开环为从计划发送时间到收到响应
+    histogram_t service;      // 从实际发送到收到响应
+    pthread_t thread;
+} worker_t;
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// xorshift64* 随机数
+static uint64_t next_random(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 2685821657736338717ULL;
+}
+
+// 连接服务端（阻塞连接，之后切换为非阻塞），失败返回 -1
+static int connect_server(const config_t *cfg) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(cfg->port);
+    if (inet_pton(AF_INET, cfg->host, &addr.sin_addr) != 1 ||
+        connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    int nodelay = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+    set_nonblocking(fd);
+    return fd;
+}
+
+// 关闭失败的连接
+static void fail_connection(worker_t *w, lg_conn_t *conn, const char *what) {
+    fprintf(stderr, "Connection failed: %s: %s\n", what, strerror(errno));
+    close(conn->fd);
+    conn->fd = -1;
+    w->failed++;
+}
+
+// 下一个请求ID的槽位是否空闲：请求ID k 和 k + INFLIGHT_SLOTS 不能同时在途（响应可能乱序到达）
+static int slot_free(const lg_conn_t *conn) {
+    return conn->intended_at[conn->next_id & (INFLIGHT_SLOTS - 1)] == 0;
+}
+
+// 把一个请求追加到发送缓冲区（调用方保证 slot_free）；intended 为计划发送时间（闭环模式下为当前时间）
+static int issue_request(worker_t *w, lg_conn_t *conn, uint64_t intended, uint64_t now) {
+    const config_t *cfg = w->cfg;
+
+    // 按权重选择函数ID，数据长度在范围内均匀分布
+    unsigned pick = (unsigned)(next_random(&w->rng) % cfg->mix_total);
+    int i = 0;
+    while (pick >= cfg->mix[i].weight) {
+        pick -= cfg->mix[i].weight;
+        i++;
+    }
+    uint32_t length = cfg->min_size;
+    if (cfg->max_size > cfg->min_size) {
+        length += (uint32_t)(next_random(&w->rng) % (cfg->max_size - cfg->min_size + 1));
+    }
+
+    size_t need = conn->wlen + WIRE_HEADER_SIZE + length;
+    if (need > conn->wcap) {
+        size_t cap = conn->wcap ? conn->wcap * 2 : 65536;
+        while (cap < need) {
+            cap *= 2;
+        }
+        char *grown = (char *)realloc(conn->wbuf, cap);
+        if (!grown) {
+            return -1;
+        }
+        conn->wbuf = grown;
+        conn->wcap = cap;
+    }
+
+    header_t header;
+    memset(&header, 0, sizeof(header));
+    header.length = length;
+    header.id = cfg->mix[i].id;
+    header.mode = LONG_CONNECTION;
+    header.request_id = conn->next_id++;
+    encode_header(&header, (uint8_t *)conn->wbuf + conn->wlen);
+    memcpy(conn->wbuf + conn->wlen + WIRE_HEADER_SIZE, w->payload, length);
+    conn->wlen = need;
+
+    uint32_t slot = header.request_id & (INFLIGHT_SLOTS - 1);
+    conn->slot_id[slot] = header.request_id;
+    conn->sent_at[slot] = now;
+    conn->intended_at[slot] = intended;
+    conn->inflight++;
+    w->bytes_out += WIRE_HEADER_SIZE + length;
+    return 0;
+}
+
+// 发送缓冲区中的请求直到 EAGAIN
+static int flush_requests(worker_t *w, lg_conn_t *conn) {
+    while (conn->wsent < conn->wlen) {
+        ssize_t n = send(conn->fd, conn->wbuf + conn->wsent, conn->wlen - conn->wsent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return 0;
+            }
+            fail_connection(w, conn, "send");
+            return -1;
+        }
+        conn->wsent += n;
+    }
+    conn->wlen = conn->wsent = 0;
+    return 0;
+}
+
+// 一个响应接收完毕
+static void complete_response(worker_t *w, lg_conn_t *conn, uint64_t now) {
+    uint32_t slot = conn->response.request_id & (INFLIGHT_SLOTS - 1);
+    if (!conn->intended_at[slot] || conn->slot_id[slot] != conn->response.request_id) {
+        fprintf(stderr, "Unexpected response ID %u\n", conn->response.request_id);
+        return;
+    }
+    hist_record(&w->latency, now - conn->intended_at[slot]);
+    hist_record(&w->service, now - conn->sent_at[slot]);
+    conn->intended_at[slot] = 0;
+    conn->inflight--;
+    w->completed++;
+    if (conn->response.status != 0) {
+        w->errors++;
+    }
+
+    // 闭环：收到响应后立即发送下一个请求；下一个请求ID的槽位仍被占用时推迟到槽位空出
+    if (w->cfg->rate == 0 && now < w->deadline) {
+        conn->owed++;
+        while (conn->owed > 0 && slot_free(conn)) {
+            issue_request(w, conn, now, now);
+            conn->owed--;
+        }
+    }
+}
+
+// 接收并解析响应直到 EAGAIN
+static int read_responses(worker_t *w, lg_conn_t *conn) {
+    char buf[RECV_BUF_SIZE];
+    while (1) {
+        ssize_t n = recv(conn->fd, buf, sizeof(buf), 0);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return 0;
+            }
+            fail_connection(w, conn, "recv");
+            return -1;
+        }
+        if (n == 0) {
+            errno = ECONNRESET;
+            fail_connection(w, conn, "closed by server");
+            return -1;
+        }
+        w->bytes_in += n;
+
+        uint64_t now = now_ns();
+        const char *p = buf;
+        size_t left = (size_t)n;
+        while (left > 0) {
+            if (conn->body_left > 0) {
+                size_t skip = left < conn->body_left ? left : conn->body_left;
+                p += skip;
+                left -= skip;
+                conn->body_left -= skip;
+                if (conn->body_left == 0) {
+                    complete_response(w, conn, now);
+                }
+                continue;
+            }
+            size_t take = WIRE_RESPONSE_SIZE - conn->head_len;
+            if (take > left) {
+                take = left;
+            }
+            memcpy(conn->head + conn->head_len, p, take);
+            conn->head_len += take;
+            p += take;
+            left -= take;
+            if (conn->head_len < WIRE_RESPONSE_SIZE) {
+                break;
+            }
+            conn->head_len = 0;
+            if (decode_response(conn->head, &conn->response) < 0 || conn->response.traced ||
+                conn->response.length == STREAM_LENGTH) {
+                errno = EPROTO;
+                fail_connection(w, conn, "invalid response");
+                return -1;
+            }
+            conn->body_left = conn->response.length;
+            if (conn->body_left == 0) {
+                complete_response(w, conn, now);
+            }
+        }
+    }
+}
+
+// 工作线程：驱动分配给它的连接直到持续时间结束
+static void *worker_main(void *arg) {
+    worker_t *w = (worker_t *)arg;
+    const config_t *cfg = w->cfg;
+    prctl(PR_SET_TIMERSLACK, 1UL); // 定时器默认合并 50 微秒内的唤醒
+    int epoll_fd = epoll_create1(0);
+    if (epoll_fd < 0) {
+        perror("epoll_create1");
+        w->failed = w->nconns;
+        return NULL;
+    }
+    for (int i = 0; i < w->nconns; i++) {
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLET;
+        ev.data.ptr = &w->conns[i];
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, w->conns[i].fd, &ev);
+    }
+
+    // 闭环：每个连接先发出 pipeline 个请求；开环：各连接的发送时间均匀错开
+    uint64_t start = now_ns();
+    w->started = start;
+    w->deadline = start + (uint64_t)cfg->duration * 1000000000ULL;
+    for (int i = 0; i < w->nconns; i++) {
+        lg_conn_t *conn = &w->conns[i];
+        if (cfg->rate > 0) {
+            conn->interval = (uint64_t)(cfg->connections * 1e9 / cfg->rate);
+            conn->next_send = start + (uint64_t)((w->first_conn + i) * 1e9 / cfg->rate);
+        } else {
+            for (int j = 0; j < cfg->pipeline; j++) {
+                issue_request(w, conn, start, start);
+            }
+            flush_requests(w, conn);
+        }
+    }
+
+    struct epoll_event events[64];
+    uint64_t now = start;
+    while (now < w->deadline) {
+        // 开环：发出所有已到计划时间的请求，槽位被占用的连接推迟发送（计划时间不变）
+        uint64_t wake = w->deadline;
+        if (cfg->rate > 0) {
+            for (int i = 0; i < w->nconns; i++) {
+                lg_conn_t *conn = &w->conns[i];
+                if (conn->fd < 0) {
+                    continue;
+                }
+                int issued = 0;
+                while (conn->next_send <= now && slot_free(conn)) {
+                    issue_request(w, conn, conn->next_send, now);
+                    conn->next_send += conn->interval;
+                    issued = 1;
+                }
+                if (issued) {
+                    flush_requests(w, conn);
+                }
+                if (conn->fd >= 0 && slot_free(conn) && conn->next_send < wake) {
+                    wake = conn->next_send;
+                }
+            }
+        }
+
+        // 用纳秒精度的超时等待，否则开环模式下按毫秒取整的唤醒延迟会被计入延迟
+        now = now_ns();
+        uint64_t wait_ns = wake > now ? wake - now : 0;
+        struct timespec timeout = { (time_t)(wait_ns / 1000000000ULL), (long)(wait_ns % 1000000000ULL) };
+        int n = epoll_pwait2(epoll_fd, events, 64, &timeout, NULL);
+        if (n < 0 && errno == ENOSYS) {
+            n = epoll_wait(epoll_fd, events, 64, (int)((wait_ns + 999999) / 1000000));
+        }
+        for (int i = 0; i < n; i++) {
+            lg_conn_t *conn = (lg_conn_t *)events[i].data.ptr;
+            if (conn->fd >= 0 && (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP))) {
+                read_responses(w, conn);
+            }
+            if (conn->fd >= 0 && conn->wlen > 0) {
+                flush_requests(w, conn);
+            }
+        }
+        now = now_ns();
+    }
+    w->finished = now;
+
+    // 开环：到结束时仍未发出的计划请求（槽位一直被占用或连接已失败），不计入延迟，需要单独报告
+    if (cfg->rate > 0) {
+        for (int i = 0; i < w->nconns; i++) {
+            lg_conn_t *conn = &w->conns[i];
+            if (conn->next_send < w->deadline) {
+                w->unsent += (w->deadline - conn->next_send + conn->interval - 1) / conn->interval;
+            }
+        }
+    }
+    close(epoll_fd);
+    return NULL;
+}
+
+// 解析函数ID组合，如 "1:3,2:1,4"（权重默认为 1）
+static int parse_mix(const char *text, config_t *cfg) {
+    cfg->mix_count = 0;
+    cfg->mix_total = 0;
+    const char *p = text;
+    while (*p) {
+        if (cfg->mix_count == MAX_MIX) {
+            return -1;
+        }
+        char *end;
+        long id = strtol(p, &end, 10);
+        long weight = 1;
+        if (end == p) {
+            return -1;
+        }
+        if (*end == ':') {
+            p = end + 1;
+            weight = strtol(p, &end, 10);
+            if (end == p || weight <= 0) {
+                return -1;
+            }
+        }
+        cfg->mix[cfg->mix_count].id = (int)id;
+        cfg->mix[cfg->mix_count].weight = (unsigned)weight;
+        cfg->mix_count++;
+        cfg->mix_total += (unsigned)weight;
+        if (*end == ',') {
+            end++;
+        } else if (*end != '\0') {
+            return -1;
+        }
+        p = end;
+    }
+    return cfg->mix_count > 0 ? 0 : -1;
+}
+
+// 解析数据长度，如 "16" 或 "16-1024"
+static int parse_size(const char *text, config_t *cfg) {
+    char *end;
+    long min = strtol(text, &end, 10);
+    long max = min;
+    if (end == text) {
+        return -1;
+    }
+    if (*end == '-') {
+        const char *p = end + 1;
+        max = strtol(p, &end, 10);
+        if (end == p) {
+            return -1;
+        }
+    }
+    if (*end != '\0' || min < 0 || max < min || max > MAX_PAYLOAD) {
+        return -1;
+    }
+    cfg->min_size = (uint32_t)min;
+    cfg->max_size = (uint32_t)max;
+    return 0;
+}
+
+// 输出一个延迟分布（微秒）
+static void print_histogram(const char *name, const histogram_t *hist) {
+    printf("%-13s mean %.1f, p50 %.1f, p90 %.1f, p99 %.1f, p999 %.1f, max %.1f us\n", name,
+           hist_mean(hist) / 1000.0, hist_percentile(hist, 0.5) / 1000.0, hist_percentile(hist, 0.9) / 1000.0,
+           hist_percentile(hist, 0.99) / 1000.0, hist_percentile(hist, 0.999) / 1000.0, hist->max / 1000.0);
+}
+
+static void usage(const char *prog) {
+    printf("Usage: %s [-c connections] [-t threads] [-p pipeline] [-d seconds] [-s size|min-max]\n"
+           "       [-f id[:weight],...] [-r requests_per_second] [-H host] [-P port]\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+    config_t cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.host = SERVER_IP;
+    cfg.port = SERVER_PORT;
+    cfg.connections = 16;
+    cfg.threads = 1;
+    cfg.pipeline = 1;
+    cfg.duration = 10;
+    cfg.min_size = cfg.max_size = 16;
+    parse_mix("1", &cfg);
+
+    int opt;
+    while ((opt = getopt(argc, argv, "c:t:p:d:s:f:r:H:P:h")) != -1) {
+        switch (opt) {
+        case 'c':
+            cfg.connections = atoi(optarg);
+            break;
+        case 't':
+            cfg.threads = atoi(optarg);
+            break;
+        case 'p':
+            cfg.pipeline = atoi(optarg);
+            break;
+        case 'd':
+            cfg.duration = atoi(optarg);
+            break;
+        case 's':
+            if (parse_size(optarg, &cfg) < 0) {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'f':
+            if (parse_mix(optarg, &cfg) < 0) {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'r':
+            cfg.rate = atof(optarg);
+            break;
+        case 'H':
+            cfg.host = optarg;
+            break;
+        case 'P':
+            cfg.port = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (cfg.connections <= 0 || cfg.threads <= 0 || cfg.pipeline <= 0 || cfg.pipeline > INFLIGHT_SLOTS ||
+        cfg.duration <= 0 || cfg.rate < 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (cfg.threads > cfg.connections) {
+        cfg.threads = cfg.connections;
+    }
+    raise_fd_limit();
+
+    // 请求数据为可打印字符，所有请求共用
+    char *payload = (char *)malloc(cfg.max_size + 1);
+    lg_conn_t *conns = (lg_conn_t *)calloc(cfg.connections, sizeof(lg_conn_t));
+    worker_t *workers = (worker_t *)calloc(cfg.threads, sizeof(worker_t));
+    if (!payload || !conns || !workers) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    for (uint32_t i = 0; i < cfg.max_size; i++) {
+        payload[i] = 'a' + i % 26;
+    }
+
+    for (int i = 0; i < cfg.connections; i++) {
+        if ((conns[i].fd = connect_server(&cfg)) < 0) {
+            fprintf(stderr, "Failed to connect to %s:%d: %s\n", cfg.host, cfg.port, strerror(errno));
+            return 1;
+        }
+        conns[i].next_id = 1;
+    }
+
+    // 连接按顺序分给各线程
+    int offset = 0;
+    for (int i = 0; i < cfg.threads; i++) {
+        worker_t *w = &workers[i];
+        w->cfg = &cfg;
+        w->first_conn = offset;
+        w->nconns = cfg.connections / cfg.threads + (i < cfg.connections % cfg.threads);
+        w->conns = conns + offset;
+        w->payload = payload;
+        w->rng = 0x9E3779B97F4A7C15ULL * (i + 1);
+        offset += w->nconns;
+        if (pthread_create(&w->thread, NULL, worker_main, w) != 0) {
+            fprintf(stderr, "Failed to start worker thread\n");
+            return 1;
+        }
+    }
+
+    // 合并各线程的结果
+    worker_t total;
+    memset(&total, 0, sizeof(total));
+    for (int i = 0; i < cfg.threads; i++) {
+        worker_t *w = &workers[i];
+        pthread_join(w->thread, NULL);
+        if (i == 0 || w->started < total.started) {
+            total.started = w->started;
+        }
+        if (w->finished > total.finished) {
+            total.finished = w->finished;
+        }
+        total.completed += w->completed;
+        total.errors += w->errors;
+        total.unsent += w->unsent;
+        total.bytes_out += w->bytes_out;
+        total.bytes_in += w->bytes_in;
+        total.failed += w->failed;
+        hist_merge(&total.latency, &w->latency);
+        hist_merge(&total.service, &w->service);
+    }
+    uint64_t unfinished = 0;
+    for (int i = 0; i < cfg.connections; i++) {
+        unfinished += conns[i].inflight;
+        if (conns[i].fd >= 0) {
+            close(conns[i].fd);
+        }
+        free(conns[i].wbuf);
+    }
+
+    if (cfg.rate > 0) {
+        printf("Open loop: %.0f requests/s target", cfg.rate);
+    } else {
+        printf("Closed loop: pipeline %d", cfg.pipeline);
+    }
+    printf(", %d connections, %d threads, %d s, payload %u-%u bytes\n",
+           cfg.connections, cfg.threads, cfg.duration, cfg.min_size, cfg.max_size);
+    printf("Requests: %llu completed, %llu errors, %llu unfinished, %d failed connections\n",
+           (unsigned long long)total.completed, (unsigned long long)total.errors,
+           (unsigned long long)unfinished, total.failed);
+    if (cfg.rate > 0) {
+        // 服务端跟不上时这些请求既没有发出也没有计入延迟，吞吐量低于目标速率
+        printf("Not sent: %llu scheduled requests (%.2f%% of schedule)\n", (unsigned long long)total.unsent,
+               100.0 * total.unsent / (cfg.rate * cfg.duration));
+    }
+
+    // 吞吐量按实际经过的时间计算（线程启动和最后一轮等待会使其与 -d 略有出入）
+    double elapsed = (total.finished - total.started) / 1e9;
+    if (elapsed <= 0) {
+        elapsed = cfg.duration;
+    }
+    printf("Throughput: %.1f requests/s over %.2f s, sent %.2f MB/s, received %.2f MB/s\n",
+           total.completed / elapsed, elapsed, total.bytes_out / 1e6 / elapsed, total.bytes_in / 1e6 / elapsed);
+    print_histogram("Latency:", &total.latency);
+    if (cfg.rate > 0) {
+        print_histogram("Service time:", &total.service);
+    }
+
+    free(payload);
+    free(conns);
+    free(workers);
+    return total.completed > 0 && total.errors == 0 && total.failed == 0 ? 0 : 1;
+}
@@ -1,32 +1,145 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <stdint.h>
 #include <time.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stddef.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <stdarg.h>
 #include <pthread.h>  // 确保包含 pthread.h
 #include "include/log.h"
+#include "include/log_format.h"
 
 #define MAX_LOG_FILES 5          // 最大日志文件数
 #define MAX_LOG_FILE_SIZE (2 * 1024 * 1024) // 每个日志文件最大大小（2MB）
-#define LOG_DIR "./logs"         // 日志文件存放目录
+#define LOG_WRITE_BUFFER (64 * 1024) // 日志文件的 stdio 缓冲区大小
+#define LOG_IDLE_WAIT_MS 100     // 写线程空闲时的最长等待时间（毫秒）
+#define LOG_PAGE_SIZE 4096       // 预先写入段文件时的步长
+
+// 日志模块状态
+enum {
+    LOG_CLOSED,  // 未初始化或已清理
+    LOG_SYNC,    // 同步模式
+    LOG_ASYNC,   // 异步模式
+    LOG_BINARY   // 二进制模式
+};
 
 static FILE *log_files[MAX_LOG_FILES] = {NULL};
+static long log_sizes[MAX_LOG_FILES];  // 各日志文件的当前大小，写入时累加，不再每次 fseek/ftell
+static char log_buffers[MAX_LOG_FILES][LOG_WRITE_BUFFER];
 static int current_log = 0;      // 当前日志文件索引
+static char log_dir_path[256];   // 日志文件存放目录
 static char log_file_paths[MAX_LOG_FILES][256]; // 日志文件路径数组
-static pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER; // 互斥锁保护日志文件
+static pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER; // 互斥锁保护日志文件（同步模式）
+static int log_state = LOG_CLOSED;
+static pid_t log_pid;            // 进程 ID（初始化时获取一次）
+int log_threshold = LOG_LEVEL_INFO;
 
-// 初始化日志模块
-void log_init(const char *log_dir) {
-    // 创建日志目录
+// 各级别的限速参数（纳秒）：interval 为两条日志的平均间隔（0 表示不限速），tolerance 为允许的突发量
+typedef struct {
+    uint64_t interval;
+    uint64_t tolerance;
+} log_rate_t;
+
+static log_site_t *pending_sites = NULL; // 有尚未报告的限速丢弃条数的调用点（无锁栈）
+
+static log_rate_t log_rates[LOG_LEVEL_COUNT] = {
+    [LOG_LEVEL_ERROR] = {
+        1000000000ULL / LOG_ERROR_RATE,
+        (LOG_ERROR_BURST - 1) * (1000000000ULL / LOG_ERROR_RATE)
+    },
+};
+
+// 异步模式的环形队列槽位：seq 等于槽位位置时可写入，等于位置 + 1 时可读取
+typedef struct {
+    uint64_t seq;
+    uint32_t length;
+    char line[LOG_LINE_SIZE];
+} log_slot_t;
+
+// 多生产者单消费者有界环形队列：生产者通过 CAS 抢占 head 上的位置，各自格式化到自己的槽位，
+// 只有写线程推进 tail，全程无锁
+static struct {
+    log_slot_t *slots;
+    uint64_t mask;
+    log_overflow_t overflow;
+    uint64_t head __attribute__((aligned(64)));  // 下一个写入位置（生产者共享）
+    uint64_t tail __attribute__((aligned(64)));  // 下一个读取位置（只由写线程访问）
+    uint64_t dropped;                            // 队列满时丢弃的日志条数
+    int stopping;
+    int writer_idle;                             // 写线程是否正在等待新日志
+    pthread_t writer;
+    pthread_mutex_t idle_mutex;
+    pthread_cond_t idle_cond;
+} ring = {
+    .idle_mutex = PTHREAD_MUTEX_INITIALIZER,
+    .idle_cond = PTHREAD_COND_INITIALIZER,
+};
+
+#define SEGMENT_WRITER (1ULL << 32)  // state 中写入线程计数的单位
+#define SEGMENT_CLOSED (1ULL << 63)  // state 中的关闭标志
+#define SEGMENT_OFFSET(state) ((uint32_t)(state))
+#define SEGMENT_WRITERS(state) (((state) & ~SEGMENT_CLOSED) >> 32)
+
+// 二进制模式的段文件：写入线程用一次原子加法同时预留空间并登记自己，写完后注销，
+// 段在被重新使用（轮转回同一个下标）之前保持映射，等所有写入线程退出后才解除映射
+typedef struct {
+    uint64_t state;  // 低 32 位为已分配的偏移，32~62 位为正在写入的线程数，最高位为关闭标志
+    char *base;      // 映射地址，NULL 表示尚未打开
+    int fd;
+} log_segment_t;
+
+// 已注册的格式定义，每个新段开头重新写入
+typedef struct {
+    uint32_t id;
+    int line;
+    int level;
+    char *file;
+    char *format;
+} log_definition_t;
+
+_Static_assert(sizeof(((log_site_t *)0)->types) == LOG_MAX_ARGS, "log_site_t.types must hold LOG_MAX_ARGS");
+
+static log_segment_t segments[MAX_LOG_FILES];
+static log_segment_t *current_segment = NULL;
+static int current_segment_index = 0;
+static log_definition_t *definitions = NULL;  // 格式ID为下标 + 1
+static uint32_t definition_count = 0;
+static uint32_t definition_capacity = 0;
+static log_segment_t *spare_segment = NULL;   // 后台线程预先准备好的下一个段
+static int prepare_pending = 0;                // 是否需要准备下一个段
+static int preparer_stopping = 0;
+static pthread_t preparer;
+static pthread_mutex_t segment_mutex = PTHREAD_MUTEX_INITIALIZER; // 串行化段切换、格式注册和段准备
+static pthread_cond_t prepare_cond = PTHREAD_COND_INITIALIZER;
+
+// 创建日志目录并记录目录和进程 ID
+static void prepare_log_dir(const char *log_dir) {
     if (access(log_dir, F_OK) != 0) {
         if (mkdir(log_dir, 0755) != 0) {
             perror("Failed to create log directory");
             exit(1);
         }
     }
+    snprintf(log_dir_path, sizeof(log_dir_path), "%s", log_dir);
+    log_pid = getpid();
+
+    // 环境变量 LOG_LEVEL 设置运行时级别阈值
+    const char *level = getenv("LOG_LEVEL");
+    if (level && log_set_level_name(level) < 0) {
+        fprintf(stderr, "Unknown LOG_LEVEL '%s', using %s\n", level, log_level_name(log_threshold));
+    }
+}
+
+// 打开所有日志文件并记录当前大小
+static void open_log_files(const char *log_dir) {
+    prepare_log_dir(log_dir);
 
     // 初始化日志文件
     for (int i = 0; i < MAX_LOG_FILES; i++) {
@@ -36,85 +149,735 @@ void log_init(const char *log_dir) {
             perror("Failed to open log file");
             exit(1);
         }
+        setvbuf(log_files[i], log_buffers[i], _IOFBF, LOG_WRITE_BUFFER);
+        fseek(log_files[i], 0, SEEK_END);
+        log_sizes[i] = ftell(log_files[i]);
         chmod(log_file_paths[i], 0644); // 设置日志文件权限为 0644
     }
 }
 
-// 清理日志模块
-void log_cleanup() {
-    pthread_mutex_lock(&log_mutex);
-    for (int i = 0; i < MAX_LOG_FILES; i++) {
-        if (log_files[i]) {
-            fclose(log_files[i]);
+// 初始化日志模块
+void log_init(const char *log_dir) {
+    open_log_files(log_dir);
+    __atomic_store_n(&log_state, LOG_SYNC, __ATOMIC_RELEASE);
+}
+
+// 当前日志文件超过最大大小时切换到下一个日志文件（调用方持有 log_mutex 或为写线程）
+static void rotate_logs() {
+    if (log_sizes[current_log] < MAX_LOG_FILE_SIZE) {
+        return;
+    }
+    fclose(log_files[current_log]);
+
+    // 重命名旧日志文件
+    char old_log_path[300];
+    snprintf(old_log_path, sizeof(old_log_path), "%s/log%d.old", log_dir_path, current_log + 1);
+    rename(log_file_paths[current_log], old_log_path);
+
+    // 创建新日志文件
+    log_files[current_log] = fopen(log_file_paths[current_log], "w");
+    if (!log_files[current_log]) {
+        perror("Failed to rotate log file");
+        exit(1);
+    }
+    setvbuf(log_files[current_log], log_buffers[current_log], _IOFBF, LOG_WRITE_BUFFER);
+    log_sizes[current_log] = 0;
+
+    current_log = (current_log + 1) % MAX_LOG_FILES;
+}
+
+// 写入一条已格式化的日志（调用方持有 log_mutex 或为写线程）
+static void write_line(const char *line, size_t length) {
+    rotate_logs();
+    fwrite(line, 1, length, log_files[current_log]);
+    log_sizes[current_log] += (long)length;
+}
+
+// 当前时间的文本形式，每个线程每秒只格式化一次
+static const char *log_timestamp(void) {
+    static __thread time_t cached_time = -1;
+    static __thread char cached[32];
+    time_t now = time(NULL);
+    if (now != cached_time) {
+        struct tm time_info;
+        localtime_r(&now, &time_info);
+        strftime(cached, sizeof(cached), "%Y-%m-%d %H:%M:%S", &time_info);
+        cached_time = now;
+    }
+    return cached;
+}
+
+// 把一条日志格式化到 buf，超出部分截断，总是以换行结尾；返回长度
+static size_t format_line(char *buf, size_t size, int level, const char *file, int line,
+                          const char *format, va_list args) {
+    int n = snprintf(buf, size, "[%s] [%s] [PID: %d] [%s:%d] ", log_timestamp(), log_level_name(level), log_pid, file, line);
+    size_t length = n < 0 ? 0 : (size_t)n < size - 1 ? (size_t)n : size - 1;
+    n = vsnprintf(buf + length, size - length, format, args);
+    length += n < 0 ? 0 : (size_t)n < size - length - 1 ? (size_t)n : size - length - 1;
+    buf[length++] = '\n';
+    return length;
+}
+
+// 唤醒正在等待的写线程
+static void wake_writer(void) {
+    if (__atomic_load_n(&ring.writer_idle, __ATOMIC_SEQ_CST)) {
+        pthread_mutex_lock(&ring.idle_mutex);
+        pthread_cond_signal(&ring.idle_cond);
+        pthread_mutex_unlock(&ring.idle_mutex);
+    }
+}
+
+// 把一条日志放入环形队列
+static void ring_push(int level, const char *file, int line, const char *format, va_list args) {
+    uint64_t pos = __atomic_load_n(&ring.head, __ATOMIC_RELAXED);
+    log_slot_t *slot;
+    for (;;) {
+        slot = &ring.slots[pos & ring.mask];
+        uint64_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        int64_t diff = (int64_t)(seq - pos);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&ring.head, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // 队列已满：丢弃，或者等写线程腾出槽位
+            if (ring.overflow == LOG_OVERFLOW_DROP || __atomic_load_n(&ring.stopping, __ATOMIC_ACQUIRE)) {
+                __atomic_fetch_add(&ring.dropped, 1, __ATOMIC_RELAXED);
+                return;
+            }
+            wake_writer();
+            sched_yield();
+            pos = __atomic_load_n(&ring.head, __ATOMIC_RELAXED);
+        } else {
+            pos = __atomic_load_n(&ring.head, __ATOMIC_RELAXED);
         }
     }
-    pthread_mutex_unlock(&log_mutex);
+
+    slot->length = (uint32_t)format_line(slot->line, LOG_LINE_SIZE, level, file, line, format, args);
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_SEQ_CST);
+    wake_writer();
 }
 
-// 检查日志文件大小并轮转
-static void rotate_logs() {
-    pthread_mutex_lock(&log_mutex);
+// 把队列中已就绪的日志全部写入文件，一批只 fflush 一次；返回写入条数
+static int ring_drain(void) {
+    int count = 0;
+    for (;;) {
+        log_slot_t *slot = &ring.slots[ring.tail & ring.mask];
+        if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != ring.tail + 1) {
+            break; // 队列为空，或者下一个槽位的生产者尚未写完
+        }
+        write_line(slot->line, slot->length);
+        __atomic_store_n(&slot->seq, ring.tail + ring.mask + 1, __ATOMIC_RELEASE);
+        ring.tail++;
+        count++;
+    }
 
-    // 获取当前日志文件大小
-    fseek(log_files[current_log], 0, SEEK_END);
-    long file_size = ftell(log_files[current_log]);
-    fseek(log_files[current_log], 0, SEEK_SET);
+    // 补记丢弃的日志条数
+    uint64_t dropped = __atomic_exchange_n(&ring.dropped, 0, __ATOMIC_RELAXED);
+    if (dropped > 0) {
+        char line[128];
+        int n = snprintf(line, sizeof(line), "[%s] [ERROR] [PID: %d] [%s:%d] Dropped %llu log messages (queue full)\n",
+                         log_timestamp(), log_pid, __FILE__, __LINE__, (unsigned long long)dropped);
+        write_line(line, (size_t)n < sizeof(line) ? (size_t)n : sizeof(line) - 1);
+        count++;
+    }
+    if (count > 0) {
+        fflush(log_files[current_log]);
+    }
+    return count;
+}
 
-    // 如果当前日志文件超过最大大小，切换到下一个日志文件
-    if (file_size >= MAX_LOG_FILE_SIZE) {
-        fclose(log_files[current_log]);
+// 队列中是否有已就绪的日志
+static int ring_ready(void) {
+    log_slot_t *slot = &ring.slots[ring.tail & ring.mask];
+    return __atomic_load_n(&slot->seq, __ATOMIC_SEQ_CST) == ring.tail + 1 ||
+           __atomic_load_n(&ring.dropped, __ATOMIC_RELAXED) > 0;
+}
 
-        // 重命名旧日志文件
-        char old_log_path[256];
-        snprintf(old_log_path, sizeof(old_log_path), "%s/log%d.old", LOG_DIR, current_log + 1);
-        rename(log_file_paths[current_log], old_log_path);
+// 写线程：批量取出日志写入文件，没有日志时等待生产者唤醒（最长 LOG_IDLE_WAIT_MS）
+static void *log_writer(void *arg) {
+    (void)arg;
+    for (;;) {
+        if (ring_drain() > 0) {
+            continue;
+        }
+        if (__atomic_load_n(&ring.stopping, __ATOMIC_ACQUIRE)) {
+            // 停止前再取一次，避免遗漏停止标志设置之前写入的日志
+            if (ring_drain() == 0) {
+                break;
+            }
+            continue;
+        }
 
-        // 创建新日志文件
-        log_files[current_log] = fopen(log_file_paths[current_log], "w");
-        if (!log_files[current_log]) {
-            perror("Failed to rotate log file");
-            exit(1);
+        pthread_mutex_lock(&ring.idle_mutex);
+        __atomic_store_n(&ring.writer_idle, 1, __ATOMIC_SEQ_CST);
+        if (!ring_ready() && !__atomic_load_n(&ring.stopping, __ATOMIC_ACQUIRE)) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += LOG_IDLE_WAIT_MS * 1000000L;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&ring.idle_cond, &ring.idle_mutex, &deadline);
+        }
+        __atomic_store_n(&ring.writer_idle, 0, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&ring.idle_mutex);
+    }
+    return NULL;
+}
+
+// 初始化日志模块（异步模式）
+void log_init_async(const char *log_dir, int slots, log_overflow_t overflow) {
+    open_log_files(log_dir);
+
+    uint64_t n = 2;
+    while (n < (uint64_t)slots) {
+        n <<= 1;
+    }
+    ring.slots = (log_slot_t *)malloc(n * sizeof(log_slot_t));
+    if (!ring.slots) {
+        perror("Failed to allocate log ring");
+        exit(1);
+    }
+    for (uint64_t i = 0; i < n; i++) {
+        ring.slots[i].seq = i;
+    }
+    ring.mask = n - 1;
+    ring.overflow = overflow;
+    ring.head = 0;
+    ring.tail = 0;
+    ring.dropped = 0;
+    ring.stopping = 0;
+
+    if (pthread_create(&ring.writer, NULL, log_writer, NULL) != 0) {
+        perror("Failed to start log writer thread");
+        exit(1);
+    }
+    __atomic_store_n(&log_state, LOG_ASYNC, __ATOMIC_RELEASE);
+
+    // 异常退出路径（exit）上也要写完队列中的日志
+    atexit(log_cleanup);
+}
+
+// 当前时间（纳秒）；使用粗粒度时钟（精度为一个时钟节拍），比 CLOCK_REALTIME 快数倍，
+// 文本日志的时间戳只精确到秒
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// 在段中预留 size 字节，段已满或已关闭时返回 NULL；成功时调用方写完后必须调用 segment_commit
+static char *segment_try_reserve(log_segment_t *seg, uint32_t size) {
+    uint64_t old = __atomic_fetch_add(&seg->state, SEGMENT_WRITER + size, __ATOMIC_ACQUIRE);
+    if (!(old & SEGMENT_CLOSED) && (uint64_t)SEGMENT_OFFSET(old) + size <= MAX_LOG_FILE_SIZE) {
+        return seg->base + SEGMENT_OFFSET(old);
+    }
+    __atomic_fetch_sub(&seg->state, SEGMENT_WRITER, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+// 记录写完：最后写入长度字段，解码工具读到非 0 长度时记录内容已完整
+static void segment_commit(log_segment_t *seg, char *record, uint32_t size) {
+    __atomic_store_n((uint32_t *)record, size, __ATOMIC_RELEASE);
+    __atomic_fetch_sub(&seg->state, SEGMENT_WRITER, __ATOMIC_RELEASE);
+}
+
+// 关闭段：禁止新的写入，等正在写入的线程退出后把文件截断到实际长度（调用方持有 segment_mutex）
+static void segment_close(log_segment_t *seg) {
+    uint64_t old = __atomic_fetch_or(&seg->state, SEGMENT_CLOSED, __ATOMIC_ACQ_REL);
+    while (SEGMENT_WRITERS(__atomic_load_n(&seg->state, __ATOMIC_ACQUIRE)) > 0) {
+        sched_yield();
+    }
+    uint32_t used = SEGMENT_OFFSET(old) < MAX_LOG_FILE_SIZE ? SEGMENT_OFFSET(old) : MAX_LOG_FILE_SIZE;
+    munmap(seg->base, MAX_LOG_FILE_SIZE);
+    if (ftruncate(seg->fd, used) != 0) {
+        perror("Failed to truncate log segment");
+    }
+    close(seg->fd);
+    seg->base = NULL;
+}
+
+// 把一个格式定义写入段，空间不足时返回 -1
+static int write_definition(log_segment_t *seg, const log_definition_t *def) {
+    uint16_t file_len = (uint16_t)strnlen(def->file, UINT16_MAX);
+    uint16_t format_len = (uint16_t)strnlen(def->format, UINT16_MAX);
+    uint32_t size = (LOG_RECORD_HEADER_SIZE + LOG_DEFINITION_HEADER_SIZE + file_len + format_len + 7) & ~7u;
+    char *record = segment_try_reserve(seg, size);
+    if (!record) {
+        return -1;
+    }
+    uint32_t zero = 0;
+    uint64_t timestamp = now_ns();
+    memcpy(record + 4, &zero, 4);
+    memcpy(record + 8, &timestamp, 8);
+    char *p = record + LOG_RECORD_HEADER_SIZE;
+    memcpy(p, &def->id, 4);
+    memcpy(p + 4, &def->line, 4);
+    memcpy(p + 8, &def->level, 4);
+    memcpy(p + 12, &file_len, 2);
+    memcpy(p + 14, &format_len, 2);
+    memcpy(p + LOG_DEFINITION_HEADER_SIZE, def->file, file_len);
+    memcpy(p + LOG_DEFINITION_HEADER_SIZE + file_len, def->format, format_len);
+    segment_commit(seg, record, size);
+    return 0;
+}
+
+// 在下标 index 处创建新段：旧文件重命名为 log%d.old.bin，新段映射后逐页写入一次，
+// 让缺页和文件块分配都发生在这里而不是写日志时（调用方持有 segment_mutex）
+static log_segment_t *segment_create(int index) {
+    log_segment_t *seg = &segments[index];
+    if (seg->base) {
+        segment_close(seg);
+    }
+
+    char path[300], old_path[300];
+    snprintf(path, sizeof(path), "%s/log%d.bin", log_dir_path, index + 1);
+    snprintf(old_path, sizeof(old_path), "%s/log%d.old.bin", log_dir_path, index + 1);
+    rename(path, old_path);
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, MAX_LOG_FILE_SIZE) != 0) {
+        perror("Failed to create log segment");
+        exit(1);
+    }
+    char *base = (char *)mmap(NULL, MAX_LOG_FILE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        perror("Failed to map log segment");
+        exit(1);
+    }
+    for (size_t off = 0; off < MAX_LOG_FILE_SIZE; off += LOG_PAGE_SIZE) {
+        base[off] = 0;
+    }
+
+    // 段头部
+    uint32_t version = LOG_SEGMENT_VERSION;
+    uint32_t pid = (uint32_t)log_pid;
+    uint64_t created = now_ns();
+    uint32_t segment_size = MAX_LOG_FILE_SIZE;
+    memcpy(base, LOG_SEGMENT_MAGIC, 8);
+    memcpy(base + 8, &version, 4);
+    memcpy(base + 12, &pid, 4);
+    memcpy(base + 16, &created, 8);
+    memcpy(base + 24, &segment_size, 4);
+    seg->base = base;
+    seg->fd = fd;
+
+    // 偏移从段头部之后开始；保留仍在计数中的写入线程（它们看到关闭标志后会自行注销）
+    uint64_t old = __atomic_load_n(&seg->state, __ATOMIC_RELAXED);
+    uint64_t next;
+    do {
+        next = (old & ~SEGMENT_CLOSED & ~0xFFFFFFFFULL) | LOG_SEGMENT_HEADER_SIZE;
+    } while (!__atomic_compare_exchange_n(&seg->state, &old, next, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    return seg;
+}
+
+// 切换到下一个段：优先使用后台线程准备好的段，没有时当场创建；新段开头写入全部格式定义，
+// 然后通知后台线程准备再下一个段（调用方持有 segment_mutex）
+static void segment_advance(void) {
+    int index = (current_segment_index + 1) % MAX_LOG_FILES;
+    log_segment_t *seg = spare_segment ? spare_segment : segment_create(index);
+    spare_segment = NULL;
+    for (uint32_t i = 0; i < definition_count; i++) {
+        if (write_definition(seg, &definitions[i]) < 0) {
+            break;
+        }
+    }
+    current_segment_index = index;
+    __atomic_store_n(&current_segment, seg, __ATOMIC_RELEASE);
+
+    prepare_pending = 1;
+    pthread_cond_signal(&prepare_cond);
+}
+
+// 当前段已满：切换到下一个段（其他线程已经切换过时什么也不做）
+static void segment_rotate(log_segment_t *full) {
+    pthread_mutex_lock(&segment_mutex);
+    if (__atomic_load_n(&log_state, __ATOMIC_ACQUIRE) == LOG_BINARY && current_segment == full) {
+        segment_advance();
+    }
+    pthread_mutex_unlock(&segment_mutex);
+}
+
+// 后台线程：在当前段写满之前准备好下一个段（顺带关闭该下标上的旧段）
+static void *segment_preparer(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&segment_mutex);
+    while (!preparer_stopping) {
+        if (!prepare_pending) {
+            pthread_cond_wait(&prepare_cond, &segment_mutex);
+            continue;
+        }
+        prepare_pending = 0;
+        if (!spare_segment) {
+            spare_segment = segment_create((current_segment_index + 1) % MAX_LOG_FILES);
+        }
+    }
+    pthread_mutex_unlock(&segment_mutex);
+    return NULL;
+}
+
+// 首次调用时注册调用点：解析参数类型、分配格式ID并写入格式定义；失败时返回 0
+static uint32_t register_site(log_site_t *site) {
+    pthread_mutex_lock(&segment_mutex);
+    uint32_t id = site->id;
+    if (id == 0 && current_segment) {
+        int nargs = log_parse_format(site->format, site->types, LOG_MAX_ARGS);
+        if (definition_count == definition_capacity) {
+            uint32_t capacity = definition_capacity ? definition_capacity * 2 : 64;
+            log_definition_t *grown = (log_definition_t *)realloc(definitions, capacity * sizeof(log_definition_t));
+            if (!grown) {
+                pthread_mutex_unlock(&segment_mutex);
+                return 0;
+            }
+            definitions = grown;
+            definition_capacity = capacity;
+        }
+
+        // 格式字符串和文件名复制一份，卸载插件后仍然可以写入新段
+        log_definition_t *def = &definitions[definition_count];
+        def->id = definition_count + 1;
+        def->line = site->line;
+        def->level = site->level;
+        def->file = strdup(site->file);
+        def->format = strdup(nargs < 0 ? "%s" : site->format);
+        if (!def->file || !def->format) {
+            free(def->file);
+            free(def->format);
+            pthread_mutex_unlock(&segment_mutex);
+            return 0;
+        }
+        definition_count++;
+        if (write_definition(current_segment, def) < 0) {
+            segment_advance(); // 新段开头会写入全部定义
         }
+        site->nargs = (int8_t)nargs;
+        id = def->id;
+        __atomic_store_n(&site->id, id, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&segment_mutex);
+    return id;
+}
 
-        current_log = (current_log + 1) % MAX_LOG_FILES;
+// 二进制模式下记录一条日志：只复制原始参数，不做格式化
+static void binary_write(log_site_t *site, va_list args) {
+    uint32_t id = __atomic_load_n(&site->id, __ATOMIC_ACQUIRE);
+    if (id == 0 && (id = register_site(site)) == 0) {
+        return;
     }
 
+    uint64_t values[LOG_MAX_ARGS];
+    uint32_t lengths[LOG_MAX_ARGS];
+    char text[LOG_LINE_SIZE];
+    int nargs = site->nargs;
+    int preformatted = nargs < 0;
+    uint32_t size = LOG_RECORD_HEADER_SIZE;
+    if (preformatted) {
+        // 格式不支持二进制记录：先格式化为文本，作为一个字符串参数记录
+        int n = vsnprintf(text, sizeof(text), site->format, args);
+        values[0] = (uintptr_t)text;
+        lengths[0] = n < 0 ? 0 : (size_t)n < sizeof(text) ? (uint32_t)n : sizeof(text) - 1;
+        size += 4 + lengths[0];
+        nargs = 1;
+    }
+    for (int i = 0; i < nargs && !preformatted; i++) {
+        switch (site->types[i]) {
+        case LOG_ARG_INT:
+            values[i] = (uint64_t)(int64_t)va_arg(args, int);
+            break;
+        case LOG_ARG_LONG:
+            values[i] = (uint64_t)va_arg(args, long);
+            break;
+        case LOG_ARG_LLONG:
+            values[i] = (uint64_t)va_arg(args, long long);
+            break;
+        case LOG_ARG_SIZE:
+            values[i] = (uint64_t)va_arg(args, size_t);
+            break;
+        case LOG_ARG_INTMAX:
+            values[i] = (uint64_t)va_arg(args, intmax_t);
+            break;
+        case LOG_ARG_PTRDIFF:
+            values[i] = (uint64_t)va_arg(args, ptrdiff_t);
+            break;
+        case LOG_ARG_DOUBLE: {
+            double d = va_arg(args, double);
+            memcpy(&values[i], &d, sizeof(d));
+            break;
+        }
+        case LOG_ARG_POINTER:
+            values[i] = (uintptr_t)va_arg(args, void *);
+            break;
+        case LOG_ARG_STRING: {
+            const char *str = va_arg(args, const char *);
+            if (!str) {
+                str = "(null)";
+            }
+            values[i] = (uintptr_t)str;
+            lengths[i] = (uint32_t)strnlen(str, LOG_LINE_SIZE);
+            size += 4 + lengths[i];
+            continue;
+        }
+        }
+        size += 8;
+    }
+    size = (size + 7) & ~7u;
+
+    // 在当前段预留空间，段已满时切换到下一个段后重试
+    log_segment_t *seg;
+    char *record;
+    for (;;) {
+        seg = __atomic_load_n(&current_segment, __ATOMIC_ACQUIRE);
+        if (!seg) {
+            return; // 日志模块已清理
+        }
+        if ((record = segment_try_reserve(seg, size)) != NULL) {
+            break;
+        }
+        segment_rotate(seg);
+    }
+
+    uint64_t timestamp = now_ns();
+    memcpy(record + 4, &id, 4);
+    memcpy(record + 8, &timestamp, 8);
+    char *p = record + LOG_RECORD_HEADER_SIZE;
+    for (int i = 0; i < nargs; i++) {
+        if (preformatted || site->types[i] == LOG_ARG_STRING) {
+            memcpy(p, &lengths[i], 4);
+            memcpy(p + 4, (const char *)(uintptr_t)values[i], lengths[i]);
+            p += 4 + lengths[i];
+        } else {
+            memcpy(p, &values[i], 8);
+            p += 8;
+        }
+    }
+    segment_commit(seg, record, size);
+}
+
+// 初始化日志模块（二进制模式）
+void log_init_binary(const char *log_dir) {
+    prepare_log_dir(log_dir);
+    pthread_mutex_lock(&segment_mutex);
+    current_segment_index = MAX_LOG_FILES - 1; // 第一个段的下标为 0
+    segment_advance();
+    pthread_mutex_unlock(&segment_mutex);
+    if (pthread_create(&preparer, NULL, segment_preparer, NULL) != 0) {
+        perror("Failed to start log segment thread");
+        exit(1);
+    }
+    __atomic_store_n(&log_state, LOG_BINARY, __ATOMIC_RELEASE);
+
+    // 退出时把段文件截断到实际长度
+    atexit(log_cleanup);
+}
+
+// 清理日志模块
+void log_cleanup() {
+    log_flush_suppressed();
+    int state = __atomic_exchange_n(&log_state, LOG_CLOSED, __ATOMIC_ACQ_REL);
+    if (state == LOG_CLOSED) {
+        return;
+    }
+    if (state == LOG_ASYNC) {
+        __atomic_store_n(&ring.stopping, 1, __ATOMIC_RELEASE);
+        pthread_mutex_lock(&ring.idle_mutex);
+        pthread_cond_signal(&ring.idle_cond);
+        pthread_mutex_unlock(&ring.idle_mutex);
+        pthread_join(ring.writer, NULL);
+    }
+    if (state == LOG_BINARY) {
+        pthread_mutex_lock(&segment_mutex);
+        preparer_stopping = 1;
+        pthread_cond_signal(&prepare_cond);
+        pthread_mutex_unlock(&segment_mutex);
+        pthread_join(preparer, NULL);
+
+        pthread_mutex_lock(&segment_mutex);
+        __atomic_store_n(&current_segment, NULL, __ATOMIC_RELEASE);
+        for (int i = 0; i < MAX_LOG_FILES; i++) {
+            if (segments[i].base) {
+                segment_close(&segments[i]);
+            }
+        }
+        pthread_mutex_unlock(&segment_mutex);
+    }
+
+    pthread_mutex_lock(&log_mutex);
+    for (int i = 0; i < MAX_LOG_FILES; i++) {
+        if (log_files[i]) {
+            fclose(log_files[i]);
+            log_files[i] = NULL;
+        }
+    }
     pthread_mutex_unlock(&log_mutex);
 }
 
 // 记录日志消息
-static void log_message(const char *level, const char *file, int line, const char *format, va_list args) {
-    // 获取当前时间
-    time_t rawtime;
-    struct tm *time_info;
-    char timestamp[60];
-    time(&rawtime);
-    time_info = localtime(&rawtime);
-    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", time_info);
-
-    // 获取进程 ID
-    pid_t pid = getpid();
-
-    // 写入日志文件
-    rotate_logs(); // 检查日志文件大小并轮转
+static void log_message(int level, const char *file, int line, const char *format, va_list args) {
+    int state = __atomic_load_n(&log_state, __ATOMIC_ACQUIRE);
+    if (state == LOG_ASYNC) {
+        ring_push(level, file, line, format, args);
+        return;
+    }
+    if (state != LOG_SYNC) {
+        return;
+    }
+
+    // 同步模式：一次加锁完成轮转检查和写入
     pthread_mutex_lock(&log_mutex);
-    fprintf(log_files[current_log], "[%s] [%s] [PID: %d] [%s:%d] ", timestamp, level, pid, file, line);
-    vfprintf(log_files[current_log], format, args);
-    fprintf(log_files[current_log], "\n");
-    fflush(log_files[current_log]); // 确保日志立即写入文件
+    if (log_files[current_log]) {
+        rotate_logs(); // 检查日志文件大小并轮转
+        int n = fprintf(log_files[current_log], "[%s] [%s] [PID: %d] [%s:%d] ",
+                        log_timestamp(), log_level_name(level), log_pid, file, line);
+        int m = vfprintf(log_files[current_log], format, args);
+        fputc('\n', log_files[current_log]);
+        fflush(log_files[current_log]); // 确保日志立即写入文件
+        log_sizes[current_log] += (n > 0 ? n : 0) + (m > 0 ? m : 0) + 1;
+    }
     pthread_mutex_unlock(&log_mutex);
 }
 
 void log_error(const char *file, int line, const char *format, ...) {
+    if (LOG_LEVEL_ERROR < __atomic_load_n(&log_threshold, __ATOMIC_RELAXED)) {
+        return;
+    }
     va_list args;
     va_start(args, format);
-    log_message("ERROR", file, line, format, args);
+    log_message(LOG_LEVEL_ERROR, file, line, format, args);
     va_end(args);
 }
 
 void log_info(const char *file, int line, const char *format, ...) {
+    if (LOG_LEVEL_INFO < __atomic_load_n(&log_threshold, __ATOMIC_RELAXED)) {
+        return;
+    }
     va_list args;
     va_start(args, format);
-    log_message("INFO", file, line, format, args);
+    log_message(LOG_LEVEL_INFO, file, line, format, args);
+    va_end(args);
+}
+
+// 按当前模式记录调用点的一条日志
+static void site_emit(log_site_t *site, va_list args) {
+    if (__atomic_load_n(&log_state, __ATOMIC_ACQUIRE) == LOG_BINARY) {
+        binary_write(site, args);
+    } else {
+        log_message(site->level, site->file, site->line, site->format, args);
+    }
+}
+
+static void site_emit_args(log_site_t *site, ...) {
+    va_list args;
+    va_start(args, site);
+    site_emit(site, args);
     va_end(args);
 }
+
+// 记录调用点被限速丢弃的条数；每个级别一个汇总调用点，汇总本身不限速
+static void report_suppressed(const log_site_t *site, uint64_t suppressed) {
+    static log_site_t summaries[LOG_LEVEL_COUNT] = {
+        { .format = "Suppressed %llu messages from %s:%d", .file = __FILE__, .line = __LINE__, .level = LOG_LEVEL_DEBUG },
+        { .format = "Suppressed %llu messages from %s:%d", .file = __FILE__, .line = __LINE__, .level = LOG_LEVEL_INFO },
+        { .format = "Suppressed %llu messages from %s:%d", .file = __FILE__, .line = __LINE__, .level = LOG_LEVEL_ERROR },
+    };
+    site_emit_args(&summaries[site->level], (unsigned long long)suppressed, site->file, site->line);
+}
+
+// 限速检查（GCRA，等价于令牌桶）：tat 为下一条日志的理论到达时间，
+// 超前当前时间不超过 (burst - 1) 个间隔时放行并推后一个间隔，否则计入 suppressed；
+// 放行时通过 *suppressed 返回此前被丢弃的条数
+static int site_allow(log_site_t *site, uint64_t *suppressed) {
+    uint64_t interval = __atomic_load_n(&log_rates[site->level].interval, __ATOMIC_RELAXED);
+    if (interval == 0) {
+        return 1;
+    }
+    uint64_t tolerance = __atomic_load_n(&log_rates[site->level].tolerance, __ATOMIC_RELAXED);
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    uint64_t now = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+
+    uint64_t tat = __atomic_load_n(&site->tat, __ATOMIC_RELAXED);
+    for (;;) {
+        uint64_t start = tat > now ? tat : now;
+        if (start - now > tolerance) {
+            // 第一次丢弃时把调用点加入待报告链表
+            if (__atomic_fetch_add(&site->suppressed, 1, __ATOMIC_RELAXED) == 0 &&
+                !__atomic_exchange_n(&site->pending, 1, __ATOMIC_ACQ_REL)) {
+                log_site_t *head = __atomic_load_n(&pending_sites, __ATOMIC_RELAXED);
+                do {
+                    site->pending_next = head;
+                } while (!__atomic_compare_exchange_n(&pending_sites, &head, site, 1,
+                                                      __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+            }
+            return 0;
+        }
+        if (__atomic_compare_exchange_n(&site->tat, &tat, start + interval, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+    *suppressed = __atomic_load_n(&site->suppressed, __ATOMIC_RELAXED) ?
+                  __atomic_exchange_n(&site->suppressed, 0, __ATOMIC_RELAXED) : 0;
+    return 1;
+}
+
+// 在调用点记录一条日志
+void log_write(log_site_t *site, ...) {
+    if (site->level < 0 || site->level >= LOG_LEVEL_COUNT) {
+        return;
+    }
+    uint64_t suppressed = 0;
+    if (!site_allow(site, &suppressed)) {
+        return;
+    }
+    if (suppressed > 0) {
+        report_suppressed(site, suppressed);
+    }
+
+    va_list args;
+    va_start(args, site);
+    site_emit(site, args);
+    va_end(args);
+}
+
+// 报告所有调用点尚未报告的限速丢弃条数：一次取走整个待报告链表，
+// 先读出 next 再清除 pending，之后该调用点可以被重新加入链表
+void log_flush_suppressed() {
+    log_site_t *site = __atomic_exchange_n(&pending_sites, NULL, __ATOMIC_ACQUIRE);
+    while (site) {
+        log_site_t *next = site->pending_next;
+        __atomic_store_n(&site->pending, 0, __ATOMIC_RELEASE);
+        uint64_t suppressed = __atomic_exchange_n(&site->suppressed, 0, __ATOMIC_RELAXED);
+        if (suppressed > 0) {
+            report_suppressed(site, suppressed);
+        }
+        site = next;
+    }
+}
+
+// 设置运行时级别阈值
+void log_set_level(int level) {
+    __atomic_store_n(&log_threshold, level, __ATOMIC_RELAXED);
+}
+
+// 按名称设置运行时级别阈值
+int log_set_level_name(const char *name) {
+    for (int level = 0; level < LOG_LEVEL_COUNT; level++) {
+        if (strcasecmp(name, log_level_name(level)) == 0) {
+            log_set_level(level);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// 设置某个级别每个调用点的限速
+void log_set_rate_limit(int level, int burst, int rate) {
+    if (level < 0 || level >= LOG_LEVEL_COUNT) {
+        return;
+    }
+    uint64_t interval = rate > 0 ? 1000000000ULL / (uint64_t)rate : 0;
+    uint64_t tolerance = burst > 1 ? (uint64_t)(burst - 1) * interval : 0;
+    __atomic_store_n(&log_rates[level].tolerance, tolerance, __ATOMIC_RELAXED);
+    __atomic_store_n(&log_rates[level].interval, interval, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,236 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+#include "include/log.h"
+#include "include/log_format.h"
+
+// 段中的一个格式定义
+typedef struct {
+    int line;
+    int level;
+    char *file;
+    char *format;
+} definition_t;
+
+// 读取整个文件，返回动态分配的内容
+static char *read_file(const char *path, size_t *size) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        perror(path);
+        return NULL;
+    }
+    fseek(fp, 0, SEEK_END);
+    long length = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char *data = length > 0 ? (char *)malloc((size_t)length) : NULL;
+    if (!data || fread(data, 1, (size_t)length, fp) != (size_t)length) {
+        fprintf(stderr, "%s: failed to read file\n", path);
+        free(data);
+        fclose(fp);
+        return NULL;
+    }
+    fclose(fp);
+    *size = (size_t)length;
+    return data;
+}
+
+// 按格式字符串输出一条记录的参数，参数越界时返回 -1
+static int render_message(const char *format, const char *args, const char *end) {
+    const char *p = format;
+    const char *spec;
+    size_t spec_len;
+    int type;
+    while ((spec = log_next_spec(p, &spec_len, &type)) != NULL) {
+        fwrite(p, 1, (size_t)(spec - p), stdout);
+        p = spec + spec_len;
+
+        char conv[32];
+        if (type == LOG_ARG_NONE || spec_len >= sizeof(conv)) {
+            if (type == LOG_ARG_NONE) {
+                putchar('%');
+            }
+            continue;
+        }
+        memcpy(conv, spec, spec_len);
+        conv[spec_len] = '\0';
+
+        if (type == LOG_ARG_STRING) {
+            uint32_t length;
+            if (end - args < 4) {
+                return -1;
+            }
+            memcpy(&length, args, 4);
+            if ((uint64_t)(end - args - 4) < length) {
+                return -1;
+            }
+            char *str = (char *)malloc(length + 1);
+            if (!str) {
+                return -1;
+            }
+            memcpy(str, args + 4, length);
+            str[length] = '\0';
+            printf(conv, str);
+            free(str);
+            args += 4 + length;
+            continue;
+        }
+
+        uint64_t value;
+        if (end - args < 8) {
+            return -1;
+        }
+        memcpy(&value, args, 8);
+        args += 8;
+        switch (type) {
+        case LOG_ARG_INT:
+            printf(conv, (int)value);
+            break;
+        case LOG_ARG_LONG:
+            printf(conv, (long)value);
+            break;
+        case LOG_ARG_LLONG:
+            printf(conv, (long long)value);
+            break;
+        case LOG_ARG_SIZE:
+            printf(conv, (size_t)value);
+            break;
+        case LOG_ARG_INTMAX:
+            printf(conv, (intmax_t)value);
+            break;
+        case LOG_ARG_PTRDIFF:
+            printf(conv, (ptrdiff_t)value);
+            break;
+        case LOG_ARG_DOUBLE: {
+            double d;
+            memcpy(&d, &value, sizeof(d));
+            printf(conv, d);
+            break;
+        }
+        case LOG_ARG_POINTER:
+            printf(conv, (void *)(uintptr_t)value);
+            break;
+        }
+    }
+    fputs(p, stdout);
+    return 0;
+}
+
+// 解码一个段文件，输出与文本日志相同格式的内容；返回解码的日志条数，文件无效时返回 -1
+static long decode_segment(const char *path) {
+    size_t size;
+    char *data = read_file(path, &size);
+    if (!data) {
+        return -1;
+    }
+    if (size < LOG_SEGMENT_HEADER_SIZE || memcmp(data, LOG_SEGMENT_MAGIC, 8) != 0) {
+        fprintf(stderr, "%s: not a log segment\n", path);
+        free(data);
+        return -1;
+    }
+    uint32_t version, pid;
+    memcpy(&version, data + 8, 4);
+    memcpy(&pid, data + 12, 4);
+    if (version != LOG_SEGMENT_VERSION) {
+        fprintf(stderr, "%s: unsupported segment version %u\n", path, version);
+        free(data);
+        return -1;
+    }
+
+    definition_t *defs = NULL;
+    uint32_t def_count = 0;
+    long count = 0;
+    size_t offset = LOG_SEGMENT_HEADER_SIZE;
+    while (size - offset >= LOG_RECORD_HEADER_SIZE) {
+        const char *record = data + offset;
+        uint32_t length, id;
+        uint64_t timestamp;
+        memcpy(&length, record, 4);
+        if (length == 0) {
+            break; // 段结束
+        }
+        if (length < LOG_RECORD_HEADER_SIZE || length > size - offset) {
+            fprintf(stderr, "%s: corrupt record at offset %zu\n", path, offset);
+            break;
+        }
+        memcpy(&id, record + 4, 4);
+        memcpy(&timestamp, record + 8, 8);
+        const char *body = record + LOG_RECORD_HEADER_SIZE;
+        const char *end = record + length;
+        offset += length;
+
+        // 格式定义
+        if (id == 0) {
+            uint32_t def_id;
+            uint16_t file_len, format_len;
+            if (end - body < LOG_DEFINITION_HEADER_SIZE) {
+                continue;
+            }
+            memcpy(&def_id, body, 4);
+            memcpy(&file_len, body + 12, 2);
+            memcpy(&format_len, body + 14, 2);
+            if (def_id == 0 || end - body - LOG_DEFINITION_HEADER_SIZE < file_len + format_len) {
+                continue;
+            }
+            if (def_id > def_count) {
+                definition_t *grown = (definition_t *)realloc(defs, def_id * sizeof(definition_t));
+                if (!grown) {
+                    break;
+                }
+                memset(grown + def_count, 0, (def_id - def_count) * sizeof(definition_t));
+                defs = grown;
+                def_count = def_id;
+            }
+            definition_t *def = &defs[def_id - 1];
+            free(def->file);
+            free(def->format);
+            memcpy(&def->line, body + 4, 4);
+            memcpy(&def->level, body + 8, 4);
+            def->file = strndup(body + LOG_DEFINITION_HEADER_SIZE, file_len);
+            def->format = strndup(body + LOG_DEFINITION_HEADER_SIZE + file_len, format_len);
+            continue;
+        }
+
+        // 日志记录
+        if (id > def_count || !defs[id - 1].format || !defs[id - 1].file) {
+            fprintf(stderr, "%s: record at offset %zu uses unknown format %u\n", path, offset - length, id);
+            continue;
+        }
+        const definition_t *def = &defs[id - 1];
+        time_t seconds = (time_t)(timestamp / 1000000000ULL);
+        struct tm time_info;
+        char stamp[32];
+        localtime_r(&seconds, &time_info);
+        strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &time_info);
+        printf("[%s] [%s] [PID: %u] [%s:%d] ", stamp, log_level_name(def->level), pid, def->file, def->line);
+        if (render_message(def->format, body, end) < 0) {
+            printf("<truncated record>");
+        }
+        putchar('\n');
+        count++;
+    }
+
+    for (uint32_t i = 0; i < def_count; i++) {
+        free(defs[i].file);
+        free(defs[i].format);
+    }
+    free(defs);
+    free(data);
+    return count;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        printf("Usage: %s <segment.bin>...\n", argv[0]);
+        return 1;
+    }
+    int exit_code = 0;
+    for (int i = 1; i < argc; i++) {
+        if (decode_segment(argv[i]) < 0) {
+            exit_code = 1;
+        }
+    }
+    return exit_code;
+}
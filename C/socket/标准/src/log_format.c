@@ -0,0 +1,115 @@
+#include <string.h>
+#include "include/log.h"
+#include "include/log_format.h"
+
+// 查找下一个转换说明
+const char *log_next_spec(const char *format, size_t *spec_len, int *type) {
+    const char *start = strchr(format, '%');
+    if (!start) {
+        return NULL;
+    }
+    const char *p = start + 1;
+    if (*p == '%') {
+        *spec_len = 2;
+        *type = LOG_ARG_NONE;
+        return start;
+    }
+
+    // 标志、宽度和精度；* 需要额外的参数，不支持
+    int supported = 1;
+    while (*p && strchr("-+ #0", *p)) {
+        p++;
+    }
+    while (*p && (strchr("0123456789.", *p) || *p == '*')) {
+        if (*p == '*') {
+            supported = 0;
+        }
+        p++;
+    }
+
+    // 长度修饰符
+    int length = LOG_ARG_INT;
+    if (p[0] == 'h') {
+        p += p[1] == 'h' ? 2 : 1;
+    } else if (p[0] == 'l' && p[1] == 'l') {
+        length = LOG_ARG_LLONG;
+        p += 2;
+    } else if (p[0] == 'l') {
+        length = LOG_ARG_LONG;
+        p++;
+    } else if (p[0] == 'q') {
+        length = LOG_ARG_LLONG;
+        p++;
+    } else if (p[0] == 'z') {
+        length = LOG_ARG_SIZE;
+        p++;
+    } else if (p[0] == 'j') {
+        length = LOG_ARG_INTMAX;
+        p++;
+    } else if (p[0] == 't') {
+        length = LOG_ARG_PTRDIFF;
+        p++;
+    } else if (p[0] == 'L') {
+        supported = 0; // long double
+        p++;
+    }
+
+    // 转换字符
+    switch (*p) {
+    case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+        *type = length;
+        break;
+    case 'c':
+        *type = length == LOG_ARG_INT ? LOG_ARG_INT : -1;
+        break;
+    case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+        *type = LOG_ARG_DOUBLE;
+        break;
+    case 's':
+        *type = length == LOG_ARG_INT ? LOG_ARG_STRING : -1;
+        break;
+    case 'p':
+        *type = LOG_ARG_POINTER;
+        break;
+    default:
+        *type = -1; // %n、%ls 等
+        break;
+    }
+    if (!supported) {
+        *type = -1;
+    }
+    *spec_len = (size_t)(p - start) + (*p ? 1 : 0);
+    return start;
+}
+
+// 解析格式字符串中各参数的类型
+int log_parse_format(const char *format, uint8_t *types, int max_args) {
+    int count = 0;
+    size_t spec_len;
+    int type;
+    const char *p = format;
+    while ((p = log_next_spec(p, &spec_len, &type)) != NULL) {
+        if (type < 0 || (type != LOG_ARG_NONE && count == max_args)) {
+            return -1;
+        }
+        if (type != LOG_ARG_NONE) {
+            types[count++] = (uint8_t)type;
+        }
+        p += spec_len;
+    }
+    return count;
+}
+
+// 日志级别名称
+const char *log_level_name(int level) {
+    switch (level) {
+    case LOG_LEVEL_DEBUG:
+        return "DEBUG";
+    case LOG_LEVEL_INFO:
+        return "INFO";
+    case LOG_LEVEL_ERROR:
+        return "ERROR";
+    default:
+        return "UNKNOWN";
+    }
+}
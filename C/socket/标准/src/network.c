@@ -1,5 +1,11 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/resource.h>
 #include <sys/socket.h>
+#include <netinet/in.h>
 #include <unistd.h>
+#include "include/common.h"
 #include "include/network.h"
 
 // 分块发送数据
@@ -7,7 +13,10 @@ int send_all(int sock, const void *buffer, uint32_t length) {
     uint32_t sent = 0;
     const char *ptr = (const char *)buffer;
     while (sent < length) {
-        ssize_t send_len = send(sock, ptr + sent, length - sent, 0);
+        ssize_t send_len = send(sock, ptr + sent, length - sent, MSG_NOSIGNAL);
+        if (send_len < 0 && errno == EINTR) {
+            continue; // 被信号中断，重试
+        }
         if (send_len <= 0) {
             return -1; // 发送失败
         }
@@ -22,10 +31,130 @@ int receive_all(int sock, void *buffer, uint32_t length) {
     char *ptr = (char *)buffer;
     while (received < length) {
         ssize_t recv_len = recv(sock, ptr + received, length - received, 0);
+        if (recv_len < 0 && errno == EINTR) {
+            continue; // 被信号中断，重试
+        }
         if (recv_len <= 0) {
             return -1; // 接收失败
         }
         received += recv_len;
     }
     return 0; // 接收成功
-}
\ No newline at end of file
+}
+
+// 接收并丢弃数据
+int discard_all(int sock, uint32_t length) {
+    char buf[CHUNK_SIZE];
+    while (length > 0) {
+        uint32_t n = length < sizeof(buf) ? length : sizeof(buf);
+        if (receive_all(sock, buf, n) < 0) {
+            return -1;
+        }
+        length -= n;
+    }
+    return 0;
+}
+
+// 创建监听 socket
+int create_listen_socket(int port, int backlog, int reuseport) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    // 允许重启后立即复用处于 TIME_WAIT 的端口
+    int on = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    // 多个监听 socket 绑定同一端口，由内核按连接四元组分配新连接
+    if (reuseport && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, backlog) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// 设置非阻塞模式
+int set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0) {
+        return -1;
+    }
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+// 提高文件描述符上限
+void raise_fd_limit() {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+}
+
+// 跳过 iov 数组中已传输的字节
+int iov_advance(struct iovec *iov, int iovcnt, size_t bytes) {
+    int i = 0;
+    while (i < iovcnt && bytes >= iov[i].iov_len) {
+        bytes -= iov[i].iov_len;
+        i++;
+    }
+    if (i < iovcnt) {
+        iov[i].iov_base = (char *)iov[i].iov_base + bytes;
+        iov[i].iov_len -= bytes;
+    }
+    return i;
+}
+
+// 聚集发送
+int send_allv(int sock, struct iovec *iov, int iovcnt) {
+    int first = iov_advance(iov, iovcnt, 0); // 跳过开头的空缓冲区
+    while (first < iovcnt) {
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov + first;
+        msg.msg_iovlen = iovcnt - first;
+        ssize_t send_len = sendmsg(sock, &msg, MSG_NOSIGNAL);
+        if (send_len < 0 && errno == EINTR) {
+            continue; // 被信号中断，重试
+        }
+        if (send_len <= 0) {
+            return -1; // 发送失败
+        }
+        first += iov_advance(iov + first, iovcnt - first, send_len);
+    }
+    return 0; // 发送成功
+}
+
+// 分散接收
+int recv_allv(int sock, struct iovec *iov, int iovcnt) {
+    int first = iov_advance(iov, iovcnt, 0); // 跳过开头的空缓冲区
+    while (first < iovcnt) {
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov + first;
+        msg.msg_iovlen = iovcnt - first;
+        ssize_t recv_len = recvmsg(sock, &msg, 0);
+        if (recv_len < 0 && errno == EINTR) {
+            continue; // 被信号中断，重试
+        }
+        if (recv_len <= 0) {
+            return -1; // 接收失败
+        }
+        first += iov_advance(iov + first, iovcnt - first, recv_len);
+    }
+    return 0; // 接收成功
+}
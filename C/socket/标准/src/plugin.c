@@ -0,0 +1,324 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <dlfcn.h>
+#include <limits.h>
+#include <signal.h>
+#include "include/plugin.h"
+#include "include/rcu.h"
+#include "include/log.h"
+
+// 已加载的插件
+typedef struct plugin {
+    char file[NAME_MAX + 1];  // 插件文件名（重新加载时按文件名对应新旧版本）
+    void *handle;             // dlopen 句柄
+    const plugin_info_t *info; // 插件描述
+    struct plugin *next;
+} plugin_t;
+
+// 被插件覆盖的处理函数：插件第一次发布某个ID时保存原来的函数项（不存在时各函数指针为 NULL），
+// 不再有插件提供该ID时恢复，内置处理函数的流式处理函数等不会因插件的加载和删除而丢失
+typedef struct displaced {
+    function_t func;
+    struct displaced *next;
+} displaced_t;
+
+static plugin_t *plugins = NULL;          // 当前发布的插件（只由主线程访问）
+static displaced_t *displaced = NULL;     // 被插件覆盖的处理函数（只由主线程访问）
+static char plugin_dir[PATH_MAX] = "";    // 插件目录
+static volatile sig_atomic_t reload_requested = 0;
+
+// 复制文件
+static int copy_file(const char *src, int out) {
+    int in = open(src, O_RDONLY);
+    if (in < 0) {
+        return -1;
+    }
+    char buf[CHUNK_SIZE];
+    ssize_t n;
+    while ((n = read(in, buf, sizeof(buf))) > 0) {
+        if (write(out, buf, n) != n) {
+            n = -1;
+            break;
+        }
+    }
+    close(in);
+    return n < 0 ? -1 : 0;
+}
+
+// 把插件复制到临时文件后加载：同一路径重复 dlopen 只会返回已加载的版本，
+// 直接覆盖正在使用的 .so 文件也会破坏已映射的代码；加载后删除临时文件，映射仍然有效
+static void *open_plugin_copy(const char *path) {
+    char tmp[] = "/tmp/plugin-XXXXXX.so";
+    int out = mkstemps(tmp, 3);
+    if (out < 0) {
+        LOG_ERROR("Failed to create temporary file for plugin %s", path);
+        return NULL;
+    }
+    int ret = copy_file(path, out);
+    close(out);
+    void *handle = NULL;
+    if (ret < 0) {
+        LOG_ERROR("Failed to copy plugin %s", path);
+    } else if (!(handle = dlopen(tmp, RTLD_NOW | RTLD_LOCAL))) {
+        LOG_ERROR("Failed to load plugin %s: %s", path, dlerror());
+    }
+    unlink(tmp);
+    return handle;
+}
+
+// 加载单个插件并调用其初始化函数
+static plugin_t *load_plugin(const char *dir, const char *file) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", dir, file);
+
+    void *handle = open_plugin_copy(path);
+    if (!handle) {
+        return NULL;
+    }
+    const plugin_info_t *info = (const plugin_info_t *)dlsym(handle, PLUGIN_INFO_SYMBOL);
+    if (!info || info->abi_version != PLUGIN_ABI_VERSION || info->handler_count < 0 ||
+        (info->handler_count > 0 && !info->handlers)) {
+        LOG_ERROR("Plugin %s has no valid %s (ABI version %d required)", path, PLUGIN_INFO_SYMBOL, PLUGIN_ABI_VERSION);
+        dlclose(handle);
+        return NULL;
+    }
+    if (info->init && info->init() != 0) {
+        LOG_ERROR("Plugin %s failed to initialize", path);
+        dlclose(handle);
+        return NULL;
+    }
+
+    plugin_t *plugin = (plugin_t *)calloc(1, sizeof(plugin_t));
+    if (!plugin) {
+        if (info->fini) {
+            info->fini();
+        }
+        dlclose(handle);
+        return NULL;
+    }
+    snprintf(plugin->file, sizeof(plugin->file), "%s", file);
+    plugin->handle = handle;
+    plugin->info = info;
+    return plugin;
+}
+
+// 卸载插件（调用方保证已没有请求使用其处理函数）
+static void unload_plugin(plugin_t *plugin) {
+    if (plugin->info->fini) {
+        plugin->info->fini();
+    }
+    dlclose(plugin->handle);
+    free(plugin);
+}
+
+// 文件名是否以 .so 结尾
+static int is_plugin_file(const char *name) {
+    size_t len = strlen(name);
+    return name[0] != '.' && len > 3 && strcmp(name + len - 3, ".so") == 0;
+}
+
+// 从链表中摘下指定文件名的插件
+static plugin_t *take_plugin(plugin_t **list, const char *file) {
+    for (plugin_t **p = list; *p; p = &(*p)->next) {
+        if (strcmp((*p)->file, file) == 0) {
+            plugin_t *plugin = *p;
+            *p = plugin->next;
+            plugin->next = NULL;
+            return plugin;
+        }
+    }
+    return NULL;
+}
+
+// 扫描插件目录加载每个插件的新版本；加载失败时保留旧版本（从 old 中摘下放入新链表），
+// 返回新链表，old 中剩余的是需要卸载的旧版本
+static plugin_t *scan_plugins(const char *dir, plugin_t **old, int *loaded) {
+    plugin_t *list = NULL;
+    *loaded = 0;
+
+    DIR *d = opendir(dir);
+    if (!d) {
+        LOG_ERROR("Failed to open plugin directory %s", dir);
+        return NULL;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(d)) != NULL) {
+        if (!is_plugin_file(entry->d_name)) {
+            continue;
+        }
+        plugin_t *plugin = load_plugin(dir, entry->d_name);
+        if (plugin) {
+            (*loaded)++;
+        } else if (old && (plugin = take_plugin(old, entry->d_name)) != NULL) {
+            LOG_ERROR("Keeping previous version of plugin %s", entry->d_name);
+        }
+        if (plugin) {
+            plugin->next = list;
+            list = plugin;
+        }
+    }
+    closedir(d);
+    return list;
+}
+
+// 链表中是否有插件提供指定ID
+static int provides_id(const plugin_t *list, int id) {
+    for (; list; list = list->next) {
+        for (int i = 0; i < list->info->handler_count; i++) {
+            if (list->info->handlers[i].id == id) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+// 从链表中摘下指定ID的被覆盖函数项
+static displaced_t *take_displaced(int id) {
+    for (displaced_t **p = &displaced; *p; p = &(*p)->next) {
+        if ((*p)->func.id == id) {
+            displaced_t *entry = *p;
+            *p = entry->next;
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+// 插件第一次发布 id 前保存当前的函数项；已保存过（ID已由插件提供）时不重复保存
+static int save_displaced(int id) {
+    for (displaced_t *entry = displaced; entry; entry = entry->next) {
+        if (entry->func.id == id) {
+            return 0;
+        }
+    }
+    displaced_t *entry = (displaced_t *)calloc(1, sizeof(displaced_t));
+    if (!entry) {
+        return -1;
+    }
+    entry->func.id = id;
+    rcu_read_lock();
+    const function_t *func = get_function_by_id(id);
+    if (func) {
+        entry->func = *func;
+    }
+    rcu_read_unlock();
+    entry->next = displaced;
+    displaced = entry;
+    return 0;
+}
+
+// 发布插件的处理函数（替换已有的同ID处理函数，被覆盖的函数项先保存下来）
+static void publish_plugins(const plugin_t *list) {
+    for (; list; list = list->next) {
+        for (int i = 0; i < list->info->handler_count; i++) {
+            const plugin_handler_t *h = &list->info->handlers[i];
+            if (h->id >= RESERVED_FUNCTION_ID_BASE || !h->handler) {
+                LOG_ERROR("Plugin %s: invalid handler for ID %d", list->info->name, h->id);
+                continue;
+            }
+            if (save_displaced(h->id) < 0 || replace_function_v2(h->id, h->handler) < 0) {
+                LOG_ERROR("Plugin %s: failed to register ID %d", list->info->name, h->id);
+            }
+        }
+    }
+}
+
+// old 中提供、但 current 中不再提供的ID：恢复被覆盖的函数项（如内置处理函数），原来不存在时注销
+static void retire_ids(const plugin_t *old, const plugin_t *current) {
+    for (; old; old = old->next) {
+        for (int i = 0; i < old->info->handler_count; i++) {
+            int id = old->info->handlers[i].id;
+            if (provides_id(current, id)) {
+                continue;
+            }
+            displaced_t *entry = take_displaced(id); // 多个插件提供同一ID时只处理一次
+            if (!entry) {
+                continue;
+            }
+            if (entry->func.handler || entry->func.legacy || entry->func.stream) {
+                restore_function(&entry->func);
+            } else {
+                unregister_function(id);
+            }
+            free(entry);
+        }
+    }
+}
+
+// 卸载链表中的所有插件
+static void unload_list(plugin_t *list) {
+    while (list) {
+        plugin_t *next = list->next;
+        unload_plugin(list);
+        list = next;
+    }
+}
+
+// 管理请求：重新加载插件（在请求处理路径上只设置标志，由主线程执行）
+static int admin_reload(const char *input, uint32_t length, output_buffer_t *out, char *error_msg) {
+    if (plugin_dir[0] == '\0') {
+        snprintf(error_msg, ERROR_MSG_SIZE, "No plugin directory configured");
+        return STATUS_INVALID_INPUT;
+    }
+    plugin_request_reload();
+    return output_append(out, "Reload scheduled", 16) == 0 ? STATUS_OK : STATUS_NO_MEMORY;
+}
+
+// 加载插件目录中的所有插件
+int plugin_load_all(const char *dir) {
+    snprintf(plugin_dir, sizeof(plugin_dir), "%s", dir);
+    replace_function_v2(PLUGIN_RELOAD_FUNCTION_ID, admin_reload);
+
+    DIR *d = opendir(dir);
+    if (!d) {
+        LOG_ERROR("Failed to open plugin directory %s", dir);
+        return -1;
+    }
+    closedir(d);
+
+    int loaded;
+    plugins = scan_plugins(dir, NULL, &loaded);
+    publish_plugins(plugins);
+    LOG_INFO("Loaded %d plugins from %s", loaded, dir);
+    return loaded;
+}
+
+// 请求重新加载插件
+void plugin_request_reload() {
+    reload_requested = 1;
+}
+
+// 执行重新加载
+void plugin_poll() {
+    if (!reload_requested || plugin_dir[0] == '\0') {
+        return;
+    }
+    reload_requested = 0;
+
+    plugin_t *old = plugins;
+    int loaded;
+    plugin_t *current = scan_plugins(plugin_dir, &old, &loaded);
+
+    // 先发布新版本，再注销被删除插件的ID；每次替换都会等待宽限期
+    publish_plugins(current);
+    retire_ids(old, current);
+    plugins = current;
+
+    // 旧版本的处理函数已全部被替换或注销，等待宽限期后没有请求还在执行旧代码
+    rcu_synchronize();
+    unload_list(old);
+    LOG_INFO("Reloaded plugins from %s: %d loaded", plugin_dir, loaded);
+}
+
+// 卸载所有插件
+void plugin_unload_all() {
+    retire_ids(plugins, NULL);
+    rcu_synchronize();
+    unload_list(plugins);
+    plugins = NULL;
+}
@@ -0,0 +1,333 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include "include/protocol.h"
+#include "include/network.h"
+#include "include/buffer_pool.h"
+
+// 按大端序写入/读取定长整数
+static void put_u16(uint8_t *p, uint16_t v) {
+    v = htons(v);
+    memcpy(p, &v, sizeof(v));
+}
+
+static void put_u32(uint8_t *p, uint32_t v) {
+    v = htonl(v);
+    memcpy(p, &v, sizeof(v));
+}
+
+static uint16_t get_u16(const uint8_t *p) {
+    uint16_t v;
+    memcpy(&v, p, sizeof(v));
+    return ntohs(v);
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return ntohl(v);
+}
+
+// 编码请求头部
+void encode_header(const header_t *header, uint8_t *buf) {
+    uint8_t flags = 0;
+    if (header->mode == LONG_CONNECTION) {
+        flags |= FLAG_LONG_CONNECTION;
+    }
+    if (header->is_heartbeat) {
+        flags |= FLAG_HEARTBEAT;
+    }
+    if (header->is_batch) {
+        flags |= FLAG_BATCH;
+    }
+    if (header->is_stream) {
+        flags |= FLAG_STREAM;
+    }
+    if (header->is_traced) {
+        flags |= FLAG_TRACE;
+    }
+    put_u16(buf, PROTOCOL_MAGIC);
+    buf[2] = PROTOCOL_VERSION;
+    buf[3] = flags;
+    put_u32(buf + 4, (uint32_t)header->id);
+    put_u32(buf + 8, header->request_id);
+    put_u32(buf + 12, header->length);
+}
+
+// 解码请求头部
+int decode_header(const uint8_t *buf, header_t *header) {
+    if (get_u16(buf) != PROTOCOL_MAGIC || buf[2] != PROTOCOL_VERSION) {
+        return -1;
+    }
+    header->mode = (buf[3] & FLAG_LONG_CONNECTION) ? LONG_CONNECTION : SHORT_CONNECTION;
+    header->is_heartbeat = (buf[3] & FLAG_HEARTBEAT) != 0;
+    header->is_batch = (buf[3] & FLAG_BATCH) != 0;
+    header->is_stream = (buf[3] & FLAG_STREAM) != 0;
+    header->is_traced = (buf[3] & FLAG_TRACE) != 0;
+    header->id = (int)get_u32(buf + 4);
+    header->request_id = get_u32(buf + 8);
+    header->length = get_u32(buf + 12);
+    return 0;
+}
+
+// 响应头部之后的数据：成功时为处理结果，失败时为错误信息
+const char *response_body(const response_t *response, uint32_t *length) {
+    if (response->status != 0) {
+        *length = strnlen(response->error_msg, ERROR_MSG_SIZE);
+        return response->error_msg;
+    }
+    *length = response->length;
+    return response->data;
+}
+
+// 编码响应头部
+uint32_t encode_response(const response_t *response, uint8_t *buf) {
+    uint32_t length;
+    response_body(response, &length);
+    put_u16(buf, PROTOCOL_MAGIC);
+    buf[2] = PROTOCOL_VERSION;
+    buf[3] = (uint8_t)response->status | (response->traced ? STATUS_TRACED : 0);
+    put_u32(buf + 4, response->request_id);
+    put_u32(buf + 8, length);
+    put_u32(buf + 12, (uint32_t)(response->server_time * 1000000.0));
+    if (!response->traced) {
+        return WIRE_RESPONSE_SIZE;
+    }
+    for (int i = 0; i < TRACE_PHASES; i++) {
+        put_u32(buf + WIRE_RESPONSE_SIZE + i * 4, response->trace_ns[i]);
+    }
+    return WIRE_RESPONSE_MAX;
+}
+
+// 解码响应头部
+int decode_response(const uint8_t *buf, response_t *response) {
+    if (get_u16(buf) != PROTOCOL_MAGIC || buf[2] != PROTOCOL_VERSION) {
+        return -1;
+    }
+    response->status = buf[3] & ~STATUS_TRACED;
+    response->traced = (buf[3] & STATUS_TRACED) != 0;
+    response->request_id = get_u32(buf + 4);
+    response->length = get_u32(buf + 8);
+    response->server_time = get_u32(buf + 12) / 1000000.0;
+    response->error_msg[0] = '\0';
+    response->data = NULL;
+    return 0;
+}
+
+// 批量数据编码后的长度
+uint32_t batch_encoded_size(const batch_entry_t *entries, uint32_t count) {
+    uint64_t size = 4 + (uint64_t)count * BATCH_ENTRY_HEADER_SIZE;
+    for (uint32_t i = 0; i < count; i++) {
+        size += entries[i].length;
+    }
+    return size > UINT32_MAX ? 0 : (uint32_t)size;
+}
+
+// 编码批量数据
+void encode_batch(const batch_entry_t *entries, uint32_t count, char *buf) {
+    encode_batch_count(buf, count);
+    buf += 4;
+    for (uint32_t i = 0; i < count; i++) {
+        encode_batch_entry(buf, entries[i].code, entries[i].length);
+        memcpy(buf + BATCH_ENTRY_HEADER_SIZE, entries[i].data, entries[i].length);
+        buf += BATCH_ENTRY_HEADER_SIZE + entries[i].length;
+    }
+}
+
+// 写入条目数
+void encode_batch_count(char *buf, uint32_t count) {
+    put_u32((uint8_t *)buf, count);
+}
+
+// 写入批量条目头部
+void encode_batch_entry(char *buf, int code, uint32_t length) {
+    put_u32((uint8_t *)buf, (uint32_t)code);
+    put_u32((uint8_t *)buf + 4, length);
+}
+
+// 读取批量数据中的条目数
+int decode_batch_count(const char *data, uint32_t length, uint32_t *count, uint32_t *offset) {
+    if (length < 4) {
+        return -1;
+    }
+    *count = get_u32((const uint8_t *)data);
+    *offset = 4;
+    return *count <= MAX_BATCH_ENTRIES ? 0 : -1;
+}
+
+// 读取一个批量条目
+int decode_batch_entry(const char *data, uint32_t length, uint32_t *offset, batch_entry_t *entry) {
+    if (length - *offset < BATCH_ENTRY_HEADER_SIZE) {
+        return -1;
+    }
+    const uint8_t *p = (const uint8_t *)data + *offset;
+    entry->code = (int)get_u32(p);
+    entry->length = get_u32(p + 4);
+    if (entry->length > length - *offset - BATCH_ENTRY_HEADER_SIZE) {
+        return -1;
+    }
+    entry->data = data + *offset + BATCH_ENTRY_HEADER_SIZE;
+    *offset += BATCH_ENTRY_HEADER_SIZE + entry->length;
+    return 0;
+}
+
+// 写入数据块头部
+void encode_chunk_header(uint8_t *buf, uint32_t length) {
+    put_u32(buf, length);
+}
+
+// 读取数据块头部
+uint32_t decode_chunk_header(const uint8_t *buf) {
+    return get_u32(buf);
+}
+
+// 写入流式响应尾部
+void encode_stream_trailer(uint8_t *buf, int status, uint32_t length) {
+    put_u32(buf, (uint32_t)status);
+    put_u32(buf + 4, length);
+}
+
+// 发送请求（头部 + 数据）
+int send_request(int sock, const header_t *header, const void *data) {
+    uint8_t buf[WIRE_HEADER_SIZE];
+    encode_header(header, buf);
+
+    // 头部和数据在一次系统调用中发送
+    struct iovec iov[2];
+    iov[0].iov_base = buf;
+    iov[0].iov_len = WIRE_HEADER_SIZE;
+    iov[1].iov_base = (void *)data;
+    iov[1].iov_len = header->length;
+    return send_allv(sock, iov, 2);
+}
+
+// 接收并解码请求头部
+int receive_header(int sock, header_t *header) {
+    uint8_t buf[WIRE_HEADER_SIZE];
+    if (receive_all(sock, buf, WIRE_HEADER_SIZE) < 0) {
+        return -1;
+    }
+    return decode_header(buf, header);
+}
+
+// 发送响应（头部 + 数据或错误信息）
+int send_response(int sock, const response_t *response) {
+    uint8_t buf[WIRE_RESPONSE_MAX];
+    uint32_t length;
+    const char *body = response_body(response, &length);
+    uint32_t header_len = encode_response(response, buf);
+
+    // 头部和数据在一次系统调用中发送
+    struct iovec iov[2];
+    iov[0].iov_base = buf;
+    iov[0].iov_len = header_len;
+    iov[1].iov_base = (void *)body;
+    iov[1].iov_len = length;
+    return send_allv(sock, iov, 2);
+}
+
+// 接收响应
+int receive_response(int sock, response_t *response, char **data) {
+    uint8_t buf[WIRE_RESPONSE_SIZE];
+    *data = NULL;
+    if (receive_all(sock, buf, WIRE_RESPONSE_SIZE) < 0 || decode_response(buf, response) < 0) {
+        return -1;
+    }
+    if (response->traced) {
+        uint8_t trace[TRACE_BLOCK_SIZE];
+        if (receive_all(sock, trace, TRACE_BLOCK_SIZE) < 0) {
+            return -1;
+        }
+        for (int i = 0; i < TRACE_PHASES; i++) {
+            response->trace_ns[i] = get_u32(trace + i * 4);
+        }
+    }
+
+    // 失败响应：数据为错误信息，超出缓冲区的部分丢弃
+    if (response->status != 0) {
+        uint32_t keep = response->length < ERROR_MSG_SIZE - 1 ? response->length : ERROR_MSG_SIZE - 1;
+        if (receive_all(sock, response->error_msg, keep) < 0) {
+            return -1;
+        }
+        response->error_msg[keep] = '\0';
+        if (discard_all(sock, response->length - keep) < 0) {
+            return -1;
+        }
+        response->length = 0;
+        return 0;
+    }
+
+    // 流式响应：数据块由调用方用 receive_chunk 接收
+    if (response->length == STREAM_LENGTH) {
+        return 0;
+    }
+
+    // 成功响应：额外分配一个字节用于 null 终止符
+    *data = (char *)buffer_alloc(response->length + 1);
+    if (!*data) {
+        return -1;
+    }
+    if (receive_all(sock, *data, response->length) < 0) {
+        buffer_free(*data);
+        *data = NULL;
+        return -1;
+    }
+    (*data)[response->length] = '\0';
+    return 0;
+}
+
+// 发送一个数据块
+int send_chunk(int sock, const void *data, uint32_t length) {
+    uint8_t buf[CHUNK_HEADER_SIZE];
+    encode_chunk_header(buf, length);
+
+    struct iovec iov[2];
+    iov[0].iov_base = buf;
+    iov[0].iov_len = CHUNK_HEADER_SIZE;
+    iov[1].iov_base = (void *)data;
+    iov[1].iov_len = length;
+    return send_allv(sock, iov, 2);
+}
+
+// 发送结束块和尾部
+int send_stream_end(int sock, int status, const char *error_msg) {
+    uint8_t buf[CHUNK_HEADER_SIZE + STREAM_TRAILER_SIZE];
+    uint32_t length = status != 0 ? strnlen(error_msg, ERROR_MSG_SIZE) : 0;
+    encode_chunk_header(buf, 0);
+    encode_stream_trailer(buf + CHUNK_HEADER_SIZE, status, length);
+
+    struct iovec iov[2];
+    iov[0].iov_base = buf;
+    iov[0].iov_len = sizeof(buf);
+    iov[1].iov_base = (void *)error_msg;
+    iov[1].iov_len = length;
+    return send_allv(sock, iov, 2);
+}
+
+// 接收流式响应的一个数据块
+int receive_chunk(int sock, char *buf, response_t *trailer) {
+    uint8_t head[STREAM_TRAILER_SIZE];
+    if (receive_all(sock, head, CHUNK_HEADER_SIZE) < 0) {
+        return -1;
+    }
+    uint32_t length = get_u32(head);
+    if (length > MAX_CHUNK_SIZE) {
+        return -1;
+    }
+    if (length > 0) {
+        return receive_all(sock, buf, length) < 0 ? -1 : (int)length;
+    }
+
+    // 结束块：读取尾部状态和错误信息
+    if (receive_all(sock, head, STREAM_TRAILER_SIZE) < 0) {
+        return -1;
+    }
+    trailer->status = (int)get_u32(head);
+    length = get_u32(head + 4);
+    if (length >= ERROR_MSG_SIZE || receive_all(sock, trailer->error_msg, length) < 0) {
+        return -1;
+    }
+    trailer->error_msg[length] = '\0';
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <sched.h>
+#include <pthread.h>
+#include "include/rcu.h"
+
+// 每个线程的读取状态，各线程只写自己的记录，读路径上没有共享写入
+typedef struct rcu_reader {
+    uint64_t epoch;           // 进入读临界区时的全局纪元，0 表示不在读临界区
+    uint32_t nesting;         // 嵌套深度（只由所属线程访问）
+    struct rcu_reader *prev;  // 所有读取线程链表
+    struct rcu_reader *next;
+} rcu_reader_t;
+
+static uint64_t global_epoch = 1;
+static pthread_mutex_t rcu_mutex = PTHREAD_MUTEX_INITIALIZER; // 串行化写入方并保护读取线程链表
+static rcu_reader_t *readers = NULL;
+static pthread_key_t reader_key;
+static pthread_once_t reader_key_once = PTHREAD_ONCE_INIT;
+static __thread rcu_reader_t *tls_reader = NULL;
+
+// 线程退出时注销读取记录
+static void reader_destructor(void *arg) {
+    rcu_reader_t *reader = (rcu_reader_t *)arg;
+    pthread_mutex_lock(&rcu_mutex);
+    if (reader->prev) {
+        reader->prev->next = reader->next;
+    } else {
+        readers = reader->next;
+    }
+    if (reader->next) {
+        reader->next->prev = reader->prev;
+    }
+    pthread_mutex_unlock(&rcu_mutex);
+    tls_reader = NULL;
+    free(reader);
+}
+
+static void create_reader_key() {
+    pthread_key_create(&reader_key, reader_destructor);
+}
+
+// 获取当前线程的读取记录，首次调用时创建并注册
+static rcu_reader_t *get_reader() {
+    if (tls_reader) {
+        return tls_reader;
+    }
+    pthread_once(&reader_key_once, create_reader_key);
+
+    rcu_reader_t *reader = (rcu_reader_t *)calloc(1, sizeof(rcu_reader_t));
+    if (!reader) {
+        abort(); // 无法注册读取方时继续运行会导致释放仍在使用的数据
+    }
+    pthread_mutex_lock(&rcu_mutex);
+    reader->next = readers;
+    if (readers) {
+        readers->prev = reader;
+    }
+    readers = reader;
+    pthread_mutex_unlock(&rcu_mutex);
+
+    pthread_setspecific(reader_key, reader);
+    tls_reader = reader;
+    return reader;
+}
+
+// 进入读临界区
+void rcu_read_lock() {
+    rcu_reader_t *reader = get_reader();
+    if (reader->nesting++ == 0) {
+        // 顺序一致的写入保证之后对受保护指针的读取不会被重排到记录纪元之前
+        __atomic_store_n(&reader->epoch, __atomic_load_n(&global_epoch, __ATOMIC_RELAXED), __ATOMIC_SEQ_CST);
+    }
+}
+
+// 退出读临界区
+void rcu_read_unlock() {
+    rcu_reader_t *reader = tls_reader;
+    if (--reader->nesting == 0) {
+        __atomic_store_n(&reader->epoch, 0, __ATOMIC_RELEASE);
+    }
+}
+
+// 等待宽限期：推进全局纪元，等待所有仍停留在旧纪元的读取方退出
+void rcu_synchronize() {
+    pthread_mutex_lock(&rcu_mutex);
+    uint64_t target = __atomic_add_fetch(&global_epoch, 1, __ATOMIC_SEQ_CST);
+    for (rcu_reader_t *reader = readers; reader; reader = reader->next) {
+        while (1) {
+            uint64_t epoch = __atomic_load_n(&reader->epoch, __ATOMIC_SEQ_CST);
+            if (epoch == 0 || epoch >= target) {
+                break;
+            }
+            sched_yield();
+        }
+    }
+    pthread_mutex_unlock(&rcu_mutex);
+}
@@ -0,0 +1,553 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/eventfd.h>
+#include "include/functions.h"
+#include "include/buffer_pool.h"
+#include "include/log.h"
+#include "include/network.h"
+#include "include/request.h"
+#include "include/stats.h"
+
+// 创建请求上下文
+request_ctx_t *request_create(void *conn, completion_queue_t *cq, const header_t *header, char *data) {
+    request_ctx_t *ctx = (request_ctx_t *)buffer_alloc(sizeof(request_ctx_t));
+    if (!ctx) {
+        LOG_ERROR("Failed to allocate memory for request");
+        return NULL;
+    }
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->conn = conn;
+    ctx->cq = cq;
+    ctx->header = *header;
+    ctx->data = data;
+    ctx->out_header_len = WIRE_RESPONSE_SIZE;
+    return ctx;
+}
+
+// 释放请求上下文
+void request_free(request_ctx_t *ctx) {
+    buffer_free(ctx->data);
+    buffer_free(ctx->response.data);
+    buffer_free(ctx);
+}
+
+// 调用处理函数并编码响应头部，响应数据直接引用处理结果，发送时不再拷贝
+static void build_response(request_ctx_t *ctx) {
+    trace_stamp(&ctx->trace, TRACE_DISPATCH_START);
+    dispatch_request(&ctx->header, ctx->data, &ctx->response);
+    trace_stamp(&ctx->trace, TRACE_DISPATCH_END);
+    trace_fill_response(&ctx->trace, &ctx->response);
+    ctx->body = response_body(&ctx->response, &ctx->body_len);
+    ctx->out_header_len = encode_response(&ctx->response, ctx->out_header);
+}
+
+// 工作线程中执行处理函数，完成后通知事件循环
+static void process_request_task(void *arg) {
+    request_ctx_t *ctx = (request_ctx_t *)arg;
+    completion_queue_t *cq = ctx->cq;
+
+    build_response(ctx);
+
+    pthread_mutex_lock(&cq->mutex);
+    ctx->next = cq->head;
+    cq->head = ctx;
+    pthread_mutex_unlock(&cq->mutex);
+
+    uint64_t one = 1;
+    if (write(cq->event_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        LOG_ERROR("Failed to notify event loop");
+    }
+}
+
+// 处理请求
+int request_dispatch(thread_pool_t *pool, request_ctx_t *ctx) {
+    // 普通请求统计端到端时间，在响应全部发送后记录
+    if (!ctx->header.is_heartbeat && !ctx->header.is_batch) {
+        ctx->start_ns = stats_now();
+    }
+
+    // 心跳消息开销很小，直接在事件循环中应答
+    if (pool && !ctx->header.is_heartbeat &&
+        thread_pool_try_submit(pool, process_request_task, ctx) == 0) {
+        return 1;
+    }
+
+    // 队列已满时退化为在当前线程处理
+    build_response(ctx);
+    return 0;
+}
+
+// 生成失败响应
+int request_reject(response_queue_t *out, stream_conn_t *sc, const header_t *header, int status, const char *error_msg) {
+    request_ctx_t *ctx = request_create(NULL, NULL, header, NULL);
+    if (!ctx) {
+        return -1;
+    }
+    ctx->response.request_id = header->request_id;
+    ctx->response.status = status;
+    snprintf(ctx->response.error_msg, ERROR_MSG_SIZE, "%s", error_msg);
+    ctx->body = response_body(&ctx->response, &ctx->body_len);
+    encode_response(&ctx->response, ctx->out_header);
+    response_deliver(out, sc, ctx);
+    return 0;
+}
+
+// 开始流式请求
+int stream_conn_begin(stream_conn_t *sc, const header_t *header, response_queue_t *out) {
+    char error_msg[ERROR_MSG_SIZE] = "";
+    sc->header = *header;
+    sc->discard = 0;
+    int status = stream_open(&sc->stream, header->id, error_msg);
+    if (status != STATUS_OK) {
+        sc->discard = 1;
+        return request_reject(out, sc, header, status, error_msg);
+    }
+
+    // 流式响应头部：length 为 STREAM_LENGTH，之后是数据块
+    request_ctx_t *ctx = request_create(NULL, NULL, header, NULL);
+    if (!ctx) {
+        stream_close(&sc->stream);
+        return -1;
+    }
+    ctx->response.request_id = header->request_id;
+    ctx->response.length = STREAM_LENGTH;
+    encode_response(&ctx->response, ctx->out_header);
+    response_queue_push(out, ctx);
+    sc->active = 1;
+    return 0;
+}
+
+// 发送处理函数的输出；出错或输入结束时随后发送结束块和尾部，流式响应结束
+static int stream_conn_emit(stream_conn_t *sc, response_queue_t *out, output_buffer_t *buf,
+                            int status, const char *error_msg, int end) {
+    request_ctx_t *ctx;
+    if (status == STATUS_OK && buf->length > 0) {
+        if (!(ctx = request_create(NULL, NULL, &sc->header, NULL))) {
+            buffer_free(buf->data);
+            return -1;
+        }
+        encode_chunk_header(ctx->out_header, buf->length);
+        ctx->out_header_len = CHUNK_HEADER_SIZE;
+        ctx->response.data = buf->data; // 随请求上下文释放
+        ctx->body = buf->data;
+        ctx->body_len = buf->length;
+        response_queue_push(out, ctx);
+    } else {
+        buffer_free(buf->data);
+    }
+    if (status == STATUS_OK && !end) {
+        return 0;
+    }
+
+    if (!(ctx = request_create(NULL, NULL, &sc->header, NULL))) {
+        return -1;
+    }
+    if (status != STATUS_OK) {
+        snprintf(ctx->response.error_msg, ERROR_MSG_SIZE, "%s", error_msg);
+    }
+    ctx->body = ctx->response.error_msg;
+    ctx->body_len = strnlen(ctx->response.error_msg, ERROR_MSG_SIZE);
+    encode_chunk_header(ctx->out_header, 0);
+    encode_stream_trailer(ctx->out_header + CHUNK_HEADER_SIZE, status, ctx->body_len);
+    ctx->out_header_len = CHUNK_HEADER_SIZE + STREAM_TRAILER_SIZE;
+    response_queue_push(out, ctx);
+
+    // 流式响应结束，释放状态并发送暂存的其他响应；出错时丢弃剩余的数据块
+    stream_close(&sc->stream);
+    sc->active = 0;
+    sc->discard = !end;
+    while (sc->held.head) {
+        ctx = sc->held.head;
+        sc->held.head = ctx->next;
+        response_queue_push(out, ctx);
+    }
+    sc->held.tail = NULL;
+    sc->held.bytes = 0;
+    return 0;
+}
+
+// 处理一个数据块
+int stream_conn_chunk(stream_conn_t *sc, const char *data, uint32_t length, response_queue_t *out) {
+    if (sc->discard) {
+        return 0;
+    }
+    output_buffer_t buf = { NULL, 0, 0 };
+    char error_msg[ERROR_MSG_SIZE] = "";
+    int status = stream_process(&sc->stream, data, length, &buf, error_msg);
+    return stream_conn_emit(sc, out, &buf, status, error_msg, 0);
+}
+
+// 收到结束块
+int stream_conn_end(stream_conn_t *sc, response_queue_t *out) {
+    if (sc->discard) {
+        sc->discard = 0; // 出错的流式请求到此结束，响应已经发送
+        return 0;
+    }
+    output_buffer_t buf = { NULL, 0, 0 };
+    char error_msg[ERROR_MSG_SIZE] = "";
+    int status = stream_finish(&sc->stream, &buf, error_msg);
+    return stream_conn_emit(sc, out, &buf, status, error_msg, 1);
+}
+
+// 释放流式请求状态和暂存的响应
+void stream_conn_abort(stream_conn_t *sc) {
+    if (sc->active) {
+        stream_close(&sc->stream);
+        sc->active = 0;
+    }
+    response_queue_clear(&sc->held);
+}
+
+// 投递处理完成的响应
+void response_deliver(response_queue_t *out, stream_conn_t *sc, request_ctx_t *ctx) {
+    response_queue_push(sc->active ? &sc->held : out, ctx);
+}
+
+// 初始化完成队列
+int completion_queue_init(completion_queue_t *cq) {
+    cq->head = NULL;
+    cq->event_fd = eventfd(0, EFD_NONBLOCK);
+    if (cq->event_fd < 0) {
+        return -1;
+    }
+    pthread_mutex_init(&cq->mutex, NULL);
+    return 0;
+}
+
+// 销毁完成队列
+void completion_queue_destroy(completion_queue_t *cq) {
+    close(cq->event_fd);
+    pthread_mutex_destroy(&cq->mutex);
+}
+
+// 取出所有已完成的请求
+request_ctx_t *completion_queue_drain(completion_queue_t *cq) {
+    pthread_mutex_lock(&cq->mutex);
+    request_ctx_t *done = cq->head;
+    cq->head = NULL;
+    pthread_mutex_unlock(&cq->mutex);
+
+    // 完成链表是后进先出的，反转后按完成顺序返回
+    request_ctx_t *ctx = NULL;
+    while (done) {
+        request_ctx_t *next = done->next;
+        done->next = ctx;
+        ctx = done;
+        done = next;
+    }
+    return ctx;
+}
+
+// 响应入队
+void response_queue_push(response_queue_t *queue, request_ctx_t *ctx) {
+    ctx->next = NULL;
+    if (queue->tail) {
+        queue->tail->next = ctx;
+    } else {
+        queue->head = ctx;
+    }
+    queue->tail = ctx;
+    queue->bytes += ctx->out_header_len + ctx->body_len;
+}
+
+// 把队列中的响应头部和数据收集到 iovec 数组
+int response_queue_gather(response_queue_t *queue, struct iovec *iov, int max_iov) {
+    int iovcnt = 0;
+    for (request_ctx_t *ctx = queue->head; ctx && iovcnt + 2 <= max_iov; ctx = ctx->next) {
+        iov[iovcnt].iov_base = ctx->out_header;
+        iov[iovcnt].iov_len = ctx->out_header_len;
+        iov[iovcnt + 1].iov_base = (void *)ctx->body;
+        iov[iovcnt + 1].iov_len = ctx->body_len;
+        iovcnt += 2;
+    }
+
+    // 跳过队头响应已发送的部分
+    int first = iov_advance(iov, iovcnt, queue->sent);
+    if (first > 0) {
+        memmove(iov, iov + first, (iovcnt - first) * sizeof(struct iovec));
+    }
+    return iovcnt - first;
+}
+
+// 记录已发送的字节，释放已完整发送的响应
+void response_queue_consume(response_queue_t *queue, size_t bytes) {
+    size_t sent = queue->sent + bytes;
+    uint64_t now_ns = 0;
+    queue->bytes -= bytes;
+    while (queue->head) {
+        request_ctx_t *ctx = queue->head;
+        size_t total = ctx->out_header_len + ctx->body_len;
+        if (sent < total) {
+            break;
+        }
+        sent -= total;
+        queue->head = ctx->next;
+        if (ctx->start_ns) {
+            if (!now_ns) {
+                now_ns = stats_now();
+            }
+            stats_record_total(ctx->header.id, now_ns - ctx->start_ns);
+        }
+        if (ctx->trace.active & TRACE_SAMPLE) {
+            trace_finish(&ctx->trace, &ctx->header);
+        }
+        request_free(ctx);
+    }
+    if (!queue->head) {
+        queue->tail = NULL;
+    }
+    queue->sent = sent;
+}
+
+// 释放队列中所有响应
+void response_queue_clear(response_queue_t *queue) {
+    while (queue->head) {
+        request_ctx_t *ctx = queue->head;
+        queue->head = ctx->next;
+        request_free(ctx);
+    }
+    queue->tail = NULL;
+    queue->sent = 0;
+    queue->bytes = 0;
+}
+
+// 初始化解析状态
+void request_reader_init(request_reader_t *reader, void *conn, thread_pool_t *pool, completion_queue_t *cq) {
+    memset(reader, 0, sizeof(*reader));
+    reader->state = CONN_READ_HEADER;
+    reader->accept_ns = stats_now();
+    reader->conn = conn;
+    reader->pool = pool;
+    reader->cq = cq;
+}
+
+// 释放解析状态
+void request_reader_destroy(request_reader_t *reader) {
+    stream_conn_abort(&reader->stream);
+    response_queue_clear(&reader->out);
+    buffer_free(reader->data);
+    reader->data = NULL;
+}
+
+// 开始接收数据或数据块；data 为 NULL 时丢弃
+static void expect_data(request_reader_t *reader, conn_state_t state, char *data, uint32_t length) {
+    reader->data = data;
+    reader->data_length = length;
+    reader->data_received = 0;
+    reader->state = state;
+}
+
+// 一个请求接收完毕：短连接只处理一个请求；长连接继续读取下一个请求
+static void next_request(request_reader_t *reader) {
+    reader->header_received = 0;
+    reader->state = reader->header.mode == LONG_CONNECTION ? CONN_READ_HEADER : CONN_READ_DONE;
+}
+
+// 请求接收完毕：交给线程池处理，或在当前线程直接处理
+static int submit_request(request_reader_t *reader) {
+    trace_stamp(&reader->trace, TRACE_BODY);
+    request_ctx_t *ctx = request_create(reader->conn, reader->cq, &reader->header, reader->data);
+    if (!ctx) {
+        return -1;
+    }
+    reader->data = NULL; // 请求数据的所有权已转移给请求上下文
+    ctx->trace = reader->trace;
+
+    if (request_dispatch(reader->pool, ctx)) {
+        reader->pending++;
+    } else {
+        response_queue_push(&reader->out, ctx);
+    }
+    return 0;
+}
+
+// 请求头部接收完毕：分配数据缓冲区或开始流式请求；返回 -1 表示需要关闭连接
+static int on_header(request_reader_t *reader) {
+    // magic 或版本不匹配时关闭连接
+    if (decode_header(reader->header_buf, &reader->header) < 0) {
+        LOG_ERROR("Invalid request header");
+        return -1;
+    }
+    trace_begin(&reader->trace, &reader->header, &reader->accept_ns);
+
+    if (reader->header.is_stream) {
+        reader->state = CONN_READ_CHUNK_HEADER;
+        return stream_conn_begin(&reader->stream, &reader->header, &reader->out);
+    }
+
+    // 超过上限的请求不分配缓冲区，丢弃数据后返回错误
+    if (reader->header.length > MAX_REQUEST_SIZE) {
+        char error_msg[ERROR_MSG_SIZE];
+        snprintf(error_msg, ERROR_MSG_SIZE, "Request too large (%u bytes, limit %u); use streaming",
+                 reader->header.length, MAX_REQUEST_SIZE);
+        expect_data(reader, CONN_READ_BODY, NULL, reader->header.length);
+        return request_reject(&reader->out, &reader->stream, &reader->header, STATUS_INVALID_INPUT, error_msg);
+    }
+
+    // 分配数据缓冲区，额外分配一个字节用于 null 终止符
+    char *data = (char *)buffer_alloc(reader->header.length + 1);
+    if (!data) {
+        LOG_ERROR("Failed to allocate memory for data");
+        return -1;
+    }
+    expect_data(reader, CONN_READ_BODY, data, reader->header.length);
+    return 0;
+}
+
+// 数据块头部接收完毕，数据块的缓冲区在需要接收时才分配；返回 -1 表示需要关闭连接
+static int on_chunk_header(request_reader_t *reader) {
+    uint32_t length = decode_chunk_header(reader->header_buf);
+    if (length > MAX_CHUNK_SIZE) {
+        LOG_ERROR("Invalid chunk length %u", length);
+        return -1;
+    }
+    if (length == 0) {
+        next_request(reader); // 结束块：流式请求接收完毕
+        return stream_conn_end(&reader->stream, &reader->out);
+    }
+    expect_data(reader, CONN_READ_CHUNK, NULL, length);
+    return 0;
+}
+
+// 下一段数据的接收位置
+int request_reader_want(request_reader_t *reader, char **ptr, uint32_t *want) {
+    switch (reader->state) {
+    case CONN_READ_HEADER:
+    case CONN_READ_CHUNK_HEADER:
+        *ptr = (char *)reader->header_buf + reader->header_received;
+        *want = (reader->state == CONN_READ_HEADER ? WIRE_HEADER_SIZE : CHUNK_HEADER_SIZE) - reader->header_received;
+        return 0;
+    case CONN_READ_CHUNK:
+        // 出错的流式请求丢弃剩余的数据块
+        if (!reader->data && !reader->stream.discard &&
+            !(reader->data = (char *)buffer_alloc(reader->data_length))) {
+            LOG_ERROR("Failed to allocate memory for chunk");
+            return -1;
+        }
+        // fall through
+    case CONN_READ_BODY:
+        *ptr = reader->data ? reader->data + reader->data_received : NULL;
+        *want = reader->data_length - reader->data_received;
+        return 0;
+    default:
+        *ptr = NULL;
+        *want = 0;
+        return 0;
+    }
+}
+
+// 记录接收到的字节并推进状态机
+int request_reader_advance(request_reader_t *reader, uint32_t n) {
+    switch (reader->state) {
+    case CONN_READ_HEADER:
+    case CONN_READ_CHUNK_HEADER: {
+        reader->header_received += n;
+        uint32_t size = reader->state == CONN_READ_HEADER ? WIRE_HEADER_SIZE : CHUNK_HEADER_SIZE;
+        if (reader->header_received < size) {
+            return 0;
+        }
+        reader->header_received = 0;
+        return reader->state == CONN_READ_HEADER ? on_header(reader) : on_chunk_header(reader);
+    }
+    case CONN_READ_BODY:
+        reader->data_received += n;
+        if (reader->data_received < reader->data_length) {
+            return 0;
+        }
+        // 数据接收完毕，调用处理函数（心跳消息由 dispatch_request 直接应答）；超过上限的请求已返回错误
+        if (reader->data) {
+            reader->data[reader->header.length] = '\0';
+            if (submit_request(reader) < 0) {
+                return -1;
+            }
+        }
+        next_request(reader);
+        return 0;
+    case CONN_READ_CHUNK: {
+        reader->data_received += n;
+        if (reader->data_received < reader->data_length) {
+            return 0;
+        }
+        // 数据块接收完毕，在事件循环线程中调用流式处理函数（每次只处理一个数据块）
+        int ret = reader->data ? stream_conn_chunk(&reader->stream, reader->data, reader->data_length, &reader->out) : 0;
+        buffer_free(reader->data);
+        reader->data = NULL;
+        reader->state = CONN_READ_CHUNK_HEADER;
+        return ret;
+    }
+    default:
+        return 0;
+    }
+}
+
+// 把接收缓冲区中的字节交给状态机
+int request_reader_feed(request_reader_t *reader, const char *buf, size_t len) {
+    while (reader->state != CONN_READ_DONE) {
+        // 数据块完整地位于接收缓冲区中，直接处理，不拷贝
+        if (reader->state == CONN_READ_CHUNK && !reader->stream.discard && !reader->data &&
+            reader->data_received == 0 && len >= reader->data_length) {
+            if (stream_conn_chunk(&reader->stream, buf, reader->data_length, &reader->out) < 0) {
+                return -1;
+            }
+            buf += reader->data_length;
+            len -= reader->data_length;
+            reader->state = CONN_READ_CHUNK_HEADER;
+            continue;
+        }
+
+        char *ptr;
+        uint32_t want;
+        if (request_reader_want(reader, &ptr, &want) < 0) {
+            return -1;
+        }
+        uint32_t n = want < len ? want : (uint32_t)len;
+        if (want > 0 && n == 0) {
+            return 0; // 等待更多数据
+        }
+        if (ptr) {
+            memcpy(ptr, buf, n);
+        }
+        buf += n;
+        len -= n;
+        if (request_reader_advance(reader, n) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// 从空闲链表中移除节点
+void idle_list_remove(idle_list_t *list, idle_node_t *node) {
+    if (node->prev) {
+        node->prev->next = node->next;
+    } else if (list->head == node) {
+        list->head = node->next;
+    } else {
+        return; // 不在链表中
+    }
+    if (node->next) {
+        node->next->prev = node->prev;
+    } else {
+        list->tail = node->prev;
+    }
+    node->prev = node->next = NULL;
+}
+
+// 把节点移到空闲链表尾部并刷新活动时间
+void idle_list_touch(idle_list_t *list, idle_node_t *node, time_t now) {
+    if (list->tail != node) {
+        idle_list_remove(list, node);
+        node->prev = list->tail;
+        node->next = NULL;
+        if (list->tail) {
+            list->tail->next = node;
+        } else {
+            list->head = node;
+        }
+        list->tail = node;
+    }
+    node->last_active = now;
+}
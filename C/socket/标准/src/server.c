@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -5,173 +6,573 @@
 #include <pthread.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <errno.h>
+#include <stdint.h>
+#include <time.h>
+#include <signal.h>
+#include <stddef.h>
+#include <sys/epoll.h>
 #include "include/common.h"
 #include "include/functions.h"
 #include "include/log.h"
 #include "include/network.h"
+#include "include/protocol.h"
+#include "include/event_loop.h"
+#include "include/uring_loop.h"
+#include "include/thread_pool.h"
+#include "include/plugin.h"
+#include "include/buffer_pool.h"
+#include "include/stats.h"
+#include "include/trace.h"
+#include "include/request.h"
 
-void *handle_client(void *arg) {
-    int conn_fd = *(int *)arg;
-    header_t header;
+#define POOL_STATS_INTERVAL 10 // 线程池和缓冲区池统计信息输出间隔（秒）
+#define DEFAULT_BACKLOG 1024   // 默认监听队列长度（实际上限受 net.core.somaxconn 限制）
+#define REQUEST_READ_TIMEOUT 5 // 线程池模式下连接可读后读取完整请求的超时（秒）
+
+// 服务端并发模型
+typedef enum {
+    MODE_EPOLL,   // epoll 事件循环
+    MODE_URING,   // io_uring 事件循环
+    MODE_THREAD   // 线程池阻塞模型
+} server_mode_t;
+
+// 在连接上处理一个流式请求：每收到一个数据块调用一次处理函数并立即发送输出，
+// 出错后丢弃剩余的数据块；返回 -1 表示连接需要关闭
+static int serve_stream(int conn_fd, const header_t *header) {
     response_t response;
+    memset(&response, 0, sizeof(response));
+    response.request_id = header->request_id;
 
-    // 初始化响应包
-    response.status = 0; // 默认状态为成功
-    memset(response.error_msg, 0, ERROR_MSG_SIZE);
-    response.length = 0;
-    response.server_time = 0;
-    response.data = NULL;
-
-    // 接收数据包头部
-    if (receive_all(conn_fd, &header, sizeof(header_t)) < 0) {
-        LOG_ERROR("Failed to receive header");
-        free(arg); // 释放动态分配的 conn_fd
-        return NULL;
-    }
-
-    // 检查是否为心跳消息
-    if (header.is_heartbeat) {
-        // 处理心跳消息
-        response.status = 0;
-        response.length = 0;
-        send_all(conn_fd, &response, sizeof(response_t));
-        close(conn_fd);
-        free(arg); // 释放动态分配的 conn_fd
-        return NULL;
+    // 函数不存在或不支持流式请求时发送普通失败响应；否则发送流式响应头部
+    stream_t stream;
+    response.status = stream_open(&stream, header->id, response.error_msg);
+    int ok = response.status == STATUS_OK;
+    if (!ok && send_response(conn_fd, &response) < 0) {
+        return -1;
+    }
+    if (ok) {
+        uint8_t buf[WIRE_RESPONSE_SIZE];
+        response.length = STREAM_LENGTH;
+        encode_response(&response, buf);
+        if (send_all(conn_fd, buf, WIRE_RESPONSE_SIZE) < 0) {
+            stream_close(&stream);
+            return -1;
+        }
+    }
+
+    char *chunk = (char *)buffer_alloc(MAX_CHUNK_SIZE);
+    int ret = chunk ? 0 : -1;
+    while (ret == 0) {
+        uint8_t head[CHUNK_HEADER_SIZE];
+        uint32_t length;
+        if (receive_all(conn_fd, head, CHUNK_HEADER_SIZE) < 0 ||
+            (length = decode_chunk_header(head)) > MAX_CHUNK_SIZE ||
+            receive_all(conn_fd, chunk, length) < 0) {
+            LOG_ERROR("Failed to receive chunk");
+            ret = -1;
+            break;
+        }
+        if (!ok) {
+            if (length == 0) {
+                break; // 出错的流式请求到此结束
+            }
+            continue;
+        }
+
+        // 数据块交给处理函数，结束块时调用 finish
+        output_buffer_t out = { NULL, 0, 0 };
+        char error_msg[ERROR_MSG_SIZE] = "";
+        int status = length > 0 ? stream_process(&stream, chunk, length, &out, error_msg)
+                                : stream_finish(&stream, &out, error_msg);
+        if (status == STATUS_OK && out.length > 0 && send_chunk(conn_fd, out.data, out.length) < 0) {
+            ret = -1;
+        }
+        buffer_free(out.data);
+        if (ret == 0 && (status != STATUS_OK || length == 0)) {
+            ok = 0;
+            stream_close(&stream);
+            ret = send_stream_end(conn_fd, status, error_msg);
+            if (length == 0) {
+                break;
+            }
+        }
+    }
+    if (ok) {
+        stream_close(&stream);
+    }
+    buffer_free(chunk);
+    return ret;
+}
+
+// 在连接上处理一个请求；*accept_ns 为连接接受时间，由第一个请求的跟踪记录取走；
+// submit_ns 为连接交给线程池的时间，计入排队阶段；返回 -1 表示连接需要关闭
+static int serve_request(int conn_fd, header_t *header, int first, uint64_t *accept_ns, uint64_t submit_ns) {
+    response_t response;
+    trace_t trace;
+
+    // 接收数据包头部（长连接上后续请求接收失败通常是对端关闭或空闲超时）
+    if (receive_header(conn_fd, header) < 0) {
+        if (first) {
+            LOG_ERROR("Failed to receive header");
+        }
+        return -1;
+    }
+    trace_begin(&trace, header, accept_ns);
+    trace_queued(&trace, submit_ns);
+    if (header->is_stream) {
+        return serve_stream(conn_fd, header);
+    }
+
+    // 超过上限的请求不分配缓冲区，丢弃数据后返回错误
+    if (header->length > MAX_REQUEST_SIZE) {
+        memset(&response, 0, sizeof(response));
+        response.request_id = header->request_id;
+        response.status = STATUS_INVALID_INPUT;
+        snprintf(response.error_msg, ERROR_MSG_SIZE, "Request too large (%u bytes, limit %u); use streaming",
+                 header->length, MAX_REQUEST_SIZE);
+        if (discard_all(conn_fd, header->length) < 0 || send_response(conn_fd, &response) < 0) {
+            return -1;
+        }
+        return 0;
     }
 
     // 分配数据缓冲区，额外分配一个字节用于 null 终止符
-    char *data = (char *)malloc(header.length + 1);
+    char *data = (char *)buffer_alloc(header->length + 1);
     if (!data) {
         LOG_ERROR("Failed to allocate memory for data");
-        free(arg); // 释放动态分配的 conn_fd
-        return NULL;
+        return -1;
     }
 
     // 接收数据
-    if (receive_all(conn_fd, data, header.length) < 0) {
+    if (receive_all(conn_fd, data, header->length) < 0) {
         LOG_ERROR("Failed to receive data");
-        free(data);
-        free(arg); // 释放动态分配的 conn_fd
-        return NULL;
+        buffer_free(data);
+        return -1;
     }
 
     // 确保数据以 null 结尾
-    data[header.length] = '\0';
-
-    // 根据ID调用处理函数
-    function_t *func = get_function_by_id(header.id);
-    if (!func) {
-        LOG_ERROR("Unknown function ID");
-        response.status = 1; // 状态为失败
-        snprintf(response.error_msg, ERROR_MSG_SIZE, "Unknown function ID: %d", header.id);
-        send_all(conn_fd, &response, sizeof(response_t));
-        free(data);
-        free(arg); // 释放动态分配的 conn_fd
-        return NULL;
-    }
-
-    // 分配响应数据缓冲区
-    response.data = (char *)malloc(header.length * 2); // 假设响应数据不会超过输入数据的两倍
-    if (!response.data) {
-        LOG_ERROR("Failed to allocate memory for response data");
-        free(data);
-        free(arg); // 释放动态分配的 conn_fd
-        return NULL;
-    }
-
-    // 处理请求
-    double start_time = get_current_time();
-    func->handler(data, response.data, &response.length);
-    response.server_time = get_current_time() - start_time;
-
-    // 发送响应头部
-    if (send_all(conn_fd, &response, sizeof(response_t)) < 0) {
-        LOG_ERROR("Failed to send response header");
-        free(data);
-        free(response.data);
-        free(arg); // 释放动态分配的 conn_fd
-        return NULL;
-    }
-
-    // 发送响应数据
-    if (send_all(conn_fd, response.data, response.length) < 0) {
-        LOG_ERROR("Failed to send response data");
-        free(data);
-        free(response.data);
-        free(arg); // 释放动态分配的 conn_fd
-        return NULL;
-    }
-
-    // 关闭连接
-    close(conn_fd);
+    data[header->length] = '\0';
+
+    // 根据ID调用处理函数（心跳消息直接应答）
+    uint64_t start_ns = stats_now();
+    trace_stamp(&trace, TRACE_BODY);
+    trace_stamp(&trace, TRACE_DISPATCH_START);
+    dispatch_request(header, data, &response);
+    trace_stamp(&trace, TRACE_DISPATCH_END);
+    trace_fill_response(&trace, &response);
+
+    // 发送响应头部和响应数据
+    int ret = 0;
+    if (send_response(conn_fd, &response) < 0) {
+        LOG_ERROR("Failed to send response");
+        ret = -1;
+    } else {
+        if (!header->is_heartbeat && !header->is_batch) {
+            stats_record_total(header->id, stats_now() - start_ns);
+        }
+        trace_finish(&trace, header);
+    }
 
     // 释放资源
-    free(data);
-    free(response.data);
-    free(arg); // 释放动态分配的 conn_fd
+    buffer_free(data);
+    buffer_free(response.data);
+    return ret;
+}
+
+// 线程池模式下的连接：两个请求之间停放在接收线程的 epoll 中（EPOLLONESHOT），可读时才交给工作线程
+// 处理一个请求，处理完再放回，因此空闲连接和长连接不占用工作线程
+typedef struct {
+    int fd;
+    uint64_t accept_ns;       // 连接接受时间（单调时钟），由第一个请求的跟踪记录取走
+    uint64_t submit_ns;       // 交给线程池的时间（单调时钟），请求在读取之前的排队计入 queue 阶段
+    int first;                // 是否还没有处理过请求
+    idle_node_t idle;         // 停放期间的空闲链表节点（按最近活动时间排序）
+    struct thread_server *server;
+} thread_conn_t;
+
+// 线程池模式的接收线程（每个分片一个）
+typedef struct thread_server {
+    int epoll_fd;             // 监听 socket 和停放的连接
+    thread_pool_t *pool;
+    pthread_mutex_t mutex;    // 保护 parked：工作线程处理完请求后把连接放回
+    idle_list_t parked;       // 停放的连接
+} thread_server_t;
+
+static thread_conn_t *parked_to_conn(idle_node_t *node) {
+    return (thread_conn_t *)((char *)node - offsetof(thread_conn_t, idle));
+}
+
+// 关闭并释放连接
+static void thread_conn_close(thread_conn_t *conn) {
+    close(conn->fd);
+    buffer_free(conn);
+}
+
+// 把连接放入（op 为 EPOLL_CTL_ADD）或放回（EPOLL_CTL_MOD）epoll 等待下一个请求；
+// 先加入空闲链表再注册，事件可能立即触发；失败返回 -1，由调用方关闭连接
+static int park_connection(thread_conn_t *conn, int op) {
+    thread_server_t *server = conn->server;
+    pthread_mutex_lock(&server->mutex);
+    idle_list_touch(&server->parked, &conn->idle, time(NULL));
+    pthread_mutex_unlock(&server->mutex);
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLONESHOT;
+    ev.data.ptr = conn;
+    if (epoll_ctl(server->epoll_fd, op, conn->fd, &ev) < 0) {
+        LOG_ERROR("Failed to park connection (fd %d): %s", conn->fd, strerror(errno));
+        pthread_mutex_lock(&server->mutex);
+        idle_list_remove(&server->parked, &conn->idle);
+        pthread_mutex_unlock(&server->mutex);
+        return -1;
+    }
+    return 0;
+}
+
+// 在工作线程中处理连接上已到达的一个请求：短连接处理完关闭，长连接放回 epoll
+static void serve_connection(void *arg) {
+    thread_conn_t *conn = (thread_conn_t *)arg;
+    header_t header;
+    int keep = serve_request(conn->fd, &header, conn->first, &conn->accept_ns, conn->submit_ns) == 0 &&
+               header.mode == LONG_CONNECTION;
+    conn->first = 0;
+    if (!keep || park_connection(conn, EPOLL_CTL_MOD) < 0) {
+        thread_conn_close(conn);
+    }
+}
+
+// 接收新连接并停放到 epoll 中
+static void thread_server_accept(thread_server_t *server, int listen_fd) {
+    int conn_fd = accept(listen_fd, NULL, NULL);
+    if (conn_fd < 0) {
+        LOG_ERROR("Failed to accept connection");
+        return;
+    }
+
+    // 连接可读后请求的其余部分应很快到达，读取超时只防止慢速或异常的客户端长期占用工作线程；
+    // 空闲超时由接收线程检查
+    struct timeval timeout;
+    timeout.tv_sec = REQUEST_READ_TIMEOUT;
+    timeout.tv_usec = 0;
+    if (setsockopt(conn_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) < 0) {
+        LOG_ERROR("Failed to set read timeout");
+    }
+
+    // 关闭 Nagle 算法，避免长连接上的小响应被延迟确认拖慢
+    int nodelay = 1;
+    setsockopt(conn_fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+    thread_conn_t *conn = (thread_conn_t *)buffer_alloc(sizeof(thread_conn_t));
+    if (!conn) {
+        LOG_ERROR("Failed to allocate memory for connection");
+        close(conn_fd);
+        return;
+    }
+    memset(conn, 0, sizeof(*conn));
+    conn->fd = conn_fd;
+    conn->accept_ns = stats_now();
+    conn->first = 1;
+    conn->server = server;
+    if (park_connection(conn, EPOLL_CTL_ADD) < 0) {
+        thread_conn_close(conn);
+    }
+}
+
+// 关闭停放超过 IDLE_TIMEOUT 的连接（停放的连接不属于任何工作线程）
+static void close_parked_connections(thread_server_t *server, time_t now) {
+    pthread_mutex_lock(&server->mutex);
+    while (server->parked.head && now - server->parked.head->last_active >= IDLE_TIMEOUT) {
+        thread_conn_t *conn = parked_to_conn(server->parked.head);
+        idle_list_remove(&server->parked, &conn->idle);
+        LOG_INFO("Closing idle connection (fd %d)", conn->fd);
+        thread_conn_close(conn);
+    }
+    pthread_mutex_unlock(&server->mutex);
+}
+
+// 线程池阻塞模型：接收线程用 epoll 等待新连接和停放连接上的请求，只把有请求到达的连接交给工作线程，
+// 工作线程用阻塞 I/O 处理一个请求
+static void run_thread_server(int listen_fd, thread_pool_t *pool) {
+    thread_server_t server;
+    memset(&server, 0, sizeof(server));
+    server.pool = pool;
+    pthread_mutex_init(&server.mutex, NULL);
+    server.epoll_fd = epoll_create1(0);
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+    if (server.epoll_fd < 0 || epoll_ctl(server.epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev) < 0) {
+        LOG_ERROR("Failed to create epoll instance for thread server");
+        return;
+    }
+
+    struct epoll_event events[MAX_EPOLL_EVENTS];
+    time_t last_sweep = time(NULL);
+    while (1) {
+        int n = epoll_wait(server.epoll_fd, events, MAX_EPOLL_EVENTS, 1000);
+        if (n < 0 && errno != EINTR) {
+            LOG_ERROR("epoll_wait failed");
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            thread_conn_t *conn = (thread_conn_t *)events[i].data.ptr;
+            if (!conn) {
+                thread_server_accept(&server, listen_fd);
+                continue;
+            }
+            pthread_mutex_lock(&server.mutex);
+            idle_list_remove(&server.parked, &conn->idle);
+            pthread_mutex_unlock(&server.mutex);
+
+            // 队列已满时阻塞接收线程，限制排队的请求数
+            conn->submit_ns = stats_now();
+            if (thread_pool_submit(pool, serve_connection, conn) < 0) {
+                LOG_ERROR("Failed to submit request to thread pool");
+                thread_conn_close(conn);
+            }
+        }
+        time_t now = time(NULL);
+        if (now != last_sweep) {
+            close_parked_connections(&server, now);
+            last_sweep = now;
+        }
+    }
+    close(server.epoll_fd);
+    pthread_mutex_destroy(&server.mutex);
+}
+
+// 监听分片：每个分片拥有自己的监听 socket、接收循环和连接集合
+typedef struct {
+    int index;                // 分片编号
+    int listen_fd;            // 本分片的监听 socket
+    server_mode_t mode;       // 并发模型
+    thread_pool_t *pool;      // 所有分片共用的线程池（epoll/uring -t 0 时为 NULL）
+    int pin_cpu;              // 绑定的 CPU，-1 表示不绑定
+    pthread_t thread;
+} shard_t;
+
+static int live_shards = 0; // 仍在运行的分片数
+
+// 分片线程入口
+static void *shard_main(void *arg) {
+    shard_t *shard = (shard_t *)arg;
+
+    // 绑定到固定 CPU，使该分片接收的连接始终在同一个核上处理
+    if (shard->pin_cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(shard->pin_cpu, &set);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+            LOG_ERROR("Failed to pin shard %d to CPU %d", shard->index, shard->pin_cpu);
+        }
+    }
+
+    switch (shard->mode) {
+    case MODE_URING:
+        uring_loop_run(shard->listen_fd, shard->pool);
+        break;
+    case MODE_EPOLL:
+        event_loop_run(shard->listen_fd, shard->pool);
+        break;
+    case MODE_THREAD:
+        run_thread_server(shard->listen_fd, shard->pool);
+        break;
+    }
+    __atomic_sub_fetch(&live_shards, 1, __ATOMIC_RELEASE);
     return NULL;
 }
 
-int main() {
-    // 初始化日志模块
-    log_init("./logs");
+// SIGHUP：重新加载插件
+static void handle_sighup(int sig) {
+    (void)sig;
+    plugin_request_reload();
+}
+
+static void usage(const char *prog) {
+    printf("Usage: %s [-m epoll|uring|thread] [-t threads] [-q queue_size] [-s shards] [-b backlog] [-P plugin_dir] [-L block|drop|sync|binary] [-T sample_every]\n", prog);
+}
 
-    // 初始化函数注册表并添加默认处理函数
-    init_function_registry();
-    init_default_functions();
+int main(int argc, char *argv[]) {
+    const char *mode_name = "epoll"; // 默认使用 epoll 事件循环
+    int num_threads = DEFAULT_POOL_THREADS;
+    int queue_size = DEFAULT_POOL_QUEUE_SIZE;
+    int num_shards = 1;
+    int backlog = DEFAULT_BACKLOG;
+    const char *plugin_dir = NULL;
+    const char *log_mode = "block"; // 默认异步写日志，队列满时等待
+    int trace_every = 0; // 每多少个请求采样一个写入跟踪文件，0 表示不采样
 
-    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
-    if (listen_fd < 0) {
-        LOG_ERROR("Failed to create socket");
-        return 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "m:t:q:s:b:P:L:T:h")) != -1) {
+        switch (opt) {
+        case 'm':
+            mode_name = optarg;
+            break;
+        case 't':
+            num_threads = atoi(optarg);
+            break;
+        case 'q':
+            queue_size = atoi(optarg);
+            break;
+        case 's':
+            num_shards = atoi(optarg);
+            break;
+        case 'b':
+            backlog = atoi(optarg);
+            break;
+        case 'P':
+            plugin_dir = optarg;
+            break;
+        case 'L':
+            log_mode = optarg;
+            break;
+        case 'T':
+            trace_every = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
     }
 
-    struct sockaddr_in serv_addr;
-    memset(&serv_addr, 0, sizeof(serv_addr));
-    serv_addr.sin_family = AF_INET;
-    serv_addr.sin_addr.s_addr = htonl(INADDR_ANY);
-    serv_addr.sin_port = htons(SERVER_PORT);
+    server_mode_t mode;
+    if (strcmp(mode_name, "epoll") == 0) {
+        mode = MODE_EPOLL;
+    } else if (strcmp(mode_name, "uring") == 0) {
+        mode = MODE_URING;
+    } else if (strcmp(mode_name, "thread") == 0) {
+        mode = MODE_THREAD;
+    } else {
+        usage(argv[0]);
+        return 1;
+    }
 
-    if (bind(listen_fd, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
-        LOG_ERROR("Failed to bind socket");
+    // 事件驱动模式（epoll / uring）下 -t 0 表示在事件循环线程中直接调用处理函数
+    // -s 0 表示每个在线 CPU 一个分片
+    int ncpu = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (ncpu < 1) {
+        ncpu = 1;
+    }
+    if (num_shards == 0) {
+        num_shards = ncpu;
+    }
+    if (num_threads < (mode == MODE_THREAD ? 1 : 0) || queue_size <= 0 || num_shards < 0 || backlog <= 0 || trace_every < 0) {
+        usage(argv[0]);
         return 1;
     }
 
-    if (listen(listen_fd, 10) < 0) {
-        LOG_ERROR("Failed to listen on socket");
+    // 初始化日志模块：处理线程只把日志格式化到队列，由后台线程批量写文件；-L sync 时直接写文件，
+    // -L binary 时只记录原始参数到内存映射的段文件
+    if (strcmp(log_mode, "sync") == 0) {
+        log_init("./logs");
+    } else if (strcmp(log_mode, "block") == 0) {
+        log_init_async("./logs", LOG_RING_SLOTS, LOG_OVERFLOW_BLOCK);
+    } else if (strcmp(log_mode, "drop") == 0) {
+        log_init_async("./logs", LOG_RING_SLOTS, LOG_OVERFLOW_DROP);
+    } else if (strcmp(log_mode, "binary") == 0) {
+        log_init_binary("./logs");
+    } else {
+        usage(argv[0]);
         return 1;
     }
 
-    LOG_INFO("Server is listening on port 8888...");
+    // 内核不支持所需的 io_uring 特性时回退到 epoll
+    if (mode == MODE_URING && !uring_supported()) {
+        LOG_ERROR("io_uring is not supported by this kernel, falling back to epoll");
+        mode = MODE_EPOLL;
+        mode_name = "epoll";
+    }
 
-    while (1) {
-        int *conn_fd = (int *)malloc(sizeof(int)); // 动态分配 conn_fd
-        if (!conn_fd) {
-            LOG_ERROR("Failed to allocate memory for conn_fd");
-            continue;
+    // 空闲连接不占用线程，各模式都可能同时保持大量连接，尽量提高描述符上限
+    raise_fd_limit();
+
+    // 对端关闭连接时 send 不应终止进程
+    signal(SIGPIPE, SIG_IGN);
+
+    // 初始化函数注册表并添加默认处理函数
+    init_function_registry();
+    init_default_functions();
+    stats_init();
+
+    // 采样的请求以 Chrome 跟踪事件格式写入 logs/trace.json
+    if (trace_every > 0) {
+        trace_init("./logs/trace.json", trace_every);
+    }
+
+    // 加载插件，收到 SIGHUP 时重新加载
+    if (plugin_dir) {
+        plugin_load_all(plugin_dir);
+        signal(SIGHUP, handle_sighup);
+    }
+
+    // 处理函数在线程池中执行，同一连接上的请求可以乱序完成；所有分片共用一个线程池
+    thread_pool_t *pool = NULL;
+    if (num_threads > 0) {
+        pool = thread_pool_create(num_threads, queue_size);
+        if (!pool) {
+            LOG_ERROR("Failed to create thread pool");
+            return 1;
         }
+        LOG_INFO("Thread pool started: %d workers, queue size %d", num_threads, queue_size);
+    }
 
-        *conn_fd = accept(listen_fd, NULL, NULL);
-        if (*conn_fd < 0) {
-            LOG_ERROR("Failed to accept connection");
-            free(conn_fd);
-            continue;
+    // 每个分片创建自己的监听 socket；多个分片时用 SO_REUSEPORT 绑定同一端口，
+    // 由内核把新连接分散到各分片，避免单一接收队列成为瓶颈
+    shard_t *shards = (shard_t *)calloc(num_shards, sizeof(shard_t));
+    if (!shards) {
+        LOG_ERROR("Failed to allocate memory for shards");
+        return 1;
+    }
+    for (int i = 0; i < num_shards; i++) {
+        shards[i].index = i;
+        shards[i].mode = mode;
+        shards[i].pool = pool;
+        shards[i].pin_cpu = num_shards > 1 ? i % ncpu : -1;
+        shards[i].listen_fd = create_listen_socket(SERVER_PORT, backlog, num_shards > 1);
+        if (shards[i].listen_fd < 0) {
+            LOG_ERROR("Failed to create listen socket for shard %d: %s", i, strerror(errno));
+            return 1;
         }
+    }
+
+    LOG_INFO("Server is listening on port %d (mode: %s, shards: %d, backlog: %d)...",
+             SERVER_PORT, mode_name, num_shards, backlog);
 
-        pthread_t thread;
-        if (pthread_create(&thread, NULL, handle_client, conn_fd)) {
-            LOG_ERROR("Failed to create thread");
-            close(*conn_fd);
-            free(conn_fd);
-        } else {
-            pthread_detach(thread); // 分离线程，确保资源被正确释放
+    live_shards = num_shards;
+    for (int i = 0; i < num_shards; i++) {
+        if (pthread_create(&shards[i].thread, NULL, shard_main, &shards[i]) != 0) {
+            LOG_ERROR("Failed to start shard %d", i);
+            return 1;
         }
     }
 
-    close(listen_fd);
+    // 主线程处理插件重新加载请求、每秒报告被限速的日志条数并写出跟踪事件，并定期输出线程池队列深度、等待时间和缓冲区池命中率，直到所有分片退出
+    int elapsed = 0;
+    while (__atomic_load_n(&live_shards, __ATOMIC_ACQUIRE) > 0) {
+        sleep(1);
+        plugin_poll();
+        log_flush_suppressed();
+        trace_flush();
+        if (++elapsed % POOL_STATS_INTERVAL == 0) {
+            if (pool) {
+                thread_pool_log_stats(pool);
+            }
+            buffer_pool_log_stats();
+        }
+    }
+    for (int i = 0; i < num_shards; i++) {
+        pthread_join(shards[i].thread, NULL);
+        close(shards[i].listen_fd);
+    }
+
+    free(shards);
+    plugin_unload_all();
+    if (pool) {
+        thread_pool_destroy(pool);
+    }
     log_cleanup();
     return 0;
 }
@@ -0,0 +1,219 @@
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "include/functions.h"
+#include "include/histogram.h"
+#include "include/stats.h"
+
+#define STATS_SLOT_BITS 8
+#define STATS_MAX_FUNCTIONS (1 << STATS_SLOT_BITS) // 最多统计的不同函数ID数，超出后的函数不统计
+
+// 一个线程对一个函数ID的统计
+typedef struct {
+    uint64_t requests;
+    uint64_t errors;
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+    histogram_t handler;      // 处理时间
+    histogram_t total;        // 端到端时间
+} stats_entry_t;
+
+// 每个线程的统计分片；线程退出后保留，已记录的统计不会丢失
+typedef struct stats_shard {
+    stats_entry_t *entries[STATS_MAX_FUNCTIONS]; // 按槽位索引，首次记录该函数时分配
+    struct stats_shard *next;
+} stats_shard_t;
+
+// 函数ID到槽位的映射（开放寻址，只插入不删除），存放 id + 1，0 表示空槽位
+static uint32_t slot_keys[STATS_MAX_FUNCTIONS];
+static pthread_mutex_t shards_mutex = PTHREAD_MUTEX_INITIALIZER; // 保护分片链表
+static stats_shard_t *shards = NULL;
+static __thread stats_shard_t *tls_shard = NULL;
+static uint64_t start_ns = 0; // 开始统计的时间
+
+// 查找函数ID的槽位，insert 非 0 时不存在则插入；找不到或已满时返回 -1
+static int find_slot(int id, int insert) {
+    uint32_t key = (uint32_t)id + 1;
+    if (key == 0) {
+        return -1;
+    }
+    uint32_t hash = (key * 2654435761u) >> (32 - STATS_SLOT_BITS);
+    for (uint32_t i = 0; i < STATS_MAX_FUNCTIONS; i++) {
+        uint32_t slot = (hash + i) & (STATS_MAX_FUNCTIONS - 1);
+        uint32_t current = __atomic_load_n(&slot_keys[slot], __ATOMIC_ACQUIRE);
+        if (current == 0) {
+            if (!insert) {
+                return -1;
+            }
+            if (__atomic_compare_exchange_n(&slot_keys[slot], &current, key, 0,
+                                            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                return (int)slot;
+            }
+            // 其他线程同时占用了该槽位，current 为它插入的键
+        }
+        if (current == key) {
+            return (int)slot;
+        }
+    }
+    return -1;
+}
+
+// 获取当前线程在槽位上的统计，首次调用时创建分片和统计项；内存不足时返回 NULL
+static stats_entry_t *get_entry(int slot) {
+    stats_shard_t *shard = tls_shard;
+    if (!shard) {
+        if (!(shard = (stats_shard_t *)calloc(1, sizeof(stats_shard_t)))) {
+            return NULL;
+        }
+        pthread_mutex_lock(&shards_mutex);
+        shard->next = shards;
+        shards = shard;
+        pthread_mutex_unlock(&shards_mutex);
+        tls_shard = shard;
+    }
+    stats_entry_t *entry = shard->entries[slot];
+    if (!entry) {
+        if (!(entry = (stats_entry_t *)calloc(1, sizeof(stats_entry_t)))) {
+            return NULL;
+        }
+        __atomic_store_n(&shard->entries[slot], entry, __ATOMIC_RELEASE);
+    }
+    return entry;
+}
+
+// 记录一次处理函数调用
+void stats_record_call(int id, int status, uint64_t bytes_in, uint64_t bytes_out, uint64_t handler_ns) {
+    // 未注册的函数ID不占用槽位，避免任意ID的请求占满映射表
+    if (status == STATUS_UNKNOWN_FUNCTION) {
+        return;
+    }
+    int slot = find_slot(id, 1);
+    stats_entry_t *entry = slot >= 0 ? get_entry(slot) : NULL;
+    if (!entry) {
+        return;
+    }
+    // 分片只由所属线程写入，计数器不需要原子的读-改-写
+    hist_counter_add(&entry->requests, 1);
+    if (status != STATUS_OK) {
+        hist_counter_add(&entry->errors, 1);
+    }
+    hist_counter_add(&entry->bytes_in, bytes_in);
+    hist_counter_add(&entry->bytes_out, bytes_out);
+    hist_record(&entry->handler, handler_ns);
+}
+
+// 记录一个请求的端到端时间（只统计已调用过处理函数的ID）
+void stats_record_total(int id, uint64_t total_ns) {
+    int slot = find_slot(id, 0);
+    stats_entry_t *entry = slot >= 0 ? get_entry(slot) : NULL;
+    if (entry) {
+        hist_record(&entry->total, total_ns);
+    }
+}
+
+// 输出格式化的文本
+static int report_append(output_buffer_t *out, const char *format, ...) __attribute__((format(printf, 2, 3)));
+static int report_append(output_buffer_t *out, const char *format, ...) {
+    char line[512];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if (length >= (int)sizeof(line)) {
+        length = sizeof(line) - 1;
+    }
+    return output_append(out, line, (uint32_t)length);
+}
+
+// 输出一个延迟分布
+static int report_histogram(output_buffer_t *out, const char *name, const histogram_t *hist, int json) {
+    const char *format = json
+        ? "\"%s\":{\"count\":%llu,\"mean\":%.3f,\"p50\":%.3f,\"p99\":%.3f,\"p999\":%.3f,\"max\":%.3f}"
+        : "  %s: count %llu, mean %.3f, p50 %.3f, p99 %.3f, p999 %.3f, max %.3f us\n";
+    return report_append(out, format, name, (unsigned long long)hist->count, hist_mean(hist) / 1000.0,
+                         hist_percentile(hist, 0.5) / 1000.0, hist_percentile(hist, 0.99) / 1000.0,
+                         hist_percentile(hist, 0.999) / 1000.0, hist->max / 1000.0);
+}
+
+static int compare_ids(const void *a, const void *b) {
+    int x = *(const int *)a;
+    int y = *(const int *)b;
+    return x < y ? -1 : x > y;
+}
+
+// 输出所有函数的统计信息
+int stats_report(output_buffer_t *out, int json) {
+    int ids[STATS_MAX_FUNCTIONS];
+    int count = 0;
+    for (int i = 0; i < STATS_MAX_FUNCTIONS; i++) {
+        uint32_t key = __atomic_load_n(&slot_keys[i], __ATOMIC_ACQUIRE);
+        if (key != 0) {
+            ids[count++] = (int)(key - 1);
+        }
+    }
+    qsort(ids, count, sizeof(int), compare_ids);
+
+    stats_entry_t *sum = (stats_entry_t *)malloc(sizeof(stats_entry_t));
+    if (!sum) {
+        return STATUS_NO_MEMORY;
+    }
+    double uptime = (stats_now() - start_ns) / 1e9;
+    int ret = report_append(out, json ? "{\"uptime_s\":%.3f,\"functions\":[" : "Uptime %.3f s\n", uptime);
+    for (int i = 0; ret == 0 && i < count; i++) {
+        // 合并所有线程的分片
+        int slot = find_slot(ids[i], 0);
+        memset(sum, 0, sizeof(*sum));
+        pthread_mutex_lock(&shards_mutex);
+        for (stats_shard_t *shard = shards; shard; shard = shard->next) {
+            stats_entry_t *entry = __atomic_load_n(&shard->entries[slot], __ATOMIC_ACQUIRE);
+            if (entry) {
+                sum->requests += __atomic_load_n(&entry->requests, __ATOMIC_RELAXED);
+                sum->errors += __atomic_load_n(&entry->errors, __ATOMIC_RELAXED);
+                sum->bytes_in += __atomic_load_n(&entry->bytes_in, __ATOMIC_RELAXED);
+                sum->bytes_out += __atomic_load_n(&entry->bytes_out, __ATOMIC_RELAXED);
+                hist_merge(&sum->handler, &entry->handler);
+                hist_merge(&sum->total, &entry->total);
+            }
+        }
+        pthread_mutex_unlock(&shards_mutex);
+
+        const char *format = json
+            ? "%s{\"id\":%d,\"requests\":%llu,\"errors\":%llu,\"bytes_in\":%llu,\"bytes_out\":%llu,"
+            : "%sFunction %d: requests %llu, errors %llu, bytes in %llu, bytes out %llu\n";
+        ret = report_append(out, format, json && i > 0 ? "," : "", ids[i],
+                            (unsigned long long)sum->requests, (unsigned long long)sum->errors,
+                            (unsigned long long)sum->bytes_in, (unsigned long long)sum->bytes_out);
+        if (ret == 0) {
+            ret = report_histogram(out, json ? "handler_us" : "handler", &sum->handler, json);
+        }
+        if (ret == 0 && json) {
+            ret = output_append(out, ",", 1);
+        }
+        if (ret == 0) {
+            ret = report_histogram(out, json ? "total_us" : "total", &sum->total, json);
+        }
+        if (ret == 0 && json) {
+            ret = output_append(out, "}", 1);
+        }
+    }
+    if (ret == 0 && json) {
+        ret = output_append(out, "]}", 2);
+    }
+    free(sum);
+    return ret == 0 ? STATUS_OK : STATUS_NO_MEMORY;
+}
+
+// 管理请求：输出统计信息
+static int admin_stats(const char *input, uint32_t length, output_buffer_t *out, char *error_msg) {
+    (void)error_msg;
+    int json = length == 4 && memcmp(input, "json", 4) == 0;
+    return stats_report(out, json);
+}
+
+// 开始统计并注册管理请求
+void stats_init() {
+    start_ns = stats_now();
+    replace_function_v2(STATS_FUNCTION_ID, admin_stats);
+}
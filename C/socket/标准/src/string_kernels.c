@@ -0,0 +1,160 @@
+#include <stdint.h>
+#include "include/string_kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HAVE_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+// 标量实现：只转换 ASCII 字母，与 "C" 区域设置下的 toupper / tolower 结果相同
+
+static void scalar_upper(char *dst, const char *src, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)src[i];
+        dst[i] = (char)(c - 'a' < 26u ? c - 0x20 : c);
+    }
+}
+
+static void scalar_lower(char *dst, const char *src, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)src[i];
+        dst[i] = (char)(c - 'A' < 26u ? c + 0x20 : c);
+    }
+}
+
+static void scalar_reverse(char *dst, const char *src, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        dst[i] = src[len - 1 - i];
+    }
+}
+
+static const string_kernels_t scalar_kernels = { "scalar", scalar_upper, scalar_lower, scalar_reverse };
+
+#ifdef HAVE_X86_KERNELS
+
+// SSE2 实现（x86-64 基线指令集）
+// 大小写转换：c + (128 - first) 把 [first, first + 26) 映射到有符号最小的 26 个值，一次有符号比较得到字母掩码，
+// 再与 0x20 异或切换大小写
+
+static inline __m128i sse2_flip_case(__m128i v, char first) {
+    __m128i shifted = _mm_add_epi8(v, _mm_set1_epi8((char)(128 - first)));
+    __m128i is_alpha = _mm_cmplt_epi8(shifted, _mm_set1_epi8((char)(-128 + 26)));
+    return _mm_xor_si128(v, _mm_and_si128(is_alpha, _mm_set1_epi8(0x20)));
+}
+
+static void sse2_upper(char *dst, const char *src, size_t len) {
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_si128((__m128i *)(dst + i), sse2_flip_case(v, 'a'));
+    }
+    scalar_upper(dst + i, src + i, len - i);
+}
+
+static void sse2_lower(char *dst, const char *src, size_t len) {
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_si128((__m128i *)(dst + i), sse2_flip_case(v, 'A'));
+    }
+    scalar_lower(dst + i, src + i, len - i);
+}
+
+// SSE2 没有字节洗牌指令：依次反转 4 个双字、每个双字内的 2 个字，再交换每个字内的 2 个字节
+static inline __m128i sse2_reverse16(__m128i v) {
+    v = _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3));
+    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+    v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+static void sse2_reverse(char *dst, const char *src, size_t len) {
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + len - i - 16));
+        _mm_storeu_si128((__m128i *)(dst + i), sse2_reverse16(v));
+    }
+    scalar_reverse(dst + i, src, len - i);
+}
+
+static const string_kernels_t sse2_kernels = { "sse2", sse2_upper, sse2_lower, sse2_reverse };
+
+// AVX2 实现：只为这些函数启用 AVX2 指令，其余代码仍可在不支持 AVX2 的 CPU 上运行
+
+__attribute__((target("avx2")))
+static inline __m256i avx2_flip_case(__m256i v, char first) {
+    __m256i shifted = _mm256_add_epi8(v, _mm256_set1_epi8((char)(128 - first)));
+    __m256i is_alpha = _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(-128 + 26)), shifted);
+    return _mm256_xor_si256(v, _mm256_and_si256(is_alpha, _mm256_set1_epi8(0x20)));
+}
+
+__attribute__((target("avx2")))
+static void avx2_upper(char *dst, const char *src, size_t len) {
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+        _mm256_storeu_si256((__m256i *)(dst + i), avx2_flip_case(v, 'a'));
+    }
+    sse2_upper(dst + i, src + i, len - i);
+}
+
+__attribute__((target("avx2")))
+static void avx2_lower(char *dst, const char *src, size_t len) {
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+        _mm256_storeu_si256((__m256i *)(dst + i), avx2_flip_case(v, 'A'));
+    }
+    sse2_lower(dst + i, src + i, len - i);
+}
+
+// 先在每个 128 位通道内用 vpshufb 反转字节，再交换两个通道
+__attribute__((target("avx2")))
+static void avx2_reverse(char *dst, const char *src, size_t len) {
+    const __m256i mask = _mm256_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+                                          15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + len - i - 32));
+        v = _mm256_shuffle_epi8(v, mask);
+        v = _mm256_permute2x128_si256(v, v, 0x01);
+        _mm256_storeu_si256((__m256i *)(dst + i), v);
+    }
+    sse2_reverse(dst + i, src, len - i);
+}
+
+static const string_kernels_t avx2_kernels = { "avx2", avx2_upper, avx2_lower, avx2_reverse };
+
+#endif // HAVE_X86_KERNELS
+
+static const string_kernels_t *active_kernels = &scalar_kernels;
+
+// 当前 CPU 支持的所有实现
+int string_kernels_available(const string_kernels_t **list, int max) {
+    int n = 0;
+    if (n < max) {
+        list[n++] = &scalar_kernels;
+    }
+#ifdef HAVE_X86_KERNELS
+    __builtin_cpu_init();
+    if (n < max && __builtin_cpu_supports("sse2")) {
+        list[n++] = &sse2_kernels;
+    }
+    if (n < max && __builtin_cpu_supports("avx2")) {
+        list[n++] = &avx2_kernels;
+    }
+#endif
+    return n;
+}
+
+// 选择最快的实现（列表中的最后一个）
+void string_kernels_init() {
+    const string_kernels_t *list[4];
+    int n = string_kernels_available(list, 4);
+    active_kernels = list[n - 1];
+}
+
+// 当前选择的实现
+const string_kernels_t *string_kernels() {
+    return active_kernels;
+}
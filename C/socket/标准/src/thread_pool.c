@@ -0,0 +1,201 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "include/log.h"
+#include "include/thread_pool.h"
+
+// 队列中的任务
+typedef struct {
+    task_fn_t fn;         // 任务函数
+    void *arg;            // 任务参数
+    uint64_t enqueue_ns;  // 入队时间（单调时钟，纳秒）
+} task_t;
+
+// 线程池：固定数量的工作线程 + 有界环形任务队列（多生产者多消费者）
+struct thread_pool {
+    pthread_t *threads;       // 工作线程
+    int num_threads;          // 工作线程数
+    task_t *queue;            // 环形队列
+    uint32_t capacity;        // 队列容量
+    uint32_t head;            // 队头（下一个出队位置）
+    uint32_t count;           // 当前排队任务数
+    int shutdown;             // 是否正在关闭
+    pthread_mutex_t mutex;    // 保护队列和统计信息
+    pthread_cond_t not_empty; // 队列非空条件
+    pthread_cond_t not_full;  // 队列未满条件
+
+    // 统计信息
+    uint32_t max_depth;
+    uint64_t submitted;
+    uint64_t completed;
+    uint64_t rejected;
+    uint64_t total_wait_ns;
+    uint64_t max_wait_ns;
+};
+
+// 获取单调时钟时间（纳秒）
+static uint64_t monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// 工作线程主循环
+static void *worker_thread(void *arg) {
+    thread_pool_t *pool = (thread_pool_t *)arg;
+
+    while (1) {
+        pthread_mutex_lock(&pool->mutex);
+        while (pool->count == 0 && !pool->shutdown) {
+            pthread_cond_wait(&pool->not_empty, &pool->mutex);
+        }
+        if (pool->count == 0 && pool->shutdown) {
+            pthread_mutex_unlock(&pool->mutex);
+            break;
+        }
+
+        // 取出任务并记录排队等待时间
+        task_t task = pool->queue[pool->head];
+        pool->head = (pool->head + 1) % pool->capacity;
+        pool->count--;
+        uint64_t wait_ns = monotonic_ns() - task.enqueue_ns;
+        pool->total_wait_ns += wait_ns;
+        if (wait_ns > pool->max_wait_ns) {
+            pool->max_wait_ns = wait_ns;
+        }
+        pthread_cond_signal(&pool->not_full);
+        pthread_mutex_unlock(&pool->mutex);
+
+        task.fn(task.arg);
+
+        pthread_mutex_lock(&pool->mutex);
+        pool->completed++;
+        pthread_mutex_unlock(&pool->mutex);
+    }
+    return NULL;
+}
+
+// 创建线程池
+thread_pool_t *thread_pool_create(int num_threads, int queue_size) {
+    if (num_threads <= 0 || queue_size <= 0) {
+        return NULL;
+    }
+
+    thread_pool_t *pool = (thread_pool_t *)calloc(1, sizeof(thread_pool_t));
+    if (!pool) {
+        return NULL;
+    }
+    pool->queue = (task_t *)calloc(queue_size, sizeof(task_t));
+    pool->threads = (pthread_t *)calloc(num_threads, sizeof(pthread_t));
+    if (!pool->queue || !pool->threads) {
+        free(pool->queue);
+        free(pool->threads);
+        free(pool);
+        return NULL;
+    }
+    pool->capacity = queue_size;
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->not_empty, NULL);
+    pthread_cond_init(&pool->not_full, NULL);
+
+    // 预先启动所有工作线程
+    for (int i = 0; i < num_threads; i++) {
+        if (pthread_create(&pool->threads[i], NULL, worker_thread, pool)) {
+            LOG_ERROR("Failed to create worker thread %d", i);
+            pool->num_threads = i;
+            thread_pool_destroy(pool);
+            return NULL;
+        }
+    }
+    pool->num_threads = num_threads;
+    return pool;
+}
+
+// 将任务放入队列（调用方需持有锁且保证队列未满）
+static void enqueue_locked(thread_pool_t *pool, task_fn_t fn, void *arg) {
+    uint32_t tail = (pool->head + pool->count) % pool->capacity;
+    pool->queue[tail].fn = fn;
+    pool->queue[tail].arg = arg;
+    pool->queue[tail].enqueue_ns = monotonic_ns();
+    pool->count++;
+    pool->submitted++;
+    if (pool->count > pool->max_depth) {
+        pool->max_depth = pool->count;
+    }
+    pthread_cond_signal(&pool->not_empty);
+}
+
+// 提交任务，队列已满时阻塞等待
+int thread_pool_submit(thread_pool_t *pool, task_fn_t fn, void *arg) {
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->count == pool->capacity && !pool->shutdown) {
+        pthread_cond_wait(&pool->not_full, &pool->mutex);
+    }
+    if (pool->shutdown) {
+        pthread_mutex_unlock(&pool->mutex);
+        return -1;
+    }
+    enqueue_locked(pool, fn, arg);
+    pthread_mutex_unlock(&pool->mutex);
+    return 0;
+}
+
+// 尝试提交任务，队列已满时立即返回
+int thread_pool_try_submit(thread_pool_t *pool, task_fn_t fn, void *arg) {
+    pthread_mutex_lock(&pool->mutex);
+    if (pool->count == pool->capacity || pool->shutdown) {
+        pool->rejected++;
+        pthread_mutex_unlock(&pool->mutex);
+        return -1;
+    }
+    enqueue_locked(pool, fn, arg);
+    pthread_mutex_unlock(&pool->mutex);
+    return 0;
+}
+
+// 获取统计信息
+void thread_pool_get_stats(thread_pool_t *pool, thread_pool_stats_t *stats) {
+    pthread_mutex_lock(&pool->mutex);
+    stats->queue_depth = pool->count;
+    stats->max_queue_depth = pool->max_depth;
+    stats->submitted = pool->submitted;
+    stats->completed = pool->completed;
+    stats->rejected = pool->rejected;
+    uint64_t dequeued = pool->submitted - pool->count;
+    stats->avg_wait_ms = dequeued ? pool->total_wait_ns / (double)dequeued / 1e6 : 0;
+    stats->max_wait_ms = pool->max_wait_ns / 1e6;
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+// 将统计信息写入日志
+void thread_pool_log_stats(thread_pool_t *pool) {
+    thread_pool_stats_t stats;
+    thread_pool_get_stats(pool, &stats);
+    LOG_INFO("Thread pool: depth=%u max_depth=%u submitted=%llu completed=%llu rejected=%llu "
+             "avg_wait=%.3fms max_wait=%.3fms",
+             stats.queue_depth, stats.max_queue_depth,
+             (unsigned long long)stats.submitted, (unsigned long long)stats.completed,
+             (unsigned long long)stats.rejected, stats.avg_wait_ms, stats.max_wait_ms);
+}
+
+// 销毁线程池
+void thread_pool_destroy(thread_pool_t *pool) {
+    pthread_mutex_lock(&pool->mutex);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->not_empty);
+    pthread_cond_broadcast(&pool->not_full);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (int i = 0; i < pool->num_threads; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->not_empty);
+    pthread_cond_destroy(&pool->not_full);
+    free(pool->queue);
+    free(pool->threads);
+    free(pool);
+}
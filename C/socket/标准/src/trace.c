@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "include/log.h"
+#include "include/trace.h"
+
+static FILE *trace_file = NULL;
+static pthread_mutex_t trace_mutex = PTHREAD_MUTEX_INITIALIZER; // 保护 trace_file 和 trace_seq
+static int trace_every = 0;
+static uint64_t trace_base_ns = 0; // 跟踪文件中时间戳的起点
+static uint64_t trace_seq = 0;     // 已写入的请求数，作为 Chrome 跟踪中的线程ID，每个请求一行
+static int trace_pid = 0;
+static __thread int sample_count = 0;
+
+// 相邻时间点之间的阶段名称（阶段 i 从时间点 i 到 i + 1）
+static const char *phase_names[TRACE_STAMP_COUNT - 1] = {
+    "connect", "read", "queue", "handler", "send"
+};
+
+// 开启采样
+int trace_init(const char *path, int sample_every) {
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        LOG_ERROR("Failed to open trace file %s", path);
+        return -1;
+    }
+
+    // Chrome 跟踪事件的 JSON 数组格式允许省略结尾的 ]，进程异常退出时文件仍然可以打开
+    fputs("[\n", fp);
+    trace_base_ns = stats_now();
+    trace_pid = (int)getpid();
+    trace_every = sample_every;
+    __atomic_store_n(&trace_file, fp, __ATOMIC_RELEASE);
+    LOG_INFO("Tracing 1 in %d requests to %s", sample_every, path);
+    return 0;
+}
+
+// 收到请求头部
+void trace_begin(trace_t *trace, const header_t *header, uint64_t *accept_ns) {
+    uint64_t accepted = *accept_ns;
+    *accept_ns = 0;
+    trace->active = 0;
+    if (header->is_heartbeat || header->is_stream) {
+        return;
+    }
+    if (header->is_traced) {
+        trace->active |= TRACE_REPLY;
+    }
+    // 要求返回阶段耗时的请求也写入跟踪文件，不占用采样计数
+    if (__atomic_load_n(&trace_file, __ATOMIC_ACQUIRE)) {
+        if (header->is_traced) {
+            trace->active |= TRACE_SAMPLE;
+        } else if (++sample_count >= trace_every) {
+            sample_count = 0;
+            trace->active |= TRACE_SAMPLE;
+        }
+    }
+    if (trace->active) {
+        memset(trace->ns, 0, sizeof(trace->ns));
+        trace->queued_ns = 0;
+        trace->ns[TRACE_ACCEPT] = accepted;
+        trace->ns[TRACE_HEADER] = stats_now();
+    }
+}
+
+// 请求在读取之前已经排队
+void trace_queued(trace_t *trace, uint64_t submit_ns) {
+    if (trace->active && submit_ns && submit_ns < trace->ns[TRACE_HEADER]) {
+        trace->queued_ns = submit_ns;
+    }
+}
+
+// 两个时间点之间的耗时，超出 uint32 时取最大值
+static uint32_t phase_ns(const trace_t *trace, int from, int to) {
+    if (!trace->ns[from] || !trace->ns[to]) {
+        return 0;
+    }
+    uint64_t elapsed = trace->ns[to] - trace->ns[from];
+    return elapsed > UINT32_MAX ? UINT32_MAX : (uint32_t)elapsed;
+}
+
+// 把阶段耗时填入响应
+void trace_fill_response(const trace_t *trace, response_t *response) {
+    if (!(trace->active & TRACE_REPLY)) {
+        return;
+    }
+    response->traced = 1;
+    for (int i = 0; i < TRACE_PHASES; i++) {
+        response->trace_ns[i] = phase_ns(trace, TRACE_ACCEPT + i, TRACE_ACCEPT + i + 1);
+    }
+
+    // 读取之前的排队时间从 connect 阶段（只有第一个请求有）移到 queue 阶段
+    if (trace->queued_ns) {
+        uint64_t queued = trace->ns[TRACE_HEADER] - trace->queued_ns;
+        uint32_t *connect = &response->trace_ns[TRACE_ACCEPT - TRACE_ACCEPT];
+        uint32_t *queue = &response->trace_ns[TRACE_BODY - TRACE_ACCEPT];
+        *connect = *connect > queued ? *connect - (uint32_t)queued : 0;
+        uint64_t total = *queue + queued;
+        *queue = total > UINT32_MAX ? UINT32_MAX : (uint32_t)total;
+    }
+}
+
+// 时间点相对于跟踪起点的微秒数
+static double trace_us(uint64_t ns) {
+    return (double)(int64_t)(ns - trace_base_ns) / 1000.0;
+}
+
+// 响应发送完毕
+void trace_finish(trace_t *trace, const header_t *header) {
+    if (!(trace->active & TRACE_SAMPLE)) {
+        return;
+    }
+    trace->ns[TRACE_FLUSHED] = stats_now();
+    uint64_t start = trace->ns[TRACE_ACCEPT] ? trace->ns[TRACE_ACCEPT] :
+                     trace->queued_ns ? trace->queued_ns : trace->ns[TRACE_HEADER];
+
+    // 整个请求一个事件，各阶段作为嵌套在其中的事件
+    pthread_mutex_lock(&trace_mutex);
+    uint64_t tid = ++trace_seq;
+    char name[32];
+    if (header->is_batch) {
+        snprintf(name, sizeof(name), "batch");
+    } else {
+        snprintf(name, sizeof(name), "request %d", header->id);
+    }
+    fprintf(trace_file, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%llu,\"ts\":%.3f,\"dur\":%.3f,"
+            "\"args\":{\"function\":%d,\"request_id\":%u,\"length\":%u}},\n",
+            name, trace_pid, (unsigned long long)tid, trace_us(start),
+            (trace->ns[TRACE_FLUSHED] - start) / 1000.0, header->id, header->request_id, header->length);
+    for (int i = 0; i < TRACE_STAMP_COUNT - 1; i++) {
+        if (trace->ns[i] && trace->ns[i + 1]) {
+            fprintf(trace_file, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%llu,\"ts\":%.3f,\"dur\":%.3f},\n",
+                    phase_names[i], trace_pid, (unsigned long long)tid, trace_us(trace->ns[i]),
+                    (trace->ns[i + 1] - trace->ns[i]) / 1000.0);
+        }
+    }
+    // 读取之前的排队（第一个请求中嵌套在 connect 之内）
+    if (trace->queued_ns) {
+        fprintf(trace_file, "{\"name\":\"queue\",\"ph\":\"X\",\"pid\":%d,\"tid\":%llu,\"ts\":%.3f,\"dur\":%.3f},\n",
+                trace_pid, (unsigned long long)tid, trace_us(trace->queued_ns),
+                (trace->ns[TRACE_HEADER] - trace->queued_ns) / 1000.0);
+    }
+    pthread_mutex_unlock(&trace_mutex);
+}
+
+// 把缓冲的跟踪事件写入文件
+void trace_flush() {
+    if (__atomic_load_n(&trace_file, __ATOMIC_ACQUIRE)) {
+        pthread_mutex_lock(&trace_mutex);
+        fflush(trace_file);
+        pthread_mutex_unlock(&trace_mutex);
+    }
+}
@@ -0,0 +1,641 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <linux/io_uring.h>
+#include "include/common.h"
+#include "include/log.h"
+#include "include/protocol.h"
+#include "include/network.h"
+#include "include/request.h"
+#include "include/buffer_pool.h"
+#include "include/event_loop.h"
+#include "include/uring_loop.h"
+
+// 多次 recv 和缓冲区环需要 6.0 以上的内核头文件，否则只编译检测函数
+#ifdef IORING_RECV_MULTISHOT
+
+// user_data 低 3 位表示操作类型，其余位为连接指针
+enum {
+    OP_ACCEPT = 1,
+    OP_RECV,
+    OP_SEND,
+    OP_EVENT,
+    OP_TIMER,
+    OP_CANCEL
+};
+#define OP_MASK 7ULL
+
+// 提交队列 / 完成队列的用户态映射
+typedef struct {
+    int fd;                       // io_uring 实例
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned sq_mask;
+    unsigned sq_entries;
+    unsigned sqe_tail;            // 本地已填充的提交项位置
+    unsigned sqe_submitted;       // 已提交给内核的提交项位置
+    struct io_uring_sqe *sqes;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe *cqes;
+    void *sq_ptr;
+    void *cq_ptr;
+    size_t sq_size;
+    size_t cq_size;
+    size_t sqes_size;
+} ring_t;
+
+// 每个连接的读写状态
+typedef struct uring_conn {
+    idle_node_t idle;         // 空闲链表节点（按最近活动时间排序）
+    int fd;                   // 套接字描述符
+    request_reader_t reader;  // 请求解析状态和待发送的响应队列
+    struct iovec iov[MAX_WRITE_IOV]; // 正在发送的 sendmsg 参数，发送完成前必须保持有效
+    struct msghdr msg;
+    int sending;              // 是否有 sendmsg 在内核中执行
+    int recv_armed;           // 多次 recv 是否仍然有效
+    int throttled;            // 发送队列积压过多，已取消多次 recv 并暂停接收
+    int paced;                // 曾经积压过，改用单次 recv 逐个缓冲区接收
+    int closed;               // 连接已关闭，等待所有操作结束后释放
+} uring_conn_t;
+
+// io_uring 事件循环上下文
+typedef struct {
+    ring_t ring;
+    int listen_fd;            // 监听 socket
+    thread_pool_t *pool;      // 处理函数线程池（NULL 表示在事件循环线程中处理）
+    completion_queue_t cq;    // 线程池处理完成的请求
+    idle_list_t idle;         // 空闲连接链表
+    struct io_uring_buf_ring *buf_ring; // 提供给内核的接收缓冲区环
+    char *bufs;               // 接收缓冲区内存
+    uint16_t buf_tail;        // 缓冲区环尾部
+    struct __kernel_timespec tick; // 空闲检查定时器间隔
+} uring_loop_t;
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+// 创建 io_uring 实例并映射提交队列和完成队列
+static int ring_setup(ring_t *ring, unsigned entries) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    memset(ring, 0, sizeof(*ring));
+    p.flags = IORING_SETUP_CQSIZE;
+    p.cq_entries = entries * 4; // 多次 accept/recv 会为一次提交产生多个完成项
+
+    ring->fd = sys_io_uring_setup(entries, &p);
+    if (ring->fd < 0) {
+        return -1;
+    }
+
+    ring->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    ring->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_size > ring->sq_size) {
+            ring->sq_size = ring->cq_size;
+        }
+        ring->cq_size = ring->sq_size;
+    }
+
+    ring->sq_ptr = mmap(NULL, ring->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ptr == MAP_FAILED) {
+        close(ring->fd);
+        return -1;
+    }
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ptr = ring->sq_ptr;
+    } else {
+        ring->cq_ptr = mmap(NULL, ring->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                            ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ptr == MAP_FAILED) {
+            munmap(ring->sq_ptr, ring->sq_size);
+            close(ring->fd);
+            return -1;
+        }
+    }
+
+    ring->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = (struct io_uring_sqe *)mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                                             MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        if (ring->cq_ptr != ring->sq_ptr) {
+            munmap(ring->cq_ptr, ring->cq_size);
+        }
+        munmap(ring->sq_ptr, ring->sq_size);
+        close(ring->fd);
+        return -1;
+    }
+
+    char *sq = (char *)ring->sq_ptr;
+    char *cq = (char *)ring->cq_ptr;
+    ring->sq_head = (unsigned *)(sq + p.sq_off.head);
+    ring->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    ring->sq_mask = *(unsigned *)(sq + p.sq_off.ring_mask);
+    ring->sq_entries = p.sq_entries;
+    ring->cq_head = (unsigned *)(cq + p.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    ring->cq_mask = *(unsigned *)(cq + p.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    ring->sqe_tail = ring->sqe_submitted = *ring->sq_tail;
+
+    // 提交项下标与提交队列位置一一对应
+    unsigned *array = (unsigned *)(sq + p.sq_off.array);
+    for (unsigned i = 0; i < p.sq_entries; i++) {
+        array[i] = i;
+    }
+    return 0;
+}
+
+// 释放 io_uring 实例
+static void ring_teardown(ring_t *ring) {
+    munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_ptr != ring->sq_ptr) {
+        munmap(ring->cq_ptr, ring->cq_size);
+    }
+    munmap(ring->sq_ptr, ring->sq_size);
+    close(ring->fd);
+}
+
+// 提交已填充的提交项，wait_nr > 0 时等待至少 wait_nr 个完成项
+static int ring_enter(ring_t *ring, unsigned wait_nr) {
+    __atomic_store_n(ring->sq_tail, ring->sqe_tail, __ATOMIC_RELEASE);
+    unsigned to_submit = ring->sqe_tail - ring->sqe_submitted;
+    int ret = sys_io_uring_enter(ring->fd, to_submit, wait_nr, wait_nr ? IORING_ENTER_GETEVENTS : 0);
+    if (ret > 0) {
+        ring->sqe_submitted += ret;
+    }
+    return ret;
+}
+
+// 获取一个空闲的提交项，提交队列已满时先提交给内核
+static struct io_uring_sqe *ring_get_sqe(ring_t *ring) {
+    unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    if (ring->sqe_tail - head >= ring->sq_entries) {
+        ring_enter(ring, 0);
+        head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+        if (ring->sqe_tail - head >= ring->sq_entries) {
+            LOG_ERROR("io_uring submission queue is full");
+            return NULL;
+        }
+    }
+    struct io_uring_sqe *sqe = &ring->sqes[ring->sqe_tail & ring->sq_mask];
+    memset(sqe, 0, sizeof(*sqe));
+    ring->sqe_tail++;
+    return sqe;
+}
+
+// 把接收缓冲区归还给内核
+static void recycle_buffer(uring_loop_t *loop, unsigned bid) {
+    struct io_uring_buf *buf = &loop->buf_ring->bufs[loop->buf_tail & (URING_BUF_COUNT - 1)];
+    buf->addr = (uint64_t)(uintptr_t)(loop->bufs + (size_t)bid * URING_BUF_SIZE);
+    buf->len = URING_BUF_SIZE;
+    buf->bid = bid;
+    loop->buf_tail++;
+    __atomic_store_n(&loop->buf_ring->tail, loop->buf_tail, __ATOMIC_RELEASE);
+}
+
+// 注册接收缓冲区环，recv 完成时由内核从中挑选缓冲区
+static int setup_buffer_ring(uring_loop_t *loop) {
+    size_t ring_size = URING_BUF_COUNT * sizeof(struct io_uring_buf);
+    void *mem = mmap(NULL, ring_size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (mem == MAP_FAILED) {
+        return -1;
+    }
+    loop->buf_ring = (struct io_uring_buf_ring *)mem;
+    loop->bufs = (char *)malloc((size_t)URING_BUF_COUNT * URING_BUF_SIZE);
+    if (!loop->bufs) {
+        munmap(mem, ring_size);
+        return -1;
+    }
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)mem;
+    reg.ring_entries = URING_BUF_COUNT;
+    reg.bgid = 0;
+    if (sys_io_uring_register(loop->ring.fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        free(loop->bufs);
+        munmap(mem, ring_size);
+        return -1;
+    }
+
+    loop->buf_tail = 0;
+    for (unsigned i = 0; i < URING_BUF_COUNT; i++) {
+        recycle_buffer(loop, i);
+    }
+    return 0;
+}
+
+// 释放接收缓冲区环
+static void teardown_buffer_ring(uring_loop_t *loop) {
+    munmap(loop->buf_ring, URING_BUF_COUNT * sizeof(struct io_uring_buf));
+    free(loop->bufs);
+}
+
+// 提交多次 accept：一次提交持续接收新连接
+static void arm_accept(uring_loop_t *loop) {
+    struct io_uring_sqe *sqe = ring_get_sqe(&loop->ring);
+    if (!sqe) {
+        return;
+    }
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = loop->listen_fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->user_data = OP_ACCEPT;
+}
+
+// 提交多次 recv：数据到达时由内核从缓冲区环中挑选缓冲区；
+// 积压过的连接改用单次 recv，每次只接收一个缓冲区，以便及时暂停
+static void arm_recv(uring_loop_t *loop, uring_conn_t *conn) {
+    struct io_uring_sqe *sqe = ring_get_sqe(&loop->ring);
+    if (!sqe) {
+        return;
+    }
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = conn->fd;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = 0;
+    sqe->ioprio = conn->paced ? 0 : IORING_RECV_MULTISHOT;
+    sqe->user_data = (uint64_t)(uintptr_t)conn | OP_RECV;
+    conn->recv_armed = 1;
+}
+
+// 是否需要暂停接收：发送队列积压过多，或在线程池中处理的请求达到 MAX_INFLIGHT_PER_CONN（与 epoll 模式相同，
+// 一个连接流水线发送大量请求时不会占满共享的任务队列，使处理函数回退到事件循环线程中执行）
+static int recv_backlogged(const uring_conn_t *conn) {
+    return conn->reader.out.bytes >= MAX_QUEUED_BYTES || conn->reader.pending >= MAX_INFLIGHT_PER_CONN;
+}
+
+// 需要暂停接收时取消多次 recv，积压发出或请求处理完成后由 resume_recv 重新提交。
+// 取消生效前内核可能已经把数据填入多个接收缓冲区，这些数据仍然会被处理，
+// 因此之后该连接改用单次 recv
+static void throttle_recv(uring_loop_t *loop, uring_conn_t *conn) {
+    if (conn->throttled || conn->closed || !recv_backlogged(conn)) {
+        return;
+    }
+    conn->throttled = 1;
+    int multishot = conn->recv_armed && !conn->paced;
+    conn->paced = 1;
+    if (!multishot) {
+        return; // 单次 recv 完成后不再提交即可
+    }
+    struct io_uring_sqe *sqe = ring_get_sqe(&loop->ring);
+    if (!sqe) {
+        return;
+    }
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->addr = (uint64_t)(uintptr_t)conn | OP_RECV;
+    sqe->user_data = OP_CANCEL;
+}
+
+// 积压已发出且在途请求低于上限，恢复接收
+static void resume_recv(uring_loop_t *loop, uring_conn_t *conn) {
+    if (!conn->throttled || conn->closed || recv_backlogged(conn)) {
+        return;
+    }
+    conn->throttled = 0;
+    if (!conn->recv_armed) {
+        arm_recv(loop, conn);
+    }
+}
+
+// 把发送队列中的响应合并为一次 sendmsg 提交；同一连接同时只有一个发送操作，保证顺序
+static void arm_send(uring_loop_t *loop, uring_conn_t *conn) {
+    if (conn->sending || conn->closed || !conn->reader.out.head) {
+        return;
+    }
+    struct io_uring_sqe *sqe = ring_get_sqe(&loop->ring);
+    if (!sqe) {
+        return;
+    }
+    memset(&conn->msg, 0, sizeof(conn->msg));
+    conn->msg.msg_iov = conn->iov;
+    conn->msg.msg_iovlen = response_queue_gather(&conn->reader.out, conn->iov, MAX_WRITE_IOV);
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = conn->fd;
+    sqe->addr = (uint64_t)(uintptr_t)&conn->msg;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = (uint64_t)(uintptr_t)conn | OP_SEND;
+    conn->sending = 1;
+}
+
+// 等待工作线程的完成通知
+static void arm_event(uring_loop_t *loop) {
+    struct io_uring_sqe *sqe = ring_get_sqe(&loop->ring);
+    if (!sqe) {
+        return;
+    }
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = loop->cq.event_fd;
+    sqe->poll32_events = POLLIN;
+    sqe->user_data = OP_EVENT;
+}
+
+// 每秒触发一次的空闲检查定时器
+static void arm_timer(uring_loop_t *loop) {
+    struct io_uring_sqe *sqe = ring_get_sqe(&loop->ring);
+    if (!sqe) {
+        return;
+    }
+    sqe->opcode = IORING_OP_TIMEOUT;
+    sqe->addr = (uint64_t)(uintptr_t)&loop->tick;
+    sqe->len = 1;
+    sqe->user_data = OP_TIMER;
+}
+
+// 所有操作都结束后释放连接
+static void maybe_free_connection(uring_conn_t *conn) {
+    if (conn->closed && !conn->sending && !conn->recv_armed && conn->reader.pending == 0) {
+        close(conn->fd);
+        request_reader_destroy(&conn->reader);
+        buffer_free(conn);
+    }
+}
+
+// 关闭连接：shutdown 使仍在执行的 recv/sendmsg 尽快结束，全部结束后再释放
+static void close_connection(uring_loop_t *loop, uring_conn_t *conn) {
+    if (conn->closed) {
+        return;
+    }
+    conn->closed = 1;
+    idle_list_remove(&loop->idle, &conn->idle);
+    shutdown(conn->fd, SHUT_RDWR);
+    maybe_free_connection(conn);
+}
+
+// 短连接或对端已关闭写方向：响应全部发送完毕后关闭
+static void finish_if_done(uring_loop_t *loop, uring_conn_t *conn) {
+    if (conn->reader.state == CONN_READ_DONE && conn->reader.pending == 0 && !conn->reader.out.head && !conn->sending) {
+        close_connection(loop, conn);
+    }
+}
+
+// 处理 accept 完成项
+static void on_accept(uring_loop_t *loop, struct io_uring_cqe *cqe, time_t now) {
+    if (!(cqe->flags & IORING_CQE_F_MORE)) {
+        arm_accept(loop); // 多次 accept 已终止，重新提交
+    }
+    if (cqe->res < 0) {
+        LOG_ERROR("Failed to accept connection: %s", strerror(-cqe->res));
+        return;
+    }
+
+    // 关闭 Nagle 算法（accept 由内核完成，在这里对新连接设置）
+    int nodelay = 1;
+    setsockopt(cqe->res, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+    uring_conn_t *conn = (uring_conn_t *)buffer_alloc(sizeof(uring_conn_t));
+    if (!conn) {
+        LOG_ERROR("Failed to allocate memory for connection");
+        close(cqe->res);
+        return;
+    }
+    memset(conn, 0, sizeof(*conn));
+    conn->fd = cqe->res;
+    request_reader_init(&conn->reader, conn, loop->pool, &loop->cq);
+    idle_list_touch(&loop->idle, &conn->idle, now);
+    arm_recv(loop, conn);
+}
+
+// 处理 recv 完成项
+static void on_recv(uring_loop_t *loop, uring_conn_t *conn, struct io_uring_cqe *cqe, time_t now) {
+    if (!(cqe->flags & IORING_CQE_F_MORE)) {
+        conn->recv_armed = 0;
+    }
+
+    if (cqe->flags & IORING_CQE_F_BUFFER) {
+        unsigned bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+        if (cqe->res > 0 && !conn->closed) {
+            idle_list_touch(&loop->idle, &conn->idle, now);
+            if (request_reader_feed(&conn->reader, loop->bufs + (size_t)bid * URING_BUF_SIZE, cqe->res) < 0) {
+                close_connection(loop, conn);
+            }
+        }
+        recycle_buffer(loop, bid); // 数据已拷贝，立即归还缓冲区
+    }
+
+    if (conn->closed) {
+        maybe_free_connection(conn);
+        return;
+    }
+    if (cqe->res == 0 && request_reader_idle(&conn->reader)) {
+        // 对端在请求之间关闭写方向：发送完已有响应后再关闭
+        conn->reader.state = CONN_READ_DONE;
+        arm_send(loop, conn);
+        finish_if_done(loop, conn);
+        return;
+    }
+    if (cqe->res == 0 || (cqe->res < 0 && cqe->res != -ENOBUFS && cqe->res != -ECANCELED)) {
+        close_connection(loop, conn); // 对端关闭或接收出错
+        return;
+    }
+    throttle_recv(loop, conn);
+    if (!conn->recv_armed && !conn->throttled) {
+        arm_recv(loop, conn); // 缓冲区暂时耗尽等原因导致多次 recv 终止，重新提交
+    }
+    arm_send(loop, conn);
+    finish_if_done(loop, conn);
+}
+
+// 处理 sendmsg 完成项
+static void on_send(uring_loop_t *loop, uring_conn_t *conn, struct io_uring_cqe *cqe) {
+    conn->sending = 0;
+    if (conn->closed) {
+        maybe_free_connection(conn);
+        return;
+    }
+    if (cqe->res < 0) {
+        LOG_ERROR("Failed to send response: %s", strerror(-cqe->res));
+        close_connection(loop, conn);
+        return;
+    }
+    response_queue_consume(&conn->reader.out, cqe->res);
+    resume_recv(loop, conn);
+    arm_send(loop, conn); // 发送剩余部分或新完成的响应
+    finish_if_done(loop, conn);
+}
+
+// 处理线程池完成的请求
+static void on_event(uring_loop_t *loop, time_t now) {
+    uint64_t value;
+    while (read(loop->cq.event_fd, &value, sizeof(value)) > 0) {
+    }
+    arm_event(loop);
+
+    request_ctx_t *ctx = completion_queue_drain(&loop->cq);
+    while (ctx) {
+        request_ctx_t *next = ctx->next;
+        uring_conn_t *conn = (uring_conn_t *)ctx->conn;
+        conn->reader.pending--;
+
+        if (conn->closed) {
+            request_free(ctx);
+            maybe_free_connection(conn);
+        } else {
+            response_deliver(&conn->reader.out, &conn->reader.stream, ctx);
+            idle_list_touch(&loop->idle, &conn->idle, now);
+            arm_send(loop, conn);
+            resume_recv(loop, conn); // 在途请求低于上限后恢复接收
+        }
+        ctx = next;
+    }
+}
+
+// 关闭超过空闲超时时间的连接（仍有请求在处理中的连接不算空闲）
+static void on_timer(uring_loop_t *loop, time_t now) {
+    arm_timer(loop);
+    while (loop->idle.head && now - loop->idle.head->last_active >= IDLE_TIMEOUT) {
+        uring_conn_t *conn = (uring_conn_t *)((char *)loop->idle.head - offsetof(uring_conn_t, idle));
+        if (conn->reader.pending > 0 || conn->sending) {
+            idle_list_touch(&loop->idle, &conn->idle, now);
+            continue;
+        }
+        LOG_INFO("Closing idle connection (fd %d)", conn->fd);
+        close_connection(loop, conn);
+    }
+}
+
+// 检测内核版本是否不低于 major.minor
+static int kernel_at_least(int major, int minor) {
+    struct utsname uts;
+    int kmajor = 0, kminor = 0;
+    if (uname(&uts) < 0 || sscanf(uts.release, "%d.%d", &kmajor, &kminor) != 2) {
+        return 0;
+    }
+    return kmajor > major || (kmajor == major && kminor >= minor);
+}
+
+// 检测内核是否支持所需的 io_uring 特性
+int uring_supported() {
+    // 多次 recv 需要 6.0 以上的内核
+    if (!kernel_at_least(6, 0)) {
+        return 0;
+    }
+
+    // io_uring 可能被内核配置或 seccomp 禁用，实际创建一次并注册缓冲区环
+    uring_loop_t loop;
+    memset(&loop, 0, sizeof(loop));
+    if (ring_setup(&loop.ring, 8) < 0) {
+        return 0;
+    }
+    int ok = setup_buffer_ring(&loop) == 0;
+    if (ok) {
+        teardown_buffer_ring(&loop);
+    }
+    ring_teardown(&loop.ring);
+    return ok;
+}
+
+// 运行基于 io_uring 的事件循环
+int uring_loop_run(int listen_fd, thread_pool_t *pool) {
+    uring_loop_t loop;
+    memset(&loop, 0, sizeof(loop));
+    loop.listen_fd = listen_fd;
+    loop.pool = pool;
+    loop.tick.tv_sec = 1;
+
+    if (ring_setup(&loop.ring, URING_ENTRIES) < 0) {
+        LOG_ERROR("Failed to set up io_uring: %s", strerror(errno));
+        return -1;
+    }
+    if (setup_buffer_ring(&loop) < 0) {
+        LOG_ERROR("Failed to register io_uring buffer ring: %s", strerror(errno));
+        ring_teardown(&loop.ring);
+        return -1;
+    }
+    if (completion_queue_init(&loop.cq) < 0) {
+        LOG_ERROR("Failed to create completion queue");
+        teardown_buffer_ring(&loop);
+        ring_teardown(&loop.ring);
+        return -1;
+    }
+
+    arm_accept(&loop);
+    arm_event(&loop);
+    arm_timer(&loop);
+
+    while (1) {
+        // 一次系统调用提交所有新操作并等待完成
+        if (ring_enter(&loop.ring, 1) < 0 && errno != EINTR && errno != EBUSY && errno != EAGAIN) {
+            LOG_ERROR("io_uring_enter failed: %s", strerror(errno));
+            break;
+        }
+
+        time_t now = time(NULL);
+        unsigned head = *loop.ring.cq_head;
+        unsigned tail = __atomic_load_n(loop.ring.cq_tail, __ATOMIC_ACQUIRE);
+        while (head != tail) {
+            struct io_uring_cqe *cqe = &loop.ring.cqes[head & loop.ring.cq_mask];
+            uint64_t op = cqe->user_data & OP_MASK;
+            void *conn = (void *)(uintptr_t)(cqe->user_data & ~OP_MASK);
+            switch (op) {
+            case OP_ACCEPT:
+                on_accept(&loop, cqe, now);
+                break;
+            case OP_RECV:
+                on_recv(&loop, (uring_conn_t *)conn, cqe, now);
+                break;
+            case OP_SEND:
+                on_send(&loop, (uring_conn_t *)conn, cqe);
+                break;
+            case OP_EVENT:
+                on_event(&loop, now);
+                break;
+            case OP_TIMER:
+                on_timer(&loop, now);
+                break;
+            default:
+                break; // OP_CANCEL：取消结果由被取消的 recv 完成项体现
+            }
+            head++;
+            if (head == tail) {
+                // 处理过程中可能产生了新的完成项
+                __atomic_store_n(loop.ring.cq_head, head, __ATOMIC_RELEASE);
+                tail = __atomic_load_n(loop.ring.cq_tail, __ATOMIC_ACQUIRE);
+            }
+        }
+        __atomic_store_n(loop.ring.cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    completion_queue_destroy(&loop.cq);
+    teardown_buffer_ring(&loop);
+    ring_teardown(&loop.ring);
+    return -1;
+}
+
+#else // !IORING_RECV_MULTISHOT
+
+// 内核头文件过旧，不支持 io_uring 后端
+int uring_supported() {
+    return 0;
+}
+
+int uring_loop_run(int listen_fd, thread_pool_t *pool) {
+    (void)listen_fd;
+    (void)pool;
+    return -1;
+}
+
+#endif // IORING_RECV_MULTISHOT
@@ -3,8 +3,11 @@
 # 配置
 server=./server
 client=./client
+loadgen=./loadgen
+regression_tests="./test/pool_probe_test"
 sleep_time=1  # 服务端启动等待时间
-loop_count=100  # 循环次数
+loop_count=1  # 正确性测试的循环次数（压力由 loadgen 产生，不再逐次启动客户端）
+load_duration=5  # 每轮压测的秒数
 
 # 启动服务端
 start_server() {
@@ -85,11 +88,35 @@ run_tests() {
     fi
 }
 
+# 回归测试程序：连接池、负载均衡等客户端库的边界情况
+run_regression() {
+    echo "Running regression tests..."
+    regression_failures=0
+    for t in $regression_tests; do
+        $t || regression_failures=$((regression_failures + 1))
+    done
+    echo "Regression test failures: $regression_failures"
+}
+
+# 压测：闭环流水线测吞吐量，开环固定速率测延迟分位数
+run_load() {
+    echo "Running load tests..."
+    load_failures=0
+    $loadgen -c 16 -p 8 -d $load_duration -s 16-1024 -f 1:4,2:2,3:2,4:1,5:1 || load_failures=$((load_failures + 1))
+    echo "----------------------------------------"
+    $loadgen -c 16 -d $load_duration -r 5000 -s 16-1024 -f 1:4,2:2,3:2,4:1,5:1 || load_failures=$((load_failures + 1))
+    echo "----------------------------------------"
+    echo "Load test failures: $load_failures"
+}
+
 # 主函数
 main() {
     start_server
     run_tests
+    run_regression
+    run_load
     stop_server
+    [ $load_failures -eq 0 ] && [ $regression_failures -eq 0 ]
 }
 
 # 执行主函数
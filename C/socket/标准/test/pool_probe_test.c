@@ -0,0 +1,70 @@
+#include <stdio.h>
+#include <string.h>
+#include "include/libclient.h"
+#include "include/buffer_pool.h"
+#include "include/log.h"
+
+// 连接池试探回归测试（需要服务端运行在 SERVER_IP:SERVER_PORT，由 test.sh 启动）：
+// 地址被剔除且剔除已到期时，借出的空闲连接成为试探请求；该复用连接失败时 client_pool_call 不剔除地址，
+// 归还时必须结束试探，否则地址一直处于试探状态，之后所有共享该地址集合的客户端都无法再选中它
+
+static int failures = 0;
+
+#define CHECK(cond, msg) do { \
+    if (!(cond)) { \
+        printf("FAIL: %s\n", msg); \
+        failures++; \
+    } \
+} while (0)
+
+// 发送一次请求，返回状态码
+static int call_once(client_pool_t *pool) {
+    client_result_t result;
+    client_pool_call(pool, 2, "hello", 5, &result);
+    buffer_free(result.response);
+    return result.status;
+}
+
+int main() {
+    log_init("./logs");
+
+    endpoint_set_t endpoints;
+    endpoints_init(&endpoints, BALANCE_ROUND_ROBIN);
+    endpoints_add(&endpoints, SERVER_IP, SERVER_PORT);
+    endpoint_t *ep = &endpoints.endpoints[0];
+
+    client_pool_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.endpoints = &endpoints;
+    config.max_size = 1;
+    client_pool_t *pool = client_pool_create(&config);
+    CHECK(pool != NULL, "create pool");
+    if (!pool) {
+        return 1;
+    }
+
+    // 建立一个空闲连接，之后借出时为复用
+    CHECK(call_once(pool) == 0, "first request");
+
+    // 剔除地址并让剔除立即到期：下一次借出的复用连接成为试探请求
+    endpoint_failed(ep);
+    __atomic_store_n(&ep->ejected_until, 0, __ATOMIC_RELEASE);
+    client_conn_t *conn = client_pool_checkout(pool);
+    CHECK(conn != NULL && conn->request_id != 0, "checkout reuses the idle connection");
+    CHECK(__atomic_load_n(&ep->probing, __ATOMIC_ACQUIRE) == 1, "reused connection probes the endpoint");
+
+    // 复用的连接失败（client_pool_call 此时不调用 endpoint_failed），归还为损坏的连接
+    if (conn) {
+        client_pool_return(pool, conn, 1);
+    }
+    CHECK(__atomic_load_n(&ep->probing, __ATOMIC_ACQUIRE) == 0, "broken return ends the probe");
+
+    // 地址可以再次试探，新连接成功后恢复
+    CHECK(call_once(pool) == 0, "request after failed probe");
+    CHECK(__atomic_load_n(&ep->failures, __ATOMIC_ACQUIRE) == 0, "endpoint recovered");
+
+    client_pool_destroy(pool);
+    log_cleanup();
+    printf("pool_probe_test: %s\n", failures == 0 ? "ok" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}